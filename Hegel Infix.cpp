@@ -1,1720 +1,1175 @@
-#include <algorithm>
-#include <array>
-#include <cassert>
-#include <chrono>
-#include <climits>
-#include <cmath>
-#include <cstdint>
-#include <cstdlib>
+// 命令行前端：交互的各模式、普查与输出层（plain / ndjson / binary），
+// 与 hegel_core.cpp 一起编译（见 README）。
+#include "hegel_core.h"
+
+#include <atomic>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
-#include <numeric>
+#include <mutex>
 #include <random>
 #include <sstream>
-#include <string>
-#include <unordered_map>
-#include <unordered_set>
-#include <utility>
-#include <vector>
+#include <thread>
+
+// ======================= 普查：全部多重集的精确有解率 =======================
+// 按字典序枚举 [lo,hi] 中取 n 个数的全部多重集，多线程分块求解（每块连续，
+// 线程内共享子表缓存）。给出结果文件时每完成一块就追加写入，既是输出也是
+// 断点：再次运行同一参数会跳过文件中已有的多重集。
+struct CensusResult {
+  bool done = false;
+  unsigned long long count = 0; // 到达目标的表达式棵数
+  string witness;               // 一个解（中缀）
+};
 
-#ifdef HEGEL_WASM
-#include <emscripten/emscripten.h>
-#endif
+struct Census {
+  static const size_t CHUNK = 16;
+  static const size_t MAX_MULTISETS = 5000000;
+
+  ConfigPtr config = default_config();
+  int n = 0, lo = 0, hi = 0;
+  vector<vector<long long>> sets;
+  vector<CensusResult> results;
+
+  static unsigned long long binom(int a, int b) {
+    unsigned long long r = 1;
+    for (int i = 1; i <= b; i++) {
+      r = r * (unsigned long long)(a - b + i) / i;
+      if (r > MAX_MULTISETS)
+        return MAX_MULTISETS + 1;
+    }
+    return r;
+  }
 
-using namespace std;
-// ==================== Global Parameters (Mutable via hegel_configure)
-// ====================
-static int MAX_NEST = 4;
-static int TARGET = 24;
-static int MAX_USE_SQRT = 2;
-static int MAX_USE_FACT = 2;
-static int MAX_USE_LG = 1;
-static int MAX_USE_LB = 2;
-static int MAX_USE_LOG = 1;
-static bool NO_NEGATIVE_INTERMEDIATE = true;
-static bool ONLY_ARITHMETIC = false;
+  bool init(int n_, int lo_, int hi_) {
+    n = n_;
+    lo = lo_;
+    hi = hi_;
+    if (n <= 0 || lo > hi || binom(hi - lo + n, n) > MAX_MULTISETS)
+      return false;
+    vector<long long> cur(n, lo);
+    while (true) {
+      sets.push_back(cur);
+      int p = n - 1;
+      while (p >= 0 && cur[p] == hi)
+        p--;
+      if (p < 0)
+        break;
+      long long v = cur[p] + 1;
+      for (int i = p; i < n; i++)
+        cur[i] = v;
+    }
+    results.assign(sets.size(), CensusResult());
+    return true;
+  }
 
-// ==================== Constants ====================
-static const long long MAX_ABS_VAL = 1LL << 50;
-static const int MAX_FACT_ARG = 100;
-static const int MAX_EXP_SUM =
-    100; // Increased significantly for factorial chains
-static const int SIMPLIFY_STEPS = 50;
-static const bool SKIP_EQUIV_DURING_SEARCH = false;
-static const int MAX_EQUIV_KEY_CACHE = 20000;
-static const bool MEMO_IN_FIND_ALL = true;
-static const bool NORMAL_FIND_FIRST_ONLY = false;
+  string header() const {
+    return "# census " + to_string(n) + " " + to_string(lo) + " " +
+           to_string(hi) + " " + config->key;
+  }
 
-enum FuncIdx { F_SQRT, F_FACT, F_LG, F_LB, F_LOG, F_CNT };
+  static string line_of(const vector<long long> &ms, const CensusResult &r) {
+    string s = ReachBuilder::multiset_key(ms);
+    s.pop_back();
+    s += "|" + to_string(r.count) + "|" + r.witness;
+    return s;
+  }
 
-static int MAX_USE[F_CNT] = {2, 2, 1, 2, 1};
+  // 读取断点；文件头与当前参数不符时返回 false
+  bool load(const string &path) {
+    ifstream in(path);
+    if (!in)
+      return true;
+    string line;
+    if (!getline(in, line))
+      return true;
+    if (line != header())
+      return false;
+    unordered_map<string, size_t> rank;
+    for (size_t i = 0; i < sets.size(); i++)
+      rank.emplace(ReachBuilder::multiset_key(sets[i]), i);
+    while (getline(in, line)) {
+      size_t a = line.find('|');
+      size_t b = (a == string::npos) ? a : line.find('|', a + 1);
+      if (b == string::npos)
+        continue;
+      auto it = rank.find(line.substr(0, a) + " ");
+      if (it == rank.end())
+        continue;
+      CensusResult &r = results[it->second];
+      r.done = true;
+      r.count = strtoull(line.substr(a + 1, b - a - 1).c_str(), nullptr, 10);
+      r.witness = line.substr(b + 1);
+    }
+    return true;
+  }
 
-static void update_max_use_array() {
-  MAX_USE[F_SQRT] = MAX_USE_SQRT;
-  MAX_USE[F_FACT] = MAX_USE_FACT;
-  MAX_USE[F_LG] = MAX_USE_LG;
-  MAX_USE[F_LB] = MAX_USE_LB;
-  MAX_USE[F_LOG] = MAX_USE_LOG;
-}
+  void solve_one(ReachBuilder &rb, size_t idx) {
+    CensusResult &r = results[idx];
+    vector<string> witness;
+    r.count = rb.count_target(sets[idx], witness);
+    if (!witness.empty())
+      r.witness = rpn_to_infix(witness);
+    r.done = true;
+  }
 
-struct Num {
-  int sign = 0;
-  vector<pair<int, int>> pe;
-  bool has_ll = false;
-  long long ll = 0;
-};
+  // out 为空时不写文件
+  void run(int threads, const string &path) {
+    ofstream out;
+    if (!path.empty()) {
+      bool fresh = true;
+      {
+        ifstream probe(path);
+        fresh = !probe || probe.peek() == ifstream::traits_type::eof();
+      }
+      out.open(path, ios::app);
+      if (fresh)
+        out << header() << "\n" << flush;
+    }
 
-struct Node {
-  Num num;
-  vector<string> expr;                // RPN tokens
-  array<unsigned char, F_CNT> used{}; // 每种函数使用次数
-  int depth = 0;                      // 最大嵌套深度
+    atomic<size_t> next{0};
+    mutex out_mutex;
+    auto worker = [&]() {
+      ReachBuilder rb(config);
+      string buf;
+      while (true) {
+        size_t start = next.fetch_add(CHUNK);
+        if (start >= sets.size())
+          break;
+        size_t end = min(sets.size(), start + CHUNK);
+        buf.clear();
+        for (size_t i = start; i < end; i++) {
+          if (results[i].done)
+            continue;
+          solve_one(rb, i);
+          buf += line_of(sets[i], results[i]);
+          buf.push_back('\n');
+        }
+        if (out.is_open() && !buf.empty()) {
+          lock_guard<mutex> lock(out_mutex);
+          out << buf << flush;
+        }
+      }
+    };
+    if (threads <= 1) {
+      worker();
+    } else {
+      vector<thread> pool;
+      for (int t = 0; t < threads; t++)
+        pool.emplace_back(worker);
+      for (auto &th : pool)
+        th.join();
+    }
+  }
 };
 
-// --------------- 工具：RPN 拼接 ---------------
-static inline vector<string>
-merge_expr(const vector<string> &a, const vector<string> &b, const string &op) {
-  vector<string> res;
-  res.reserve(a.size() + b.size() + 1);
-  res.insert(res.end(), a.begin(), a.end());
-  res.insert(res.end(), b.begin(), b.end());
-  res.push_back(op);
-  return res;
-}
-static inline vector<string> apply_unary_expr(const vector<string> &a,
-                                              const string &op) {
-  vector<string> res = a;
-  res.push_back(op);
-  return res;
-}
-
-// ---- Expression normalization for + / - / * / / duplicates ----
-static bool is_unary_token(const string &t) {
-  return (t == "sqrt" || t == "!" || t == "lg" || t == "lb");
-}
-static bool is_binary_token(const string &t) {
-  return (t == "+" || t == "-" || t == "*" || t == "/" || t == "log");
-}
+// ======================= 输出层 =======================
+// 所有结果先写入一块复用的缓冲区，写满或到达显式刷新点（每题结束、提示输入
+// 前）才写出，避免逐条 flush 的系统调用开销。三种格式：
+//   plain  ：与交互界面相同的文本
+//   ndjson ：每行一个 JSON 对象，供程序读取（见 README）
+//   binary ：紧凑二进制记录（类型字节 + LEB128 变长整数，见 README）
+enum OutFormat { OUT_PLAIN, OUT_NDJSON, OUT_BINARY };
 
-struct ExprNodeTmp {
-  string op;
-  int left = -1;
-  int right = -1;
-  int child = -1;
-  string tok;
-  bool is_leaf = false;
-  bool is_unary = false;
-  bool is_binary = false;
-};
-static int build_expr_tree(const vector<string> &expr,
-                           vector<ExprNodeTmp> &nodes) {
-  vector<int> st;
+// RPN -> LaTeX（除法写成 \frac，优先级规则与 rpn_to_infix 相同）
+static string rpn_to_latex(const vector<string> &expr) {
+  vector<InfixItem> st;
   st.reserve(expr.size());
+  auto wrap = [](bool need, const string &s) {
+    return need ? "\\left(" + s + "\\right)" : s;
+  };
   for (const string &t : expr) {
-    if (is_binary_token(t)) {
-      if (st.size() < 2)
-        return -1;
-      int b = st.back();
+    int code = op_of_token(t);
+    int arity = code == OP_LEAF ? 0 : OPS[code].arity;
+    if (st.size() < (size_t)arity)
+      return "\\text{" + rpn_raw(expr) + "}";
+    InfixItem c;
+    c.prec = 3;
+    c.bop = 0;
+    if (arity == 2) {
+      InfixItem b = std::move(st.back());
       st.pop_back();
-      int a = st.back();
+      InfixItem a = std::move(st.back());
       st.pop_back();
-      ExprNodeTmp n;
-      n.op = t;
-      n.left = a;
-      n.right = b;
-      n.is_binary = true;
-      nodes.push_back(std::move(n));
-      st.push_back((int)nodes.size() - 1);
-    } else if (is_unary_token(t)) {
-      if (st.empty())
-        return -1;
-      int a = st.back();
+      char op = t[0];
+      if (code == OP_LOG) {
+        c.s = "\\log_{" + a.s + "}\\left(" + b.s + "\\right)";
+      } else if (code == OP_DIV) {
+        c.prec = 2; // 分式本身无需括号，但作阶乘的底数时要加
+        c.s = "\\frac{" + a.s + "}{" + b.s + "}";
+      } else if (code == OP_POW) {
+        c.bop = op;
+        c.s = wrap(need_paren_left(op, a), a.s) + "^{" + b.s + "}";
+      } else {
+        c.prec = prec_of_binop(op);
+        c.bop = op;
+        const char *sym = code == OP_MUL   ? " \\cdot "
+                          : code == OP_CAT ? " \\mathbin{\\|} "
+                                           : nullptr;
+        c.s = wrap(need_paren_left(op, a), a.s) +
+              (sym ? string(sym) : string(" ") + op + " ") +
+              wrap(need_paren_right(op, b), b.s);
+      }
+    } else if (arity == 1) {
+      InfixItem a = std::move(st.back());
       st.pop_back();
-      ExprNodeTmp n;
-      n.op = t;
-      n.child = a;
-      n.is_unary = true;
-      nodes.push_back(std::move(n));
-      st.push_back((int)nodes.size() - 1);
+      if (code == OP_FACT)
+        c.s = wrap(a.prec < 3 || a.bop != 0, a.s) + "!";
+      else if (code == OP_SQRT)
+        c.s = "\\sqrt{" + a.s + "}";
+      else
+        c.s = (code == OP_LG ? "\\lg" : "\\mathrm{lb}") +
+              wrap(true, a.s);
     } else {
-      ExprNodeTmp n;
-      n.tok = t;
-      n.is_leaf = true;
-      nodes.push_back(std::move(n));
-      st.push_back((int)nodes.size() - 1);
+      c.s = t;
+      c.prec = 4;
     }
+    st.push_back(std::move(c));
   }
   if (st.size() != 1)
-    return -1;
-  return st.back();
+    return "\\text{?}";
+  return st.back().s;
 }
 
-// Simplification cache for equivalence (bounded by SIMPLIFY_STEPS)
-static bool try_parse_ll(const string &t, long long &out) {
-  try {
-    size_t pos = 0;
-    long long v = stoll(t, &pos);
-    if (pos != t.size())
-      return false;
-    out = v;
-    return true;
-  } catch (...) {
-    return false;
-  }
-}
-static bool safe_add_ll(long long a, long long b, long long &out) {
-  __int128 r = (__int128)a + (__int128)b;
-  if (r < LLONG_MIN || r > LLONG_MAX)
-    return false;
-  out = (long long)r;
-  return true;
-}
-static bool safe_sub_ll(long long a, long long b, long long &out) {
-  __int128 r = (__int128)a - (__int128)b;
-  if (r < LLONG_MIN || r > LLONG_MAX)
-    return false;
-  out = (long long)r;
-  return true;
-}
-static bool safe_mul_ll(long long a, long long b, long long &out) {
-  __int128 r = (__int128)a * (__int128)b;
-  if (r < LLONG_MIN || r > LLONG_MAX)
-    return false;
-  out = (long long)r;
-  return true;
-}
-static bool safe_fact_ll(long long n, long long &out) {
-  if (n < 0 || n > MAX_FACT_ARG)
-    return false;
-  __int128 r = 1;
-  for (long long i = 2; i <= n; i++) {
-    r *= i;
-    if (r > LLONG_MAX)
+struct Output {
+  OutFormat format = OUT_PLAIN;
+  string buf;
+  size_t flush_at = (size_t)1 << 16;
+
+  static bool parse_format(const string &s, OutFormat &f) {
+    if (s == "plain")
+      f = OUT_PLAIN;
+    else if (s == "ndjson")
+      f = OUT_NDJSON;
+    else if (s == "binary")
+      f = OUT_BINARY;
+    else
       return false;
-  }
-  out = (long long)r;
-  return true;
-}
-static bool safe_lg_ll(long long v, long long &out) {
-  if (v <= 0)
-    return false;
-  long long k = 0;
-  while (v % 10 == 0) {
-    v /= 10;
-    k++;
-  }
-  if (v != 1)
-    return false;
-  out = k;
-  return true;
-}
-static bool safe_lb_ll(long long v, long long &out) {
-  if (v <= 0)
-    return false;
-  if ((v & (v - 1)) != 0)
-    return false;
-  long long k = 0;
-  while (v > 1) {
-    v >>= 1;
-    k++;
-  }
-  out = k;
-  return true;
-}
-static bool safe_log_ll(long long a, long long b, long long &out) {
-  if (a < 2 || b <= 0)
-    return false;
-  if (b == 1) {
-    out = 0;
     return true;
   }
-  long long k = 0;
-  __int128 cur = 1;
-  while (cur < b) {
-    cur *= a;
-    k++;
-    if (cur > LLONG_MAX)
-      return false;
-  }
-  if (cur != b)
-    return false;
-  out = k;
-  return true;
-}
-// Forward declarations
-static bool is_perfect_square_ll(long long x, long long &r);
-static void print_infix(const vector<string> &expr, const string &prefix);
-
-struct SimplifyCache {
-  const vector<ExprNodeTmp> *nodes = nullptr;
-  vector<char> vis;
-  vector<char> ok;
-  vector<long long> val;
-  vector<int> steps;
-};
-static thread_local SimplifyCache g_simpl;
-static unordered_map<string, string> equiv_key_cache;
 
-static void init_simplify_cache(const vector<ExprNodeTmp> &nodes) {
-  g_simpl.nodes = &nodes;
-  g_simpl.vis.assign(nodes.size(), 0);
-  g_simpl.ok.assign(nodes.size(), 0);
-  g_simpl.val.assign(nodes.size(), 0);
-  g_simpl.steps.assign(nodes.size(), 0);
-}
-static bool simplify_dfs(int idx, long long &out_val, int &out_steps) {
-  if (SIMPLIFY_STEPS <= 0 || g_simpl.nodes == nullptr)
-    return false;
-  if (g_simpl.vis[idx]) {
-    if (g_simpl.ok[idx]) {
-      out_val = g_simpl.val[idx];
-      out_steps = g_simpl.steps[idx];
-      return true;
+  void flush() {
+    if (!buf.empty()) {
+      cout.write(buf.data(), (streamsize)buf.size());
+      buf.clear();
     }
-    return false;
+    cout.flush();
   }
-  g_simpl.vis[idx] = 1;
-  const ExprNodeTmp &n = (*g_simpl.nodes)[idx];
-  long long v = 0;
-  int steps = 0;
-  bool ok = false;
-  if (n.is_leaf) {
-    if (try_parse_ll(n.tok, v)) {
-      ok = true;
-      steps = 0;
-    }
-  } else if (n.is_unary) {
-    long long cv;
-    int cs;
-    if (simplify_dfs(n.child, cv, cs)) {
-      if (cs + 1 <= SIMPLIFY_STEPS) {
-        if (n.op == "sqrt") {
-          long long r;
-          if (is_perfect_square_ll(cv, r)) {
-            v = r;
-            ok = true;
-            steps = cs + 1;
-          }
-        } else if (n.op == "!") {
-          if (safe_fact_ll(cv, v)) {
-            ok = true;
-            steps = cs + 1;
-          }
-        } else if (n.op == "lg") {
-          if (safe_lg_ll(cv, v)) {
-            ok = true;
-            steps = cs + 1;
-          }
-        } else if (n.op == "lb") {
-          if (safe_lb_ll(cv, v)) {
-            ok = true;
-            steps = cs + 1;
-          }
-        }
-      }
-    }
-  } else if (n.is_binary) {
-    long long lv, rv;
-    int ls, rs;
-    if (simplify_dfs(n.left, lv, ls) && simplify_dfs(n.right, rv, rs)) {
-      if (ls + rs + 1 <= SIMPLIFY_STEPS) {
-        if (n.op == "+") {
-          if (safe_add_ll(lv, rv, v)) {
-            ok = true;
-            steps = ls + rs + 1;
-          }
-        } else if (n.op == "-") {
-          if (safe_sub_ll(lv, rv, v)) {
-            ok = true;
-            steps = ls + rs + 1;
-          }
-        } else if (n.op == "*") {
-          if (safe_mul_ll(lv, rv, v)) {
-            ok = true;
-            steps = ls + rs + 1;
-          }
-        } else if (n.op == "/") {
-          if (rv != 0 && (lv % rv == 0)) {
-            v = lv / rv;
-            ok = true;
-            steps = ls + rs + 1;
-          }
-        } else if (n.op == "log") {
-          if (safe_log_ll(lv, rv, v)) {
-            ok = true;
-            steps = ls + rs + 1;
-          }
-        }
-      }
+  void maybe_flush() {
+    if (buf.size() >= flush_at) {
+      cout.write(buf.data(), (streamsize)buf.size());
+      buf.clear();
     }
   }
-  if (ok) {
-    g_simpl.ok[idx] = 1;
-    g_simpl.val[idx] = v;
-    g_simpl.steps[idx] = steps;
-    out_val = v;
-    out_steps = steps;
-    return true;
-  }
-  return false;
-}
-static bool try_simplify_const(const vector<ExprNodeTmp> &nodes, int idx,
-                               long long &out_val) {
-  if (!SKIP_EQUIV_DURING_SEARCH)
-    return false;
-  if (SIMPLIFY_STEPS <= 0)
-    return false;
-  if (g_simpl.nodes != &nodes)
-    init_simplify_cache(nodes);
-  int steps = 0;
-  return simplify_dfs(idx, out_val, steps);
-}
-
-static string normalized_expr_key_from_nodes(const vector<ExprNodeTmp> &nodes,
-                                             int idx);
 
-static void collect_mul_factors(const vector<ExprNodeTmp> &nodes, int idx,
-                                int sign, vector<string> &factors) {
-  const ExprNodeTmp &n = nodes[idx];
-  if (n.is_binary && (n.op == "*" || n.op == "/")) {
-    collect_mul_factors(nodes, n.left, sign, factors);
-    int s2 = (n.op == "*") ? sign : -sign;
-    collect_mul_factors(nodes, n.right, s2, factors);
-    return;
-  }
-  string key = normalized_expr_key_from_nodes(nodes, idx);
-  factors.push_back(string(sign > 0 ? "*" : "/") + key);
-}
-static string normalized_mul_key(const vector<ExprNodeTmp> &nodes, int idx,
-                                 bool &direct_key) {
-  vector<string> factors;
-  factors.reserve(8);
-  collect_mul_factors(nodes, idx, 1, factors);
-  // drop neutral factor 1 and /1
-  vector<string> filtered;
-  filtered.reserve(factors.size());
-  for (const string &f : factors) {
-    if (f.size() >= 2) {
-      string key = f.substr(1);
-      if (key == "1")
-        continue;
-    }
-    filtered.push_back(f);
-  }
-  if (filtered.empty()) {
-    direct_key = true;
-    return "1";
-  }
-  if (filtered.size() == 1 && filtered[0][0] == '*') {
-    direct_key = true;
-    return filtered[0].substr(1);
-  }
-  sort(filtered.begin(), filtered.end());
-  string out;
-  for (size_t i = 0; i < filtered.size(); i++) {
-    if (i)
-      out.push_back('|');
-    out += filtered[i];
-  }
-  direct_key = false;
-  return out;
-}
-static void collect_add_terms(const vector<ExprNodeTmp> &nodes, int idx,
-                              int sign, vector<string> &terms) {
-  const ExprNodeTmp &n = nodes[idx];
-  if (n.is_binary && (n.op == "+" || n.op == "-")) {
-    collect_add_terms(nodes, n.left, sign, terms);
-    int s2 = (n.op == "+") ? sign : -sign;
-    collect_add_terms(nodes, n.right, s2, terms);
-    return;
-  }
-  string key = normalized_expr_key_from_nodes(nodes, idx);
-  terms.push_back(string(sign > 0 ? "+" : "-") + key);
-}
-static string normalized_add_key_from_nodes(const vector<ExprNodeTmp> &nodes,
-                                            int idx, bool &direct_key) {
-  vector<string> terms;
-  terms.reserve(8);
-  collect_add_terms(nodes, idx, 1, terms);
-  // drop neutral term 0 and -0
-  vector<string> filtered;
-  filtered.reserve(terms.size());
-  for (const string &t : terms) {
-    if (t.size() >= 2) {
-      string key = t.substr(1);
-      if (key == "0")
-        continue;
+  // ---- 编码 ----
+  void put_ll(long long v) {
+    char tmp[24];
+    char *e = tmp + sizeof(tmp), *p = e;
+    unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : v;
+    do {
+      *--p = char('0' + u % 10);
+      u /= 10;
+    } while (u);
+    if (v < 0)
+      *--p = '-';
+    buf.append(p, e - p);
+  }
+  void put_json_string(const string &s) {
+    buf.push_back('"');
+    for (char ch : s) {
+      if (ch == '"' || ch == '\\') {
+        buf.push_back('\\');
+        buf.push_back(ch);
+      } else if ((unsigned char)ch < 0x20) {
+        static const char hex[] = "0123456789abcdef";
+        buf += "\\u00";
+        buf.push_back(hex[(ch >> 4) & 15]);
+        buf.push_back(hex[ch & 15]);
+      } else {
+        buf.push_back(ch);
+      }
     }
-    filtered.push_back(t);
-  }
-  if (filtered.empty()) {
-    direct_key = true;
-    return "0";
+    buf.push_back('"');
   }
-
-  vector<string> a = filtered;
-  vector<string> b;
-  b.reserve(filtered.size());
-  for (const string &t : filtered) {
-    if (!t.empty()) {
-      char s = t[0];
-      string key = t.substr(1);
-      b.push_back(string(1, (s == '+') ? '-' : '+') + key);
+  void put_varint(unsigned long long v) {
+    while (v >= 0x80) {
+      buf.push_back(char((v & 0x7f) | 0x80));
+      v >>= 7;
     }
-  }
-  sort(a.begin(), a.end());
-  sort(b.begin(), b.end());
-  string sa, sb;
-  for (size_t i = 0; i < a.size(); i++) {
-    if (i)
-      sa.push_back('|');
-    sa += a[i];
-  }
-  for (size_t i = 0; i < b.size(); i++) {
-    if (i)
-      sb.push_back('|');
-    sb += b[i];
-  }
-  bool neg = false;
-  vector<string> *use = &a;
-  if (!sb.empty() && sb < sa) {
-    neg = true;
-    use = &b;
-  }
-
-  if (use->size() == 1) {
-    string t = (*use)[0];
-    if (t.size() >= 2 && t[0] == '+') {
-      direct_key = true;
-      return neg ? (string("-") + t.substr(1)) : t.substr(1);
+    buf.push_back(char(v));
+  }
+  void put_zigzag(long long v) {
+    put_varint(((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+  }
+  void put_bytes(const string &s) {
+    put_varint(s.size());
+    buf += s;
+  }
+  // 二进制记录中的 RPN：运算符 0~10（+ - * / log sqrt ! lg lb ^ ||），
+  // 0x10 + zigzag 为整数，0x11 + 长度 + 字节为其他记号
+  void put_rpn_binary(const vector<string> &expr) {
+    put_varint(expr.size());
+    for (const string &t : expr) {
+      int code = op_of_token(t); // 记号编码即运算符编号
+      long long v;
+      if (code != OP_LEAF) {
+        buf.push_back(char(code));
+      } else if (try_parse_ll(t, v)) {
+        buf.push_back(char(0x10));
+        put_zigzag(v);
+      } else {
+        buf.push_back(char(0x11));
+        put_bytes(t);
+      }
     }
-    direct_key = true;
-    return neg ? t.substr(1) : t;
   }
 
-  string out;
-  for (size_t i = 0; i < use->size(); i++) {
-    if (i)
-      out.push_back('|');
-    out += (*use)[i];
-  }
-  direct_key = false;
-  return neg ? (string("-") + out) : out;
-}
-static string normalized_expr_key_from_nodes(const vector<ExprNodeTmp> &nodes,
-                                             int idx) {
-  long long sv;
-  if (try_simplify_const(nodes, idx, sv))
-    return to_string(sv);
-  const ExprNodeTmp &n = nodes[idx];
-  if (n.is_leaf)
-    return n.tok;
-  if (n.is_unary)
-    return n.op + "(" + normalized_expr_key_from_nodes(nodes, n.child) + ")";
-  if (n.is_binary) {
-    if (n.op == "+" || n.op == "-") {
-      bool direct_key = false;
-      string ak = normalized_add_key_from_nodes(nodes, idx, direct_key);
-      if (direct_key)
-        return ak;
-      if (!ak.empty() && ak[0] == '-')
-        return string("-") + string("A:") + ak.substr(1);
-      return string("A:") + ak;
+  // ---- 记录 ----
+  // 提示与回显：只在 plain 格式输出
+  void plain(const string &s) {
+    if (format != OUT_PLAIN)
+      return;
+    buf += s;
+    maybe_flush();
+  }
+  // 提示后需要立即可见
+  void prompt(const string &s) {
+    plain(s);
+    flush();
+  }
+  // 一行说明（汇总、错误）：plain 原样输出，其余格式包成 msg 记录
+  void message(const string &line) {
+    if (format == OUT_PLAIN) {
+      buf += line;
+      buf.push_back('\n');
+    } else if (format == OUT_NDJSON) {
+      buf += "{\"msg\":";
+      put_json_string(line);
+      buf += "}\n";
+    } else {
+      buf.push_back('M');
+      put_bytes(line);
     }
-    if (n.op == "*" || n.op == "/") {
-      bool direct_key = false;
-      string mk = normalized_mul_key(nodes, idx, direct_key);
-      if (direct_key)
-        return mk;
-      return string("M:") + mk;
+    maybe_flush();
+  }
+  void begin_puzzle(const vector<long long> &nums) {
+    if (format == OUT_NDJSON) {
+      buf += "{\"puzzle\":[";
+      for (size_t i = 0; i < nums.size(); i++) {
+        if (i)
+          buf.push_back(',');
+        put_ll(nums[i]);
+      }
+      buf += "]}\n";
+    } else if (format == OUT_BINARY) {
+      buf.push_back('P');
+      put_varint(nums.size());
+      for (long long x : nums)
+        put_zigzag(x);
     }
-    return n.op + "(" + normalized_expr_key_from_nodes(nodes, n.left) + "," +
-           normalized_expr_key_from_nodes(nodes, n.right) + ")";
-  }
-  return "";
-}
-static string normalized_expr_key(const vector<string> &expr) {
-  string rpn_key;
-  rpn_key.reserve(expr.size() * 3);
-  for (size_t i = 0; i < expr.size(); i++) {
-    if (i)
-      rpn_key.push_back(' ');
-    rpn_key += expr[i];
-  }
-  auto it = equiv_key_cache.find(rpn_key);
-  if (it != equiv_key_cache.end())
-    return it->second;
-
-  vector<ExprNodeTmp> nodes;
-  nodes.reserve(expr.size());
-  int root = build_expr_tree(expr, nodes);
-  if (root < 0)
-    return "";
-  init_simplify_cache(nodes);
-  string key = normalized_expr_key_from_nodes(nodes, root);
-
-  if (equiv_key_cache.size() > MAX_EQUIV_KEY_CACHE)
-    equiv_key_cache.clear();
-  equiv_key_cache.emplace(std::move(rpn_key), key);
-  return key;
-}
-static int count_plus_tokens(const vector<string> &expr) {
-  int c = 0;
-  for (const string &t : expr)
-    if (t == "+")
-      c++;
-  return c;
-}
-
-static int count_leaf_tokens(const vector<string> &expr) {
-  int c = 0;
-  for (const string &t : expr) {
-    if (!is_binary_token(t) && !is_unary_token(t))
-      c++;
   }
-  return c;
-}
-
-// --------------- 质因数分解（仅对 |v|<=MAX_ABS_VAL 范围做） ---------------
-static vector<pair<int, int>> factorize_small(long long x) {
-  vector<pair<int, int>> res;
-  if (x <= 1)
-    return res;
-  for (long long p = 2; p * p <= x; ++p) {
-    if (x % p == 0) {
-      int e = 0;
-      while (x % p == 0) {
-        x /= p;
-        ++e;
+  void answer(const vector<string> &expr, long long target,
+              const string &prefix) {
+    if (format == OUT_PLAIN) {
+      buf += prefix;
+      buf += rpn_to_infix(expr);
+      buf += " = ";
+      put_ll(target);
+      buf.push_back('\n');
+    } else if (format == OUT_NDJSON) {
+      buf += "{\"infix\":";
+      put_json_string(rpn_to_infix(expr));
+      buf += ",\"rpn\":\"";
+      for (size_t i = 0; i < expr.size(); i++) {
+        if (i)
+          buf.push_back(' ');
+        buf += expr[i]; // 记号只含数字、运算符与函数名，无需转义
       }
-      res.push_back({(int)p, e});
+      buf += "\",\"latex\":";
+      put_json_string(rpn_to_latex(expr));
+      buf += ",\"target\":";
+      put_ll(target);
+      buf += "}\n";
+    } else {
+      buf.push_back('S');
+      put_zigzag(target);
+      put_rpn_binary(expr);
     }
-  }
-  if (x > 1)
-    res.push_back({(int)x, 1});
-  return res;
-}
-
-static int exp_sum(const vector<pair<int, int>> &pe) {
-  int s = 0;
-  for (auto &kv : pe)
-    s += kv.second;
-  return s;
-}
-
-// factors: out = a + b (指数相加)
-static vector<pair<int, int>> factors_add(const vector<pair<int, int>> &a,
-                                          const vector<pair<int, int>> &b) {
-  vector<pair<int, int>> out;
-  out.reserve(a.size() + b.size());
-  size_t i = 0, j = 0;
-  while (i < a.size() || j < b.size()) {
-    if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
-      out.push_back(a[i++]);
-    } else if (i == a.size() || b[j].first < a[i].first) {
-      out.push_back(b[j++]);
+    maybe_flush();
+  }
+  // 代价估计：plain 为一行说明，ndjson 为 estimate 记录，二进制为 C 记录
+  // （find-first 标志字节，数字个数、函数次数、状态数、树结点数、
+  // 相对误差千分数、探测微秒数）
+  void estimate(const CostEstimate &e) {
+    if (format == OUT_PLAIN) {
+      ostringstream os;
+      os << (e.find_first ? "找一个解：" : "求全部解：") << "约 "
+         << setprecision(3) << e.states << " 个状态（±" << fixed
+         << setprecision(0) << e.rel_err * 100 << "%，不计记忆化 "
+         << defaultfloat << setprecision(3) << e.tree << "），探测 "
+         << e.probe_us << "us\n";
+      buf += os.str();
+    } else if (format == OUT_NDJSON) {
+      ostringstream os;
+      os << "{\"estimate\":true,\"findFirst\":"
+         << (e.find_first ? "true" : "false") << ",\"states\":"
+         << setprecision(6) << e.states << ",\"tree\":" << e.tree
+         << ",\"relErr\":" << e.rel_err << ",\"numbers\":" << e.numbers
+         << ",\"maxAbs\":" << e.max_abs << ",\"funcBudget\":"
+         << e.func_budget << ",\"samples\":" << e.samples
+         << ",\"probeUs\":" << e.probe_us << "}\n";
+      buf += os.str();
     } else {
-      int p = a[i].first;
-      int e = a[i].second + b[j].second;
-      if (e)
-        out.push_back({p, e});
-      ++i;
-      ++j;
+      buf.push_back('C');
+      buf.push_back(e.find_first ? 1 : 0);
+      put_varint(e.numbers);
+      put_varint(e.func_budget);
+      put_varint((unsigned long long)llround(min(e.states, 1e18)));
+      put_varint((unsigned long long)llround(min(e.tree, 1e18)));
+      put_varint((unsigned long long)llround(e.rel_err * 1000));
+      put_varint((unsigned long long)e.probe_us);
     }
-  }
-  return out;
-}
-
-// factors: out = a - b (指数相减)，要求 a 可被 b 整除（每个指数>=）
-static bool factors_subtract(const vector<pair<int, int>> &a,
-                             const vector<pair<int, int>> &b,
-                             vector<pair<int, int>> &out) {
-  out.clear();
-  out.reserve(a.size());
-  size_t i = 0, j = 0;
-  while (i < a.size() || j < b.size()) {
-    if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
-      out.push_back(a[i++]);
-    } else if (i == a.size() || b[j].first < a[i].first) {
-      return false; // b 有 a 没有的质因子
+    maybe_flush();
+  }
+  // 解计数：plain 为两行说明，ndjson 为 count 记录，二进制为 N 记录
+  // （写法数、类别数与各类写法数、状态数、展开数、微秒数）
+  void count(const SolutionCount &c) {
+    if (format == OUT_PLAIN) {
+      ostringstream os;
+      os << "共 " << c.forms << " 种不同写法（状态 " << c.states
+         << "，展开 " << c.expanded << "，用时 " << c.us << "us）\n";
+      if (c.forms) {
+        os << "按运算：";
+        for (int k = 0; k < CC_CNT; k++)
+          if (c.by_class[k])
+            os << " " << COUNT_CLASS_NAMES[k] << " " << c.by_class[k];
+        os << "\n";
+      }
+      buf += os.str();
+    } else if (format == OUT_NDJSON) {
+      buf += "{\"count\":true,\"forms\":";
+      put_ll((long long)c.forms);
+      buf += ",\"byClass\":{";
+      for (int k = 0; k < CC_CNT; k++) {
+        if (k)
+          buf.push_back(',');
+        put_json_string(COUNT_CLASS_NAMES[k]);
+        buf.push_back(':');
+        put_ll((long long)c.by_class[k]);
+      }
+      buf += "},\"states\":";
+      put_ll((long long)c.states);
+      buf += ",\"expanded\":";
+      put_ll((long long)c.expanded);
+      buf += ",\"us\":";
+      put_ll(c.us);
+      buf += "}\n";
     } else {
-      int p = a[i].first;
-      int ea = a[i].second, eb = b[j].second;
-      if (ea < eb)
-        return false;
-      int e = ea - eb;
-      if (e)
-        out.push_back({p, e});
-      ++i;
-      ++j;
+      buf.push_back('N');
+      put_varint(c.forms);
+      put_varint(CC_CNT);
+      for (size_t v : c.by_class)
+        put_varint(v);
+      put_varint(c.states);
+      put_varint(c.expanded);
+      put_varint((unsigned long long)c.us);
     }
-  }
-  return true;
-}
-
-// 尝试把质因数指数还原为 |v|（只在 <=MAX_ABS_VAL 时成功；全程不用浮点）
-static bool try_eval_small_abs(const vector<pair<int, int>> &pe,
-                               long long &out_abs) {
-  __int128 prod = 1;
-  for (auto &kv : pe) {
-    int p = kv.first;
-    int e = kv.second;
-    for (int i = 0; i < e; i++) {
-      prod *= p;
-      if (prod > MAX_ABS_VAL)
-        return false;
+    maybe_flush();
+  }
+  // 答案校验：plain 为一行结论，ndjson 为 verify 记录，二进制为 V 记录
+  // （状态字节、出错偏移、有无值的标志字节与值）
+  void verify(const string &expr, const VerifyResult &r) {
+    bool has_value = (r.status == VS_OK || r.status == VS_WRONG) &&
+                     r.value.has_ll;
+    if (format == OUT_PLAIN) {
+      buf += expr;
+      buf += "：";
+      buf += VERIFY_STATUS_TEXT[r.status];
+      if (r.status == VS_WRONG && has_value) {
+        buf += "（= ";
+        put_ll(r.value.ll);
+        buf += "）";
+      }
+      if (r.pos >= 0) {
+        buf += "（位置 ";
+        put_ll(r.pos);
+        buf += "）";
+      }
+      buf.push_back('\n');
+    } else if (format == OUT_NDJSON) {
+      buf += "{\"verify\":true,\"expr\":";
+      put_json_string(expr);
+      buf += ",\"status\":\"";
+      buf += VERIFY_STATUS_NAMES[r.status];
+      buf += "\",\"pos\":";
+      put_ll(r.pos);
+      buf += ",\"value\":";
+      if (has_value)
+        put_ll(r.value.ll);
+      else
+        buf += "null";
+      buf += "}\n";
+    } else {
+      buf.push_back('V');
+      buf.push_back(char(r.status));
+      put_zigzag(r.pos);
+      buf.push_back(has_value ? 1 : 0);
+      if (has_value)
+        put_zigzag(r.value.ll);
     }
-  }
-  out_abs = (long long)prod;
-  return true;
-}
-
-static void normalize_num(Num &n) {
-  if (n.sign == 0) {
-    n.has_ll = true;
-    n.ll = 0;
-    n.pe.clear();
-    return;
-  }
-  long long abs_v;
-  if (try_eval_small_abs(n.pe, abs_v)) {
-    n.has_ll = true;
-    n.ll = (n.sign < 0 ? -abs_v : abs_v);
-  } else {
-    n.has_ll = false;
-    n.ll = 0;
-  }
-}
-
-static Num make_num_from_ll_pruned(long long v, bool &ok) {
-  ok = false;
-  Num n;
-  if (NO_NEGATIVE_INTERMEDIATE && v < 0)
-    return n; // forbid negative intermediates
-  if (v == 0) {
-    n.sign = 0;
-    n.pe.clear();
-    n.has_ll = true;
-    n.ll = 0;
-    ok = true;
-    return n;
-  }
-  long long av = llabs(v);
-  if (av > MAX_ABS_VAL)
-    return n; // 剪枝：普通整数太大直接丢
-  n.sign = (v < 0 ? -1 : 1);
-  n.pe = factorize_small(av);
-  n.has_ll = true;
-  n.ll = v;
-  ok = true;
-  return n;
-}
-
-// --------------- 完全平方判定（整数） ---------------
-static bool is_perfect_square_ll(long long x, long long &r) {
-  if (x < 0)
-    return false;
-  long long lo = 0, hi = min<long long>(x, 3037000499LL);
-  while (lo <= hi) {
-    long long mid = lo + (hi - lo) / 2;
-    __int128 sq = (__int128)mid * mid;
-    if (sq == x) {
-      r = mid;
-      return true;
+    maybe_flush();
+  }
+  // 无解时最接近目标的一个值：plain 为一行，ndjson 为 near 记录，二进制为
+  // R 记录（大数标志字节；不是大数时后接值与距离；RPN）
+  void near(const NearMiss::Entry &e) {
+    if (format == OUT_PLAIN) {
+      buf += "  ";
+      buf += rpn_to_infix(e.expr);
+      if (e.big) {
+        buf += " ";
+        buf += NearMiss::value_text(e);
+      } else {
+        buf += " = ";
+        put_ll(e.value.ll);
+        buf += "（差 ";
+        put_ll(e.dist);
+        buf += "）";
+      }
+      buf.push_back('\n');
+    } else if (format == OUT_NDJSON) {
+      buf += "{\"near\":true,\"infix\":";
+      put_json_string(rpn_to_infix(e.expr));
+      buf += ",\"rpn\":\"";
+      buf += rpn_raw(e.expr);
+      buf += "\",\"value\":";
+      if (e.big) {
+        ostringstream os;
+        os << "null,\"distance\":null,\"log2\":" << setprecision(6)
+           << e.log2;
+        buf += os.str();
+      } else {
+        put_ll(e.value.ll);
+        buf += ",\"distance\":";
+        put_ll(e.dist);
+      }
+      buf += "}\n";
+    } else {
+      buf.push_back('R');
+      buf.push_back(e.big ? 1 : 0);
+      if (!e.big) {
+        put_zigzag(e.value.ll);
+        put_varint((unsigned long long)e.dist);
+      }
+      put_rpn_binary(e.expr);
     }
-    if (sq < x)
-      lo = mid + 1;
-    else
-      hi = mid - 1;
-  }
-  return false;
-}
-
-// --------------- 阶乘质因子（Legendre） ---------------
-static vector<int> primes_up_to(int n) {
-  vector<int> ps;
-  if (n < 2)
-    return ps;
-  vector<bool> isPrime(n + 1, true);
-  isPrime[0] = isPrime[1] = false;
-  for (int i = 2; i * i <= n; i++)
-    if (isPrime[i]) {
-      for (int j = i * i; j <= n; j += i)
-        isPrime[j] = false;
+    maybe_flush();
+  }
+  // 束搜索的概况：plain 为一行，ndjson 为 beam 记录，二进制为 B 记录
+  // （穷尽标志字节、轮数、最后一轮束宽、状态数、首解微秒数、总微秒数）
+  void beam(const BeamResult &r) {
+    if (format == OUT_PLAIN) {
+      buf += "束搜索 ";
+      put_ll(r.rounds);
+      buf += " 轮（束宽 ";
+      put_ll((long long)r.width);
+      buf += "，状态 ";
+      put_ll(r.states);
+      buf += "），";
+      if (r.first_us >= 0) {
+        buf += "首个解 ";
+        put_ll(r.first_us);
+        buf += "us，";
+      }
+      buf += "用时 ";
+      put_ll(r.us);
+      buf += r.exhausted ? "us，已穷尽\n" : "us，未穷尽\n";
+    } else if (format == OUT_NDJSON) {
+      buf += "{\"beam\":true,\"exhausted\":";
+      buf += r.exhausted ? "true" : "false";
+      buf += ",\"rounds\":";
+      put_ll(r.rounds);
+      buf += ",\"width\":";
+      put_ll((long long)r.width);
+      buf += ",\"states\":";
+      put_ll(r.states);
+      buf += ",\"firstUs\":";
+      if (r.first_us >= 0)
+        put_ll(r.first_us);
+      else
+        buf += "null";
+      buf += ",\"us\":";
+      put_ll(r.us);
+      buf += "}\n";
+    } else {
+      buf.push_back('B');
+      buf.push_back(r.exhausted ? 1 : 0);
+      put_varint((unsigned long long)r.rounds);
+      put_varint(r.width);
+      put_varint((unsigned long long)r.states);
+      put_zigzag(r.first_us);
+      put_varint((unsigned long long)r.us);
     }
-  for (int i = 2; i <= n; i++)
-    if (isPrime[i])
-      ps.push_back(i);
-  return ps;
-}
-
-static vector<pair<int, int>> factorial_factors(int n) {
-  vector<pair<int, int>> res;
-  static vector<int> cached_primes = primes_up_to(MAX_FACT_ARG);
-  for (int p : cached_primes) {
-    if (p > n)
-      break;
-    int e = 0, t = n;
-    while (t) {
-      t /= p;
-      e += t;
+    maybe_flush();
+  }
+  // 参数扫描的一格：所用的 max_nest 与 max_use，以及有解的手数
+  void sweep(const ConfigSweep &sw, size_t k) {
+    const bool arith = sw.arithmetic_cell(k);
+    const pair<int, array<int, F_CNT>> &p = sw.params[k];
+    if (format == OUT_PLAIN) {
+      string label;
+      if (arith) {
+        label = "只四则运算";
+      } else {
+        if (!sw.grid.nest.empty())
+          label = "嵌套≤" + to_string(p.first);
+        for (int f = 0; f < F_CNT; f++)
+          if (!sw.grid.use[f].empty()) {
+            if (!label.empty())
+              label.push_back(' ');
+            label += string(FUNC_NAMES[f]) + "≤" + to_string(p.second[f]);
+          }
+        if (label.empty())
+          label = "当前配置";
+      }
+      ostringstream os;
+      os << label << "：有解 " << sw.solvable[k] << "/" << sw.hands << "="
+         << fixed << setprecision(4)
+         << (sw.hands ? (double)sw.solvable[k] / sw.hands : 0.0) << "\n";
+      buf += os.str();
+    } else if (format == OUT_NDJSON) {
+      buf += "{\"sweep\":true,\"onlyArithmetic\":";
+      buf += arith ? "true" : "false";
+      buf += ",\"maxNest\":";
+      put_ll(p.first);
+      buf += ",\"maxUse\":{";
+      for (int f = 0; f < F_CNT; f++) {
+        if (f)
+          buf.push_back(',');
+        put_json_string(FUNC_NAMES[f]);
+        buf.push_back(':');
+        put_ll(p.second[f]);
+      }
+      buf += "},\"solvable\":";
+      put_ll((long long)sw.solvable[k]);
+      buf += ",\"hands\":";
+      put_ll((long long)sw.hands);
+      buf += "}\n";
+    } else {
+      buf.push_back('W');
+      buf.push_back(arith ? 1 : 0);
+      put_varint((unsigned long long)p.first);
+      put_varint(F_CNT);
+      for (int v : p.second)
+        put_varint((unsigned long long)v);
+      put_varint(sw.solvable[k]);
+      put_varint(sw.hands);
     }
-    if (e)
-      res.push_back({p, e});
-  }
-  return res;
-}
-
-// --------------- 函数使用次数合并检查 ---------------
-static bool merge_used(const Node &A, const Node &B,
-                       array<unsigned char, F_CNT> &out) {
-  for (int i = 0; i < F_CNT; i++) {
-    int s = (int)A.used[i] + (int)B.used[i];
-    if (s > MAX_USE[i])
-      return false;
-    out[i] = (unsigned char)s;
+    maybe_flush();
+  }
+  // 每题的结束记录兼刷新点；band、difficulty 只在出题模式有意义（-1 表示无）
+  void end_puzzle(bool found, size_t count, int band = -1,
+                  int difficulty = -1) {
+    if (format == OUT_NDJSON) {
+      buf += "{\"end\":true,\"found\":";
+      buf += found ? "true" : "false";
+      buf += ",\"count\":";
+      put_ll((long long)count);
+      if (band >= 0) {
+        buf += ",\"band\":";
+        put_ll(band);
+        buf += ",\"difficulty\":";
+        put_ll(difficulty);
+      }
+      buf += "}\n";
+    } else if (format == OUT_BINARY) {
+      buf.push_back('E');
+      buf.push_back(found ? 1 : 0);
+      put_varint(count);
+      put_zigzag(band);
+      put_zigzag(difficulty);
+    }
+    flush();
   }
-  return true;
-}
-static bool inc_used(const Node &A, FuncIdx f,
-                     array<unsigned char, F_CNT> &out) {
-  out = A.used;
-  if ((int)out[f] + 1 > MAX_USE[f])
-    return false;
-  out[f] = (unsigned char)(out[f] + 1);
-  return true;
-}
-
-// --------------- 目标判断（不依赖大整数） ---------------
-static vector<pair<int, int>> TARGET_FACTORS = factorize_small(TARGET);
+};
+static Output g_out;
 
-static bool is_target_24(const Num &n) {
-  if (n.sign <= 0)
-    return false;
-  if (n.has_ll)
-    return n.ll == TARGET;
-  return n.pe == TARGET_FACTORS;
+// 打印一条：中缀表达式 = target（也是 solver 即时输出解的回调）
+static void print_infix(const vector<string> &expr, int target,
+                        const string &prefix) {
+  g_out.answer(expr, target, prefix);
 }
 
-// ======================= RPN -> 中缀（高性能：栈式一次扫描）
-// =======================
-struct InfixItem {
-  string s;
-  int prec; // 1:+- 2:*/ 3:func/! 4:atom
-  char bop; // 若顶层是二元运算符：+ - * /，否则为 0
+// 交互模式
+enum Mode {
+  MODE_SOLUTION,
+  MODE_RANDOM,
+  MODE_GENERATE,
+  MODE_CENSUS,
+  MODE_TARGETS,
+  MODE_ESTIMATE,
+  MODE_COUNT,
+  MODE_VERIFY,
+  MODE_HINT,
+  MODE_NEAREST,
+  MODE_BEAM,
+  MODE_SWEEP
 };
 
-static inline int prec_of_binop(char op) {
-  if (op == '+' || op == '-')
-    return 1;
-  if (op == '*' || op == '/')
-    return 2;
-  return 0;
-}
-static inline bool need_paren_left(char op, const InfixItem &a) {
-  int p = prec_of_binop(op);
-  if (a.prec < p)
+// 解析模式命令：random / solution / generate / census / targets / estimate /
+// count / verify / hint / nearest / beam / sweep
+static bool parse_mode_cmd(const string &line, Mode &mode) {
+  if (line == "random") {
+    mode = MODE_RANDOM;
     return true;
-  // 同优先级下左结合：左侧一般不需要括号
-  return false;
-}
-static inline bool need_paren_right(char op, const InfixItem &b) {
-  int p = prec_of_binop(op);
-  if (op == '+') {
-    if (b.prec < p)
-      return true;
-    // a + (b - c) 必须加括号
-    if (b.prec == p && b.bop == '-')
-      return true;
-    return false;
   }
-  if (op == '-') {
-    // a - (b +/- c) 必须加括号
-    if (b.prec <= p)
-      return true;
-    return false;
-  }
-  if (op == '*') {
-    if (b.prec < p)
-      return true;
-    // a * (b / c) 必须加括号
-    if (b.prec == p && b.bop == '/')
-      return true;
-    return false;
-  }
-  if (op == '/') {
-    // a / (b * c) 和 a / (b / c) 都必须加括号
-    if (b.prec <= p)
-      return true;
-    return false;
-  }
-  return false;
-}
-
-static string rpn_to_infix(const vector<string> &expr) {
-  vector<InfixItem> st;
-  st.reserve(expr.size());
-
-  for (const string &t : expr) {
-    if (t == "+" || t == "-" || t == "*" || t == "/") {
-      if (st.size() < 2) {
-        // fallback
-        string raw;
-        for (size_t i = 0; i < expr.size(); i++) {
-          if (i)
-            raw.push_back(' ');
-          raw += expr[i];
-        }
-        return raw;
-      }
-      InfixItem b = std::move(st.back());
-      st.pop_back();
-      InfixItem a = std::move(st.back());
-      st.pop_back();
-      char op = t[0];
-
-      bool lp = need_paren_left(op, a);
-      bool rp = need_paren_right(op, b);
-
-      string as = lp ? ("(" + a.s + ")") : a.s;
-      string bs = rp ? ("(" + b.s + ")") : b.s;
-
-      InfixItem c;
-      c.prec = prec_of_binop(op);
-      c.bop = op;
-      c.s.reserve(as.size() + bs.size() + 3);
-      c.s = as;
-      c.s.push_back(' ');
-      c.s.push_back(op);
-      c.s.push_back(' ');
-      c.s += bs;
-      st.push_back(std::move(c));
-    } else if (t == "log") {
-      if (st.size() < 2) {
-        string raw;
-        for (size_t i = 0; i < expr.size(); i++) {
-          if (i)
-            raw.push_back(' ');
-          raw += expr[i];
-        }
-        return raw;
-      }
-      InfixItem b = std::move(st.back());
-      st.pop_back();
-      InfixItem a = std::move(st.back());
-      st.pop_back();
-      InfixItem c;
-      c.prec = 3;
-      c.bop = 0;
-      c.s = "log(" + a.s + ", " + b.s + ")";
-      st.push_back(std::move(c));
-    } else if (t == "sqrt" || t == "lg" || t == "lb") {
-      if (st.empty()) {
-        string raw;
-        for (size_t i = 0; i < expr.size(); i++) {
-          if (i)
-            raw.push_back(' ');
-          raw += expr[i];
-        }
-        return raw;
-      }
-      InfixItem a = std::move(st.back());
-      st.pop_back();
-      InfixItem c;
-      c.prec = 3;
-      c.bop = 0;
-      c.s = t + "(" + a.s + ")";
-      st.push_back(std::move(c));
-    } else if (t == "!") {
-      if (st.empty()) {
-        string raw;
-        for (size_t i = 0; i < expr.size(); i++) {
-          if (i)
-            raw.push_back(' ');
-          raw += expr[i];
-        }
-        return raw;
-      }
-      InfixItem a = std::move(st.back());
-      st.pop_back();
-      bool need = (a.prec < 3); // (a+b)! 这类需要括号
-      InfixItem c;
-      c.prec = 3;
-      c.bop = 0;
-      c.s = (need ? ("(" + a.s + ")") : a.s) + "!";
-      st.push_back(std::move(c));
-    } else {
-      // number / atom
-      InfixItem a;
-      a.s = t;
-      a.prec = 4;
-      a.bop = 0;
-      st.push_back(std::move(a));
-    }
-  }
-
-  if (st.size() != 1) {
-    string raw;
-    for (size_t i = 0; i < expr.size(); i++) {
-      if (i)
-        raw.push_back(' ');
-      raw += expr[i];
-    }
-    return raw;
+  if (line == "solution") {
+    mode = MODE_SOLUTION;
+    return true;
   }
-  return st.back().s;
-}
-
-// --------------- Solver ---------------
-struct Solver {
-  bool find_first = false;
-  bool found = false;
-  int expected_leaf_count = 0;
-  vector<string> first_expr;
-  bool immediate_print = false;
-  string immediate_prefix;
-
-  unordered_map<string, vector<string>> best_exprs;
-  unordered_map<string, int> best_plus;
-
-  unordered_set<string> memo; // 记忆化用
-
-  // node key（用于记忆化）
-  static string num_key(const Num &n) {
-    if (n.sign == 0)
-      return "0";
-    string s;
-    s.push_back(n.sign < 0 ? '-' : '+');
-    for (auto &kv : n.pe) {
-      s += to_string(kv.first);
-      s.push_back('^');
-      s += to_string(kv.second);
-      s.push_back(',');
-    }
-    return s;
+  if (line == "generate") {
+    mode = MODE_GENERATE;
+    return true;
   }
-  static string node_key(const Node &nd) {
-    string s = num_key(nd.num);
-    s.push_back('|');
-    for (int i = 0; i < F_CNT; i++) {
-      s += to_string((int)nd.used[i]);
-      s.push_back(',');
-    }
-    s += "D";
-    s += to_string(nd.depth);
-    return s;
+  if (line == "census") {
+    mode = MODE_CENSUS;
+    return true;
   }
-  static string state_key(const vector<Node> &cur) {
-    vector<string> ks;
-    ks.reserve(cur.size());
-    for (auto &nd : cur)
-      ks.push_back(node_key(nd));
-    sort(ks.begin(), ks.end());
-    string s;
-    for (size_t i = 0; i < ks.size(); i++) {
-      if (i)
-        s.push_back(';');
-      s += ks[i];
-    }
-    return s;
+  if (line == "targets") {
+    mode = MODE_TARGETS;
+    return true;
   }
-
-  void add_answer(const vector<string> &expr) {
-    string key = normalized_expr_key(expr);
-    if (key.empty())
-      return;
-    key += "#C" + to_string(count_leaf_tokens(expr));
-    int plus_cnt = count_plus_tokens(expr);
-    auto it = best_plus.find(key);
-    if (it == best_plus.end() || plus_cnt > it->second) {
-      bool is_better = (it != best_plus.end());
-      best_plus[key] = plus_cnt;
-      best_exprs[key] = expr;
-      if (immediate_print) {
-        if (!is_better) {
-          print_infix(expr, immediate_prefix);
-        } else if (!SKIP_EQUIV_DURING_SEARCH) {
-          print_infix(expr, immediate_prefix);
-        }
-      }
-    }
+  if (line == "estimate") {
+    mode = MODE_ESTIMATE;
+    return true;
   }
-
-  // ========== 一元函数尝试 ==========
-  bool try_sqrt(const Node &A, Node &out) {
-    if (A.depth + 1 > MAX_NEST)
-      return false;
-    array<unsigned char, F_CNT> used2;
-    if (!inc_used(A, F_SQRT, used2))
-      return false;
-    if (!A.num.has_ll)
-      return false;
-    long long v = A.num.ll;
-    if (v == 0 || v == 1)
-      return false;
-    long long r;
-    if (!is_perfect_square_ll(v, r))
-      return false;
-
-    bool ok;
-    Num n = make_num_from_ll_pruned(r, ok);
-    if (!ok)
-      return false;
-
-    out.num = std::move(n);
-    out.expr = apply_unary_expr(A.expr, "sqrt");
-    out.used = used2;
-    out.depth = A.depth + 1;
+  if (line == "count") {
+    mode = MODE_COUNT;
     return true;
   }
-
-  bool try_fact(const Node &A, Node &out) {
-    if (A.depth + 1 > MAX_NEST)
-      return false;
-    array<unsigned char, F_CNT> used2;
-    if (!inc_used(A, F_FACT, used2))
-      return false;
-    if (!A.num.has_ll)
-      return false;
-    long long v = A.num.ll;
-    if (v < 0 || v > MAX_FACT_ARG)
-      return false;
-
-    if (v == 0 || v == 1 || v == 2)
-      return false;
-    if (v == 4)
-      return false;
-
-    Num n;
-    if (v == 0 || v == 1) {
-      bool ok;
-      n = make_num_from_ll_pruned(1, ok);
-      if (!ok)
-        return false;
-    } else {
-      n.sign = 1;
-      n.pe = factorial_factors((int)v);
-      normalize_num(n);
-      // Allow large factorials even if they overflow long long
-      if (!n.has_ll &&
-          exp_sum(n.pe) > MAX_EXP_SUM * 2) // Double limit just in case
-        return false;
-    }
-
-    out.num = std::move(n);
-    out.expr = apply_unary_expr(A.expr, "!");
-    out.used = used2;
-    out.depth = A.depth + 1;
+  if (line == "verify") {
+    mode = MODE_VERIFY;
     return true;
   }
-
-  bool try_lg(const Node &A, Node &out) {
-    if (A.depth + 1 > MAX_NEST)
-      return false;
-    array<unsigned char, F_CNT> used2;
-    if (!inc_used(A, F_LG, used2))
-      return false;
-    if (!A.num.has_ll)
-      return false;
-    long long v = A.num.ll;
-    if (v <= 0 || v == 1)
-      return false;
-    if (v == 4 || v == 16)
-      return false;
-
-    long long x = v;
-    long long k = 0;
-    while (x % 10 == 0) {
-      x /= 10;
-      ++k;
-    }
-    if (x != 1)
-      return false;
-
-    bool ok;
-    Num n = make_num_from_ll_pruned(k, ok);
-    if (!ok)
-      return false;
-
-    out.num = std::move(n);
-    out.expr = apply_unary_expr(A.expr, "lg");
-    out.used = used2;
-    out.depth = A.depth + 1;
+  if (line == "hint") {
+    mode = MODE_HINT;
     return true;
   }
-
-  bool try_lb(const Node &A, Node &out) {
-    if (A.depth + 1 > MAX_NEST)
-      return false;
-    array<unsigned char, F_CNT> used2;
-    if (!inc_used(A, F_LB, used2))
-      return false;
-    if (!A.num.has_ll)
-      return false;
-    long long v = A.num.ll;
-    if (v <= 0 || v == 1)
-      return false;
-    if (v == 4 || v == 16)
-      return false;
-
-    if ((v & (v - 1)) != 0)
-      return false;
-    long long k = 0;
-    while (v > 1) {
-      v >>= 1;
-      ++k;
-    }
-
-    bool ok;
-    Num n = make_num_from_ll_pruned(k, ok);
-    if (!ok)
-      return false;
-
-    out.num = std::move(n);
-    out.expr = apply_unary_expr(A.expr, "lb");
-    out.used = used2;
-    out.depth = A.depth + 1;
+  if (line == "nearest") {
+    mode = MODE_NEAREST;
     return true;
   }
-
-  // ========== 二元 log_a(b) 尝试 ==========
-  bool try_logab(const Node &A, const Node &B, Node &out) {
-    int newDepth = max(A.depth, B.depth) + 1;
-    if (newDepth > MAX_NEST)
-      return false;
-
-    array<unsigned char, F_CNT> used2;
-    if (!merge_used(A, B, used2))
-      return false;
-    if ((int)used2[F_LOG] + 1 > MAX_USE[F_LOG])
-      return false;
-    used2[F_LOG] = (unsigned char)(used2[F_LOG] + 1);
-
-    if (!A.num.has_ll || !B.num.has_ll)
-      return false;
-    long long a = A.num.ll;
-    long long b = B.num.ll;
-    if (a < 2)
-      return false;
-    if (b <= 0 || b == 1)
-      return false;
-
-    long long k = 0;
-    __int128 cur = 1;
-    while (cur < b) {
-      cur *= a;
-      ++k;
-      if (cur > MAX_ABS_VAL)
-        break;
-    }
-    if (cur != b)
-      return false;
-
-    bool ok;
-    Num n = make_num_from_ll_pruned(k, ok);
-    if (!ok)
-      return false;
-
-    out.num = std::move(n);
-    out.expr = merge_expr(A.expr, B.expr, "log"); // a b log
-    out.used = used2;
-    out.depth = newDepth;
+  if (line == "beam") {
+    mode = MODE_BEAM;
     return true;
   }
-
-  // ========== 二元四则 ==========
-  bool try_add(const Node &A, const Node &B, Node &out) {
-    array<unsigned char, F_CNT> used2;
-    if (!merge_used(A, B, used2))
-      return false;
-    int d = max(A.depth, B.depth);
-
-    if (!A.num.has_ll || !B.num.has_ll)
-      return false;
-    __int128 r = (__int128)A.num.ll + (__int128)B.num.ll;
-    if (r > MAX_ABS_VAL || r < -MAX_ABS_VAL)
-      return false;
-
-    bool ok;
-    Num n = make_num_from_ll_pruned((long long)r, ok);
-    if (!ok)
-      return false;
-
-    out.num = std::move(n);
-    out.expr = merge_expr(A.expr, B.expr, "+");
-    out.used = used2;
-    out.depth = d;
+  if (line == "sweep") {
+    mode = MODE_SWEEP;
     return true;
   }
+  return false;
+}
 
-  bool try_sub(const Node &A, const Node &B, Node &out) {
-    array<unsigned char, F_CNT> used2;
-    if (!merge_used(A, B, used2))
-      return false;
-    int d = max(A.depth, B.depth);
-
-    if (!A.num.has_ll || !B.num.has_ll)
-      return false;
-    __int128 r = (__int128)A.num.ll - (__int128)B.num.ll;
-    if (r > MAX_ABS_VAL || r < -MAX_ABS_VAL)
-      return false;
-
-    bool ok;
-    Num n = make_num_from_ll_pruned((long long)r, ok);
-    if (!ok)
-      return false;
-
-    out.num = std::move(n);
-    out.expr = merge_expr(A.expr, B.expr, "-");
-    out.used = used2;
-    out.depth = d;
-    return true;
+static vector<long long> input_values(const vector<Node> &input) {
+  vector<long long> v;
+  for (const Node &nd : input) {
+    long long x = 0;
+    try_parse_ll(nd.expr[0], x);
+    v.push_back(x);
   }
+  return v;
+}
 
-  bool try_mul(const Node &A, const Node &B, Node &out) {
-    array<unsigned char, F_CNT> used2;
-    if (!merge_used(A, B, used2))
-      return false;
-    int d = max(A.depth, B.depth);
+// 用法：Hegel Infix [--format plain|ndjson|binary]
+int main(int argc, char **argv) {
+  ios::sync_with_stdio(false);
+  cin.tie(nullptr);
 
-    Num n;
-    if (A.num.sign == 0 || B.num.sign == 0) {
-      n.sign = 0;
-      n.pe.clear();
-      n.has_ll = true;
-      n.ll = 0;
-    } else {
-      n.sign = A.num.sign * B.num.sign;
-      n.pe = factors_add(A.num.pe, B.num.pe);
-      if (exp_sum(n.pe) > MAX_EXP_SUM)
-        return false;
-      normalize_num(n);
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i], val;
+    if (arg.rfind("--format=", 0) == 0)
+      val = arg.substr(9);
+    else if (arg == "--format" && i + 1 < argc)
+      val = argv[++i];
+    if (!Output::parse_format(val, g_out.format)) {
+      cerr << "用法：" << argv[0] << " [--format plain|ndjson|binary]\n";
+      return 2;
     }
-
-    out.num = std::move(n);
-    out.expr = merge_expr(A.expr, B.expr, "*");
-    out.used = used2;
-    out.depth = d;
-    return true;
   }
 
-  bool try_div(const Node &A, const Node &B, Node &out) {
-    array<unsigned char, F_CNT> used2;
-    if (!merge_used(A, B, used2))
-      return false;
-    int d = max(A.depth, B.depth);
+  const ConfigPtr config = default_config();
+  const SolverConfig &cfg = *config;
+  Solver solver;
+  solver.config = config;
+  solver.print_answer = print_infix;
+  PuzzleGenerator generator;
+  generator.solver.config = config;
+  AnswerChecker checker(config);
+  HintEngine hinter(config);
+  Mode mode = MODE_SOLUTION;
 
-    if (B.num.sign == 0)
-      return false;
-    if (B.num.has_ll && B.num.ll == 1)
-      return false;
+  std::mt19937 rng((unsigned)chrono::high_resolution_clock::now()
+                       .time_since_epoch()
+                       .count());
 
-    Num n;
-    if (A.num.sign == 0) {
-      n.sign = 0;
-      n.pe.clear();
-      n.has_ll = true;
-      n.ll = 0;
+  while (true) {
+    if (mode == MODE_SOLUTION) {
+      g_out.prompt("请输入数字（输入 random 进入随机模式，generate 进入出题模式，"
+                   "census 进入普查模式，targets 进入多目标模式，estimate "
+                   "进入估计模式，count 进入计数模式，verify 进入校验模式，hint "
+                   "进入提示模式，nearest 进入最接近模式，beam "
+                   "进入束搜索模式，sweep 进入参数扫描模式）：");
+    } else if (mode == MODE_RANDOM) {
+      g_out.prompt("输入模拟次数、数字个数、最小值、最大值（输入 solution "
+                   "返回解题模式）：");
+    } else if (mode == MODE_GENERATE) {
+      g_out.prompt("输入题目数量、数字个数、最小值、最大值、难度（0~3，可省略；"
+                   "输入 solution 返回解题模式）：");
+    } else if (mode == MODE_CENSUS) {
+      g_out.prompt("输入数字个数、最小值、最大值、结果文件（可省略；输入 "
+                   "solution 返回解题模式）：");
+    } else if (mode == MODE_TARGETS) {
+      g_out.prompt("输入数字与目标，用 | 分隔，如 3 3 8 8 | 10 24 36 或 1-100"
+                   "（输入 solution 返回解题模式）：");
+    } else if (mode == MODE_ESTIMATE) {
+      g_out.prompt("输入数字，只估计求解代价而不求解（输入 solution "
+                   "返回解题模式）：");
+    } else if (mode == MODE_COUNT) {
+      g_out.prompt("输入数字，只统计不同写法的个数而不列出（输入 solution "
+                   "返回解题模式）：");
+    } else if (mode == MODE_VERIFY) {
+      g_out.prompt("输入数字与答案，用 | 分隔，多个答案用 ; 分隔，如 3 3 8 8 | "
+                   "3! * 8 - 3 * 8。每一步都须得整数（8 / 3 这样除不尽的"
+                   "不行）（输入 solution 返回解题模式）：");
+    } else if (mode == MODE_HINT) {
+      g_out.prompt("输入数字与已做的部分，用 | 分隔，多个部分用 ; 分隔，如 "
+                   "3 3 8 8 | 8 / 8（输入 solution 返回解题模式）：");
+    } else if (mode == MODE_NEAREST) {
+      g_out.prompt("输入数字，无解时给出最接近目标的式子，可用 | 指定个数，如 "
+                   "1 1 1 1 | 10（输入 solution 返回解题模式）：");
+    } else if (mode == MODE_SWEEP) {
+      g_out.prompt("输入模拟次数、数字个数、最小值、最大值，可用 | 指定配置网格，"
+                   "如 1000 4 1 13 | nest=1-4 sqrt=0-2（输入 solution "
+                   "返回解题模式）：");
     } else {
-      vector<pair<int, int>> pe2;
-      if (!factors_subtract(A.num.pe, B.num.pe, pe2))
-        return false; // 必须整除
-      n.sign = A.num.sign * B.num.sign;
-      n.pe = std::move(pe2);
-      normalize_num(n);
-      if (!n.has_ll && exp_sum(n.pe) > MAX_EXP_SUM)
-        return false;
+      g_out.prompt("输入数字（可多到 10~12 个），可用 | 指定时限毫秒数，如 "
+                   "1 2 3 4 5 6 7 8 9 10 | 500（输入 solution 返回解题模式）：");
     }
 
-    out.num = std::move(n);
-    out.expr = merge_expr(A.expr, B.expr, "/");
-    out.used = used2;
-    out.depth = d;
-    return true;
-  }
+    string line;
+    if (!getline(cin, line))
+      break;
+    if (line.empty())
+      break;
 
-  // ========== DFS ==========
-  void dfs(vector<Node> cur) {
-    if (found && find_first)
-      return;
+    if (parse_mode_cmd(line, mode))
+      continue;
 
-    if (SKIP_EQUIV_DURING_SEARCH && cur.size() > 1) {
-      unordered_map<string, pair<int, Node>> best_by_key;
-      unordered_map<string, int> key_counts;
-      vector<Node> filtered;
-      filtered.reserve(cur.size());
-      for (auto &nd : cur) {
-        string k = normalized_expr_key(nd.expr);
-        if (k.empty()) {
-          filtered.push_back(nd);
+    if (mode == MODE_GENERATE) {
+      int C, N, L, R, band = BAND_ANY;
+      istringstream iss(line);
+      if (!(iss >> C >> N >> L >> R) || C <= 0 || N <= 0 || L > R) {
+        g_out.message("输入格式错误");
+        continue;
+      }
+      int b;
+      if (iss >> b) {
+        if (b < BAND_ANY || b >= BAND_CNT) {
+          g_out.message("输入格式错误");
           continue;
         }
-        k += "#C" + to_string(count_leaf_tokens(nd.expr));
-        key_counts[k]++;
-        int plus_cnt = count_plus_tokens(nd.expr);
-        auto it = best_by_key.find(k);
-        if (it == best_by_key.end() || plus_cnt > it->second.first) {
-          best_by_key[k] = {plus_cnt, nd};
-        }
+        band = b;
       }
-      for (auto &kv : best_by_key) {
-        int cnt = key_counts[kv.first];
-        for (int i = 0; i < cnt; i++) {
-          filtered.push_back(kv.second.second);
+
+      auto puzzles = generator.generate(C, N, L, R, band);
+      for (auto &pz : puzzles) {
+        const PuzzleRating &r = pz.second;
+        g_out.begin_puzzle(pz.first);
+        ostringstream os;
+        for (int i = 0; i < N; i++)
+          os << pz.first[i] << (i + 1 == N ? "" : " ");
+        if (r.rated) {
+          os << " | 难度 " << BAND_NAMES[r.band] << " " << r.difficulty
+             << " | 解数 " << r.solutions << (r.complete ? "" : "+");
         }
+        g_out.plain(os.str());
+        g_out.answer(r.simplest, cfg.target, " | ");
+        if (r.rated)
+          g_out.end_puzzle(true, r.solutions, r.band, r.difficulty);
+        else
+          g_out.end_puzzle(true, 1);
       }
-      if (filtered.size() < cur.size()) {
-        cur.swap(filtered);
-      }
+      g_out.message("共生成 " + to_string(puzzles.size()) + "/" +
+                    to_string(C) + " 道");
+      continue;
     }
 
-    if (cur.size() == 1) {
-      if (is_target_24(cur[0].num) &&
-          count_leaf_tokens(cur[0].expr) == expected_leaf_count) {
-        if (find_first) {
-          found = true;
-          first_expr = cur[0].expr;
-          if (immediate_print) {
-            print_infix(cur[0].expr, immediate_prefix);
-          }
-        } else {
-          found = true;
-          add_answer(cur[0].expr);
-        }
+    if (mode == MODE_TARGETS) {
+      size_t bar = line.find('|');
+      vector<Node> input;
+      vector<long long> ts;
+      if (bar != string::npos)
+        input = Solver::parse_nodes_from_line(cfg, line.substr(0, bar));
+      if (input.empty() ||
+          !Solver::parse_targets(cfg, line.substr(bar + 1), ts)) {
+        g_out.message("输入格式错误");
+        continue;
       }
-      return;
-    }
 
-    if (find_first || MEMO_IN_FIND_ALL) {
-      string key = state_key(cur);
-      if (memo.find(key) != memo.end())
-        return;
-      memo.insert(std::move(key));
-    }
+      solver.begin_targets(input, ts, NORMAL_FIND_FIRST_ONLY);
+      solver.step();
+      solver.finish();
 
-    // 一元函数：对每个元素尝试
-    for (size_t i = 0; i < cur.size(); i++) {
-      Node out;
-      if (!ONLY_ARITHMETIC) {
-        if (try_sqrt(cur[i], out)) {
-          Node bak = cur[i];
-          cur[i] = std::move(out);
-          dfs(cur);
-          cur[i] = std::move(bak);
-          if (found && find_first)
-            return;
-        }
-        if (try_fact(cur[i], out)) {
-          Node bak = cur[i];
-          cur[i] = std::move(out);
-          dfs(cur);
-          cur[i] = std::move(bak);
-          if (found && find_first)
-            return;
-        }
-        if (try_lg(cur[i], out)) {
-          Node bak = cur[i];
-          cur[i] = std::move(out);
-          dfs(cur);
-          cur[i] = std::move(bak);
-          if (found && find_first)
-            return;
-        }
-        if (try_lb(cur[i], out)) {
-          Node bak = cur[i];
-          cur[i] = std::move(out);
-          dfs(cur);
-          cur[i] = std::move(bak);
-          if (found && find_first)
-            return;
+      g_out.begin_puzzle(input_values(input));
+      vector<long long> missing;
+      size_t total = 0;
+      for (auto &h : solver.targets) {
+        if (!h.found) {
+          missing.push_back(h.target);
+          continue;
         }
+        g_out.plain("目标 " + to_string(h.target) + "（" +
+                    to_string(h.distinct_count()) + " 个解）：\n");
+        for (const vector<string> *e : h.ranked())
+          g_out.answer(*e, h.target, "  ");
+        total += h.distinct_count();
       }
+      if (!missing.empty()) {
+        string s = "无解目标：";
+        for (size_t i = 0; i < missing.size(); i++)
+          s += (i ? " " : "") + to_string(missing[i]);
+        g_out.plain(s + "\n");
+      }
+      g_out.plain("有解目标 " +
+                  to_string(solver.targets.size() - missing.size()) + "/" +
+                  to_string(solver.targets.size()) + "\n");
+      g_out.end_puzzle(total > 0, total);
+      continue;
     }
 
-    // 二元合并
-    int n = (int)cur.size();
-    unordered_set<string> pair_seen;
-    for (int i = 0; i < n - 1; i++)
-      for (int j = i + 1; j < n; j++) {
-        Node A = cur[i], B = cur[j];
-        string keyA = node_key(A);
-        string keyB = node_key(B);
-        string pair_key = keyA;
-        pair_key.push_back('|');
-        pair_key += keyB;
-        if (!pair_seen.insert(pair_key).second)
-          continue;
-
-        vector<Node> rest;
-        rest.reserve(n - 1);
-        for (int k = 0; k < n; k++)
-          if (k != i && k != j)
-            rest.push_back(cur[k]);
-
-        auto push_and_dfs = [&](Node &&C) {
-          rest.push_back(std::move(C));
-          dfs(rest);
-          rest.pop_back();
-        };
-
-        {
-          Node C;
-          if (try_add(A, B, C)) {
-            push_and_dfs(std::move(C));
-            if (found && find_first)
-              return;
-          }
-        }
-        {
-          Node C;
-          if (try_sub(A, B, C)) {
-            push_and_dfs(std::move(C));
-            if (found && find_first)
-              return;
-          }
-          if (try_sub(B, A, C)) {
-            push_and_dfs(std::move(C));
-            if (found && find_first)
-              return;
-          }
-        }
-        {
-          Node C;
-          if (try_mul(A, B, C)) {
-            push_and_dfs(std::move(C));
-            if (found && find_first)
-              return;
-          }
-        }
-        {
-          Node C;
-          if (try_div(A, B, C)) {
-            push_and_dfs(std::move(C));
-            if (found && find_first)
-              return;
-          }
-          if (try_div(B, A, C)) {
-            push_and_dfs(std::move(C));
-            if (found && find_first)
-              return;
-          }
-        }
-        {
-          Node C;
-          if (try_logab(A, B, C)) {
-            push_and_dfs(std::move(C));
-            if (found && find_first)
-              return;
-          }
-          if (try_logab(B, A, C)) {
-            push_and_dfs(std::move(C));
-            if (found && find_first)
-              return;
-          }
-        }
+    if (mode == MODE_ESTIMATE) {
+      vector<Node> input = Solver::parse_nodes_from_line(cfg, line);
+      if (input.empty()) {
+        g_out.message("输入格式错误");
+        continue;
       }
-  }
+      g_out.begin_puzzle(input_values(input));
+      g_out.estimate(solver.estimate_cost(input, false, ESTIMATE_SAMPLES));
+      g_out.estimate(solver.estimate_cost(input, true, ESTIMATE_SAMPLES));
+      g_out.flush();
+      continue;
+    }
 
-  // 输入数字 -> Node
-  static vector<Node> parse_nodes_from_line(const string &line) {
-    istringstream iss(line);
-    vector<Node> res;
-    long long x;
-    while (iss >> x) {
-      bool ok;
-      Num n = make_num_from_ll_pruned(x, ok);
-      if (!ok)
+    if (mode == MODE_COUNT) {
+      vector<Node> input = Solver::parse_nodes_from_line(cfg, line);
+      if (input.empty()) {
+        g_out.message("输入格式错误");
         continue;
-      Node nd;
-      nd.num = std::move(n);
-      nd.expr = {to_string(x)};
-      nd.used.fill(0);
-      nd.depth = 0;
-      res.push_back(std::move(nd));
+      }
+      vector<long long> nums = input_values(input);
+      g_out.begin_puzzle(nums);
+      SolutionCounter counter(config);
+      SolutionCount c = counter.count(nums);
+      g_out.count(c);
+      g_out.end_puzzle(c.forms > 0, c.forms);
+      continue;
     }
-    return res;
-  }
-
-  // 求解接口
-  bool solve_first(const vector<long long> &nums, vector<string> &out_expr) {
-    found = false;
-    first_expr.clear();
-    memo.clear();
-    immediate_print = true;
-    immediate_prefix = ">>> ";
-    expected_leaf_count = (int)nums.size();
 
-    vector<Node> cur;
-    cur.reserve(nums.size());
-    for (long long x : nums) {
-      bool ok;
-      Num n = make_num_from_ll_pruned(x, ok);
-      if (!ok)
-        return false;
-      Node nd;
-      nd.num = std::move(n);
-      nd.expr = {to_string(x)};
-      nd.used.fill(0);
-      nd.depth = 0;
-      cur.push_back(std::move(nd));
+    if (mode == MODE_VERIFY) {
+      vector<long long> nums;
+      vector<string> exprs;
+      if (!parse_verify_line(line, nums, exprs) || exprs.empty()) {
+        g_out.message("输入格式错误");
+        continue;
+      }
+      g_out.begin_puzzle(nums);
+      size_t okcnt = 0;
+      for (const string &e : exprs) {
+        VerifyResult r = checker.check(nums, e);
+        okcnt += r.status == VS_OK;
+        g_out.verify(e, r);
+      }
+      g_out.end_puzzle(okcnt > 0, okcnt);
+      continue;
     }
 
-    find_first = true;
-    dfs(cur);
-    if (found)
-      out_expr = first_expr;
-    return found;
-  }
-
-  void solve_all_or_first_normal(const vector<Node> &input,
-                                 bool findFirstOnly) {
-    found = false;
-    first_expr.clear();
-    best_exprs.clear();
-    best_plus.clear();
-    memo.clear();
-    immediate_print = !findFirstOnly;
-    immediate_prefix.clear();
-    expected_leaf_count = (int)input.size();
-
-    vector<Node> cur = input;
-    find_first = findFirstOnly;
-    dfs(cur);
-
-    if (find_first) {
-      if (found && !immediate_print)
-        add_answer(first_expr);
+    if (mode == MODE_HINT) {
+      vector<long long> nums;
+      vector<string> parts;
+      if (!parse_verify_line(line, nums, parts) || nums.empty()) {
+        g_out.message("输入格式错误");
+        continue;
+      }
+      g_out.begin_puzzle(nums);
+      HintResult h = hinter.hint(nums, parts, HINT_LIMIT);
+      if (h.status != VS_OK) {
+        VerifyResult r;
+        r.status = h.status;
+        r.pos = h.pos;
+        g_out.verify(h.part >= 0 ? parts[h.part] : line, r);
+      } else if (h.stage < 0) {
+        g_out.plain("无解\n");
+      } else {
+        g_out.plain("提示（第 " + to_string(h.stage) + " 级" +
+                    (h.complete ? "" : "，未排完") +
+                    (h.cached ? "，缓存" : "") + "，用时 " + to_string(h.us) +
+                    "us）：\n");
+        for (const vector<string> &e : h.completions)
+          g_out.answer(e, cfg.target, "  ");
+      }
+      g_out.end_puzzle(!h.completions.empty(), h.completions.size());
+      continue;
     }
-  }
-};
-
-#ifdef HEGEL_WASM
-static string g_wasm_output;
-static int g_wasm_limit = 0;
-static int g_wasm_count = 0;
-
-static void wasm_reset_output(int limit) {
-  g_wasm_output.clear();
-  g_wasm_limit = limit;
-  g_wasm_count = 0;
-}
 
-static void wasm_append_line(const string &line) {
-  if (g_wasm_limit > 0 && g_wasm_count >= g_wasm_limit)
-    return;
-  g_wasm_output += line;
-  g_wasm_output.push_back('\n');
-  g_wasm_count++;
-}
-#endif
-
-// 打印一条：中缀表达式 = TARGET
-static void print_infix(const vector<string> &expr, const string &prefix) {
-#ifdef HEGEL_WASM
-  (void)prefix;
-  wasm_append_line(rpn_to_infix(expr) + " = " + to_string(TARGET));
-#else
-  cout << prefix << rpn_to_infix(expr) << " = " << TARGET << "\n";
-  cout << flush;
-#endif
-}
-
-#ifdef HEGEL_WASM
-extern "C" {
-EMSCRIPTEN_KEEPALIVE const char *hegel_solve(const char *line, int limit) {
-  static Solver solver;
-  wasm_reset_output(limit);
-  if (!line || !*line)
-    return g_wasm_output.c_str();
-
-  vector<Node> input = Solver::parse_nodes_from_line(string(line));
-  if (input.empty())
-    return g_wasm_output.c_str();
-
-  if (NO_NEGATIVE_INTERMEDIATE) {
-    for (auto &nd : input) {
-      if (nd.num.has_ll && nd.num.ll < 0)
-        return g_wasm_output.c_str();
+    if (mode == MODE_NEAREST) {
+      size_t bar = line.find('|');
+      vector<Node> input =
+          Solver::parse_nodes_from_line(cfg, line.substr(0, bar));
+      long long k = NEAR_MISS_K;
+      if (bar != string::npos) {
+        istringstream iss(line.substr(bar + 1));
+        if (!(iss >> k))
+          k = 0;
+      }
+      if (input.empty() || k <= 0) {
+        g_out.message("输入格式错误");
+        continue;
+      }
+      g_out.begin_puzzle(input_values(input));
+      solver.near.k = (size_t)k;
+      solver.solve_all_or_first_normal(input, false);
+      solver.near.k = 0;
+      if (solver.found) {
+        if (!solver.immediate_print)
+          for (const vector<string> *e : solver.ranked())
+            print_infix(*e, cfg.target, "");
+      } else {
+        g_out.plain(solver.near.best.empty() ? "无解\n"
+                                             : "无解，最接近的：\n");
+        for (const NearMiss::Entry &e : solver.near.best)
+          g_out.near(e);
+      }
+      g_out.end_puzzle(solver.found,
+                       solver.found ? max<size_t>(1, solver.distinct_count())
+                                    : 0);
+      continue;
     }
-  }
-
-  solver.solve_all_or_first_normal(input, false);
-  return g_wasm_output.c_str();
-}
-
-EMSCRIPTEN_KEEPALIVE void hegel_configure(int target, int max_nest,
-                                          int max_sqrt, int max_fact,
-                                          int max_lg, int max_lb, int max_log,
-                                          int no_neg, int only_math) {
-  TARGET = target;
-  MAX_NEST = max_nest;
-  MAX_USE_SQRT = max_sqrt;
-  MAX_USE_FACT = max_fact;
-  MAX_USE_LG = max_lg;
-  MAX_USE_LB = max_lb;
-  MAX_USE_LOG = max_log;
-  NO_NEGATIVE_INTERMEDIATE = (no_neg != 0);
-  ONLY_ARITHMETIC = (only_math != 0);
-
-  TARGET_FACTORS = factorize_small(TARGET);
-  update_max_use_array();
-}
-}
-#endif
 
-// 解析模式命令：random / solution
-static bool parse_mode_cmd(const string &line, bool &toRandom) {
-  if (line == "random") {
-    toRandom = true;
-    return true;
-  }
-  if (line == "solution") {
-    toRandom = false;
-    return true;
-  }
-  return false;
-}
-
-#ifndef HEGEL_WASM
-int main() {
-  ios::sync_with_stdio(false);
-  cin.tie(nullptr);
-
-  Solver solver;
-  bool randomMode = false;
+    if (mode == MODE_BEAM) {
+      size_t bar = line.find('|');
+      vector<Node> input =
+          Solver::parse_nodes_from_line(cfg, line.substr(0, bar));
+      long long ms = BEAM_BUDGET_US / 1000;
+      if (bar != string::npos) {
+        istringstream iss(line.substr(bar + 1));
+        if (!(iss >> ms))
+          ms = 0;
+      }
+      if (input.empty() || ms <= 0) {
+        g_out.message("输入格式错误");
+        continue;
+      }
+      g_out.begin_puzzle(input_values(input));
+      BeamSearch beam(config);
+      BeamResult r = beam.run(input, ms * 1000, ANSWER_TOP_K);
+      g_out.beam(r);
+      if (r.solutions.empty())
+        g_out.plain(r.exhausted ? "无解\n" : "未找到解\n");
+      for (const vector<string> &e : r.solutions)
+        print_infix(e, cfg.target, "");
+      g_out.end_puzzle(r.found > 0, r.found);
+      continue;
+    }
 
-  std::mt19937 rng((unsigned)chrono::high_resolution_clock::now()
-                       .time_since_epoch()
-                       .count());
+    if (mode == MODE_CENSUS) {
+      int N, L, R;
+      string path;
+      istringstream iss(line);
+      if (!(iss >> N >> L >> R) || N <= 0 || L > R) {
+        g_out.message("输入格式错误");
+        continue;
+      }
+      iss >> path;
 
-  while (true) {
-    if (!randomMode) {
-      cout << "请输入数字（输入 random 进入随机模式）：";
-    } else {
-      cout << "输入模拟次数、数字个数、最小值、最大值（输入 solution "
-              "返回解题模式）：";
+      Census census;
+      census.config = config;
+      if (!census.init(N, L, R)) {
+        g_out.message("多重集数量过多");
+        continue;
+      }
+      if (!path.empty() && !census.load(path)) {
+        g_out.message("结果文件的参数与本次不符：" + path);
+        continue;
+      }
+      auto t0 = chrono::steady_clock::now();
+      int threads = max(1u, thread::hardware_concurrency());
+      census.run(threads, path);
+      double secs = chrono::duration<double>(chrono::steady_clock::now() - t0)
+                        .count();
+
+      size_t okcnt = 0;
+      for (size_t i = 0; i < census.sets.size(); i++) {
+        const CensusResult &r = census.results[i];
+        if (r.count > 0)
+          okcnt++;
+        if (path.empty())
+          g_out.message(Census::line_of(census.sets[i], r));
+      }
+      size_t total = census.sets.size();
+      ostringstream os;
+      os << "有解多重集 " << okcnt << "/" << total << "=" << fixed
+         << setprecision(6) << (double)okcnt / total << "，用时 "
+         << setprecision(1) << secs << "s";
+      g_out.message(os.str());
+      g_out.flush();
+      continue;
     }
-    cout << flush;
 
-    string line;
-    if (!getline(cin, line))
-      break;
-    if (line.empty())
-      break;
+    if (mode == MODE_SWEEP) {
+      int T, N, L, R;
+      size_t bar = line.find('|');
+      istringstream iss(line.substr(0, bar));
+      if (!(iss >> T >> N >> L >> R) || T <= 0 || N <= 0 || L > R) {
+        g_out.message("输入格式错误");
+        continue;
+      }
+      SweepGrid grid;
+      if (!SweepGrid::parse(bar == string::npos ? SWEEP_DEFAULT_GRID
+                                                : line.substr(bar + 1),
+                            grid)) {
+        g_out.message("配置网格格式错误");
+        continue;
+      }
 
-    bool toRandom;
-    if (parse_mode_cmd(line, toRandom)) {
-      randomMode = toRandom;
+      auto t0 = chrono::steady_clock::now();
+      ConfigSweep sweep(config, grid);
+      uniform_int_distribution<int> dist(L, R);
+      for (int t = 0; t < T; t++) {
+        vector<long long> nums;
+        nums.reserve(N);
+        for (int i = 0; i < N; i++)
+          nums.push_back(dist(rng));
+        sweep.add(nums);
+      }
+      double secs = chrono::duration<double>(chrono::steady_clock::now() - t0)
+                        .count();
+      for (size_t k = 0; k < sweep.params.size(); k++)
+        g_out.sweep(sweep, k);
+      ostringstream os;
+      os << "共 " << T << " 手，最宽的一格有解 " << sweep.loose_solvable
+         << " 手，" << sweep.params.size() << " 格共用一次求解，用时 " << fixed
+         << setprecision(2) << secs << "s";
+      g_out.message(os.str());
+      g_out.flush();
       continue;
     }
 
-    if (!randomMode) {
-      vector<Node> input = Solver::parse_nodes_from_line(line);
+    if (mode == MODE_SOLUTION) {
+      vector<Node> input = Solver::parse_nodes_from_line(cfg, line);
       if (input.empty()) {
-        cout << "??\n";
+        g_out.message("??");
         continue;
       }
-      if (NO_NEGATIVE_INTERMEDIATE) {
+      if (cfg.no_negative) {
         bool has_neg = false;
         for (auto &nd : input) {
           if (nd.num.has_ll && nd.num.ll < 0) {
@@ -1723,19 +1178,23 @@ int main() {
           }
         }
         if (has_neg) {
-          cout << "??\n";
+          g_out.message("??");
           continue;
         }
       }
 
+      g_out.begin_puzzle(input_values(input));
       solver.solve_all_or_first_normal(input, NORMAL_FIND_FIRST_ONLY);
 
       if (!solver.found) {
-        cout << "无解\n";
+        g_out.plain("无解\n");
       } else if (!solver.immediate_print) {
-        for (auto &kv : solver.best_exprs)
-          print_infix(kv.second);
+        for (const vector<string> *e : solver.ranked())
+          print_infix(*e, cfg.target, "");
       }
+      g_out.end_puzzle(solver.found,
+                       solver.found ? max<size_t>(1, solver.distinct_count())
+                                    : 0);
       continue;
     }
 
@@ -1744,7 +1203,7 @@ int main() {
     {
       istringstream iss(line);
       if (!(iss >> T >> N >> L >> R) || T <= 0 || N <= 0 || L > R) {
-        cout << "输入格式错误\n";
+        g_out.message("输入格式错误");
         continue;
       }
     }
@@ -1759,32 +1218,34 @@ int main() {
         nums.push_back(dist(rng));
 
       // 打印本组数字
-      for (int i = 0; i < N; i++) {
-        cout << nums[i] << (i + 1 == N ? '\n' : ' ');
-      }
-      cout << flush;
+      g_out.begin_puzzle(nums);
+      string echo;
+      for (int i = 0; i < N; i++)
+        echo += to_string(nums[i]) + (i + 1 == N ? '\n' : ' ');
+      g_out.plain(echo);
 
       vector<string> expr;
       bool ok = solver.solve_first(nums, expr);
       if (ok) {
         okcnt++;
       } else {
-        cout << ">>> 无解\n";
+        g_out.plain(">>> 无解\n");
       }
+      g_out.end_puzzle(ok, ok ? 1 : 0);
     }
 
     // 概率：只用分数（不引入浮点）
-    cout << "有解概率为" << okcnt << "/" << T << "=";
+    ostringstream os;
+    os << "有解概率为" << okcnt << "/" << T << "=";
     if (okcnt == 0) {
-      cout << 0 << "\n";
+      os << 0;
     } else if (okcnt == T) {
-      cout << 1 << "\n";
+      os << 1;
     } else {
-      cout << fixed << setprecision(2) << (float)okcnt / T << "\n";
+      os << fixed << setprecision(2) << (float)okcnt / T;
     }
+    g_out.message(os.str());
   }
+  g_out.flush();
   return 0;
 }
-#else
-int main() { return 0; }
-#endif
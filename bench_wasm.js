@@ -0,0 +1,84 @@
+// WASM front-end benchmark: size of hegel.wasm (raw and gzip) and the time to
+// compile and instantiate it. Usage: node bench_wasm.js [hegel.wasm] [rounds]
+// Solver timings are measured natively by hegel_bench (see README). Also
+// reports exports that build:wasm asks for but the build lacks, so numbers
+// taken from a stale build are not mistaken for the current sources.
+const fs = require("fs");
+const path = require("path");
+const zlib = require("zlib");
+
+const file = process.argv[2] || path.join(__dirname, "hegel.wasm");
+const ROUNDS = Math.max(1, Number(process.argv[3]) || 20);
+
+// Exports listed in package.json's build:wasm that the glue code next to the
+// module does not wire up (the .wasm itself only has minified names)
+function missingExports(wasmFile) {
+  const glue = wasmFile.replace(/\.wasm$/, ".js");
+  const pkg = require(path.join(__dirname, "package.json"));
+  const m = /EXPORTED_FUNCTIONS='\[([^\]]*)\]'/.exec(pkg.scripts["build:wasm"]);
+  if (!m || !fs.existsSync(glue)) return null;
+  const text = fs.readFileSync(glue, "utf8");
+  const wanted = m[1].split(",").map((s) => s.trim());
+  return { wanted, missing: wanted.filter((name) => !text.includes(`"${name}"`)) };
+}
+
+function median(xs) {
+  const s = xs.slice().sort((a, b) => a - b);
+  return s[s.length >> 1];
+}
+
+// Every import the module declares, stubbed out. Instantiation only runs the
+// module's start section, so the stubs are never called by the solver itself.
+function stubImports(module) {
+  const imports = {};
+  for (const { module: mod, name, kind } of WebAssembly.Module.imports(module)) {
+    imports[mod] = imports[mod] || {};
+    if (kind === "function") imports[mod][name] = () => 0;
+    else if (kind === "memory")
+      imports[mod][name] = new WebAssembly.Memory({ initial: 256 });
+    else if (kind === "table")
+      imports[mod][name] = new WebAssembly.Table({
+        initial: 0,
+        element: "anyfunc",
+      });
+    else if (kind === "global")
+      imports[mod][name] = new WebAssembly.Global({ value: "i32", mutable: true }, 0);
+  }
+  return imports;
+}
+
+async function main() {
+  const bytes = fs.readFileSync(file);
+  const gz = zlib.gzipSync(bytes, { level: 9 });
+  console.log(`${path.basename(file)}: ${bytes.length} bytes, gzip ${gz.length} bytes`);
+
+  const compileMs = [];
+  let module = null;
+  for (let i = 0; i < ROUNDS; i++) {
+    const t0 = process.hrtime.bigint();
+    module = await WebAssembly.compile(bytes);
+    compileMs.push(Number(process.hrtime.bigint() - t0) / 1e6);
+  }
+  // em++ -O3 minifies export names, so only the count is meaningful
+  const exports = WebAssembly.Module.exports(module);
+  console.log(`compile: median ${median(compileMs).toFixed(2)} ms over ${ROUNDS} rounds`);
+  console.log(`exports: ${exports.length}`);
+  const check = missingExports(file);
+  if (check && check.missing.length > 0)
+    console.log(`stale build: ${check.missing.length} of ${check.wanted.length} ` +
+                `build:wasm exports missing (${check.missing.join(", ")})`);
+
+  const imports = stubImports(module);
+  const instantiateMs = [];
+  for (let i = 0; i < ROUNDS; i++) {
+    const t0 = process.hrtime.bigint();
+    await WebAssembly.instantiate(module, imports);
+    instantiateMs.push(Number(process.hrtime.bigint() - t0) / 1e6);
+  }
+  console.log(`instantiate: median ${median(instantiateMs).toFixed(2)} ms`);
+}
+
+main().catch((err) => {
+  console.error(err.message);
+  process.exit(1);
+});
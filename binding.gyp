@@ -0,0 +1,15 @@
+{
+  "targets": [
+    {
+      "target_name": "hegel",
+      "sources": ["hegel_napi.cpp", "hegel_core.cpp"],
+      "defines": ["NAPI_VERSION=6"],
+      "cflags_cc": ["-std=c++17", "-O3", "-fexceptions"],
+      "xcode_settings": {
+        "CLANG_CXX_LANGUAGE_STANDARD": "c++17",
+        "GCC_ENABLE_CPP_EXCEPTIONS": "YES",
+        "GCC_OPTIMIZATION_LEVEL": "3"
+      }
+    }
+  ]
+}
@@ -6,7 +6,7 @@ if not exist "D:\program files\emsdk\emsdk\emsdk_env.bat" (
 )
 call "D:\program files\emsdk\emsdk\emsdk_env.bat"
 echo Compiling...
-em++ -O3 -s WASM=1 -s "EXPORTED_RUNTIME_METHODS=['cwrap']" -s "EXPORTED_FUNCTIONS=['_hegel_solve','_hegel_configure']" -s MODULARIZE=0 -s ENVIRONMENT=web -s ALLOW_MEMORY_GROWTH=1 -DHEGEL_WASM -o hegel.js "Hegel Infix.cpp"
+em++ -O3 -s WASM=1 -s "EXPORTED_RUNTIME_METHODS=['cwrap']" -s "EXPORTED_FUNCTIONS=['_hegel_solve','_hegel_configure','_hegel_begin','_hegel_step','_hegel_progress','_hegel_end','_hegel_generate','_hegel_solve_targets','_hegel_set_memory_budget','_hegel_memory_peak','_hegel_truncated','_hegel_estimate','_hegel_count','_hegel_verify','_hegel_hint','_hegel_beam','_hegel_session_reset','_hegel_session_speculate','_hegel_session_push','_hegel_session_remove','_hegel_session_set','_hegel_session_idle','_hegel_session_solve','_hegel_set_near_miss','_hegel_near_misses']" -s MODULARIZE=0 -s ENVIRONMENT=web -s ALLOW_MEMORY_GROWTH=1 -o hegel.js hegel_core.cpp hegel_wasm.cpp
 if %errorlevel% neq 0 (
     echo Compilation failed!
     pause
@@ -11,6 +11,7 @@ const cardCountSelect = document.getElementById("card-count");
 const maxNumberInput = document.getElementById("max-number");
 const minNumberInput = document.getElementById("min-number");
 const randomBtn = document.getElementById("random-btn");
+const difficultySelect = document.getElementById("difficulty-select");
 const rulesBtn = document.getElementById("rules-btn");
 const rulesContainer = document.querySelector(".rules-container");
 const exampleButtons = document.querySelectorAll(".example-btn");
@@ -54,12 +55,55 @@ const maxFactInput = document.getElementById("max-fact");
 const maxLgInput = document.getElementById("max-lg");
 const maxLbInput = document.getElementById("max-lb");
 const maxLogInput = document.getElementById("max-log");
+const maxPowInput = document.getElementById("max-pow");
+const maxCatInput = document.getElementById("max-cat");
 const noNegInput = document.getElementById("no-neg");
 const onlyMathInput = document.getElementById("only-math");
 
 let wasmSolve = null;
 let wasmConfig = null;
 let wasmReady = false;
+// Stepped solving (hegel_begin / hegel_step / hegel_end); null on older builds
+let wasmStepper = null;
+// Batched puzzle generator (hegel_generate); null on older builds
+let wasmGenerate = null;
+// Solve ended early because it hit the memory budget; null on older builds
+let wasmTruncated = null;
+// Closest values when a hand has no solution (hegel_near_misses); null on older builds
+let wasmNearMisses = null;
+// Incremental pre-solve session (hegel_session_*); null on older builds
+let wasmSession = null;
+// Heuristic search for hands too large to exhaust (hegel_beam); null on older builds
+let wasmBeam = null;
+// Numbers currently mirrored into the session, and the pending idle callback
+let sessionNumbers = [];
+let sessionIdleHandle = 0;
+let puzzleQueue = [];
+let puzzleQueueKey = "";
+
+// Puzzles per hegel_generate call; rated (difficulty) batches are slower
+const PUZZLE_BATCH = 50;
+const RATED_PUZZLE_BATCH = 5;
+let runId = 0;
+
+// Budget per slice: keep each slice well under one frame
+const SLICE_STATES = 20000;
+const SLICE_US = 12000;
+
+// Budget per idle callback while pre-building session tables
+const IDLE_US = 8000;
+// Closest values shown for an unsolvable hand
+const NEAR_MISS_COUNT = 5;
+// Assumed hand size for speculating on the last number
+const SESSION_HAND = 4;
+
+// Hands above MAX_EXACT_NUMBERS go to the beam search, which stops after BEAM_MS
+const MAX_EXACT_NUMBERS = 8;
+const MAX_BEAM_NUMBERS = 12;
+const BEAM_MS = 1000;
+
+// Per-solve memory ceiling inside the WASM heap (KB)
+const MEMORY_BUDGET_KB = 256 * 1024;
 
 function parseNumbers(value) {
   return value
@@ -95,7 +139,12 @@ function tokenize(expr) {
       i += 1;
       continue;
     }
-    if (ch === "(" || ch === ")" || ch === "," || ch === "!" || ch === "+" || ch === "*" || ch === "/") {
+    if (ch === "|" && expr[i + 1] === "|") {
+      tokens.push({ type: "symbol", value: "||" });
+      i += 2;
+      continue;
+    }
+    if (ch === "(" || ch === ")" || ch === "," || ch === "!" || ch === "+" || ch === "*" || ch === "/" || ch === "^") {
       tokens.push({ type: "symbol", value: ch });
       i += 1;
       continue;
@@ -105,7 +154,7 @@ function tokenize(expr) {
       const next = expr[i + 1];
       const unary =
         !prev ||
-        (prev.type === "symbol" && (prev.value === "(" || prev.value === "," || "+-*/".includes(prev.value)));
+        (prev.type === "symbol" && (prev.value === "(" || prev.value === "," || "+-*/^".includes(prev.value)));
       if (unary && next && isDigit(next)) {
         let j = i + 1;
         while (j < expr.length && isDigit(expr[j])) j += 1;
@@ -162,16 +211,31 @@ function parseToAst(tokens) {
   }
 
   function parseTerm() {
-    let node = parseFactor();
+    let node = parsePower();
     while (peek() && peek().type === "symbol" && (peek().value === "*" || peek().value === "/")) {
       const op = peek().value;
       idx += 1;
-      const right = parseFactor();
+      const right = parsePower();
       node = { type: "binary", op, left: node, right };
     }
     return node;
   }
 
+  // a ^ b is right-associative and binds tighter than * /
+  function parsePower() {
+    const node = parseConcat();
+    if (!match("^")) return node;
+    return { type: "binary", op: "^", left: node, right: parsePower() };
+  }
+
+  function parseConcat() {
+    let node = parseFactor();
+    while (match("||")) {
+      node = { type: "binary", op: "||", left: node, right: parseFactor() };
+    }
+    return node;
+  }
+
   function parseFactor() {
     let node = parsePrimary();
     while (peek() && peek().type === "symbol" && peek().value === "!") {
@@ -222,6 +286,7 @@ function toLatex(node) {
     if (n.type === "binary") {
       if (n.op === "+" || n.op === "-") return 1;
       if (n.op === "*" || n.op === "/") return 2;
+      return 3;
     }
     if (n.type === "factorial" || n.type === "func") return 3;
     return 4;
@@ -229,11 +294,20 @@ function toLatex(node) {
 
   const wrapIf = (child, minPrec) => {
     const latex = toLatex(child);
-    return prec(child) < minPrec ? `\\left(${latex}\\right)` : latex;
+    const cat = child && child.type === "binary" && child.op === "||";
+    return cat || prec(child) < minPrec ? `\\left(${latex}\\right)` : latex;
   };
 
   if (node.type === "number") return node.value;
   if (node.type === "binary") {
+    if (node.op === "^") {
+      // Parenthesize the same bases the solver does: operators and negative numbers
+      const left = node.left;
+      const bare = left.type !== "binary" && !(left.type === "number" && left.value.startsWith("-"));
+      const base = bare ? toLatex(left) : `\\left(${toLatex(left)}\\right)`;
+      return `{${base}}^{${toLatex(node.right)}}`;
+    }
+    if (node.op === "||") return `${toLatex(node.left)} \\mathbin{\\|} ${toLatex(node.right)}`;
     if (node.op === "/") {
       const num = toLatex(node.left);
       const den = toLatex(node.right);
@@ -277,7 +351,8 @@ function infixToLatex(expr) {
   }
 }
 
-function renderSolutions(lines) {
+// rhs: optional right-hand side (LaTeX) per line; defaults to "= target"
+function renderSolutions(lines, rhs) {
   output.innerHTML = "";
   if (!lines.length) {
     emptyState.hidden = false;
@@ -298,7 +373,8 @@ function renderSolutions(lines) {
 
     try {
       const targetVal = targetInput.value || "24";
-      window.katex.render(infixToLatex(expr) + " = " + targetVal, math, {
+      const right = rhs ? rhs[index] : " = " + targetVal;
+      window.katex.render(infixToLatex(expr) + right, math, {
         displayMode: true,
         throwOnError: false,
         strict: "ignore"
@@ -331,8 +407,41 @@ function initWasm() {
     return;
   }
   wasmSolve = Module.cwrap("hegel_solve", "string", ["string", "number"]);
-  // void hegel_configure(int target, int max_nest, int max_sqrt, int max_fact, int max_lg, int max_lb, int max_log, int no_neg, int only_math)
-  wasmConfig = Module.cwrap("hegel_configure", "void", ["number", "number", "number", "number", "number", "number", "number", "number", "number"]);
+  // void hegel_configure(int target, int max_nest, int max_sqrt, int max_fact, int max_lg, int max_lb, int max_log, int no_neg, int only_math, int max_pow, int max_cat)
+  wasmConfig = Module.cwrap("hegel_configure", "void", ["number", "number", "number", "number", "number", "number", "number", "number", "number", "number", "number"]);
+  if (Module._hegel_begin && Module._hegel_step && Module._hegel_end) {
+    wasmStepper = {
+      begin: Module.cwrap("hegel_begin", "number", ["string", "number"]),
+      step: Module.cwrap("hegel_step", "number", ["number", "number"]),
+      progress: Module.cwrap("hegel_progress", "number", []),
+      end: Module.cwrap("hegel_end", "string", [])
+    };
+  }
+  if (Module._hegel_set_memory_budget && Module._hegel_truncated) {
+    Module.cwrap("hegel_set_memory_budget", null, ["number"])(MEMORY_BUDGET_KB);
+    wasmTruncated = Module.cwrap("hegel_truncated", "number", []);
+  }
+  if (Module._hegel_set_near_miss && Module._hegel_near_misses) {
+    Module.cwrap("hegel_set_near_miss", null, ["number"])(NEAR_MISS_COUNT);
+    wasmNearMisses = Module.cwrap("hegel_near_misses", "string", []);
+  }
+  if (Module._hegel_session_reset && Module._hegel_session_solve) {
+    wasmSession = {
+      reset: Module.cwrap("hegel_session_reset", null, ["number"]),
+      push: Module.cwrap("hegel_session_push", "number", ["number"]),
+      remove: Module.cwrap("hegel_session_remove", "number", ["number"]),
+      set: Module.cwrap("hegel_session_set", "number", ["number", "number"]),
+      idle: Module.cwrap("hegel_session_idle", "number", ["number"]),
+      solve: Module.cwrap("hegel_session_solve", "string", ["number"])
+    };
+    wasmSession.reset(SESSION_HAND);
+  }
+  if (Module._hegel_beam) {
+    wasmBeam = Module.cwrap("hegel_beam", "string", ["string", "number", "number"]);
+  }
+  if (Module._hegel_generate) {
+    wasmGenerate = Module.cwrap("hegel_generate", "string", ["number", "number", "number", "number", "number"]);
+  }
   wasmReady = true;
   setStatus("WASM 已就绪。输入数字开始计算。");
 }
@@ -351,6 +460,50 @@ function attachWasmReady() {
   }
 }
 
+// Mirror the typed numbers into the session with the smallest edit, then
+// keep building tables in idle time
+function syncSession() {
+  if (!wasmSession) return;
+  const next = parseNumbers(input.value);
+  if (next.length > MAX_EXACT_NUMBERS) return;
+  configureWasm();
+  let i = 0;
+  while (i < sessionNumbers.length && i < next.length && sessionNumbers[i] === next[i]) i += 1;
+  if (sessionNumbers.length === next.length && i < next.length) {
+    // Same count: usually a single number being edited in place
+    for (let k = i; k < next.length; k += 1) {
+      if (sessionNumbers[k] !== next[k]) wasmSession.set(k, next[k]);
+    }
+  } else {
+    for (let k = sessionNumbers.length - 1; k >= i; k -= 1) wasmSession.remove(k);
+    for (let k = i; k < next.length; k += 1) wasmSession.push(next[k]);
+  }
+  sessionNumbers = next;
+  scheduleSessionIdle();
+}
+
+function scheduleSessionIdle() {
+  if (sessionIdleHandle || !window.requestIdleCallback) return;
+  sessionIdleHandle = requestIdleCallback((deadline) => {
+    sessionIdleHandle = 0;
+    const us = Math.min(IDLE_US, Math.floor(deadline.timeRemaining() * 1000));
+    if (wasmSession.idle(Math.max(us, 1000)) > 0) scheduleSessionIdle();
+  });
+}
+
+// Fast first answers from the session's pre-built tables; the full stepped
+// search then replaces them
+function showSessionPreview(numbers, limit) {
+  if (!wasmSession || numbers.join(" ") !== sessionNumbers.join(" ")) return;
+  const raw = wasmSession.solve(limit) || "";
+  const nl = raw.indexOf("\n");
+  const lines = parseOutput(nl >= 0 ? raw.slice(nl + 1) : "");
+  if (!lines.length) return;
+  updateCount(lines.length);
+  renderSolutions(lines);
+  setStatus("已显示预求解结果，正在求全部解…");
+}
+
 // Solves the puzzle for given numbers string, returning array of solution lines or empty array
 function getSolutions(numbersStr, limitVal) {
   if (!wasmReady || !wasmSolve) return [];
@@ -363,6 +516,110 @@ function getSolutions(numbersStr, limitVal) {
   }
 }
 
+function configureWasm() {
+  if (!wasmConfig) return;
+  wasmConfig(
+    parseInt(targetInput.value) || 24,
+    parseInt(maxNestInput.value) || 4,
+    parseInt(maxSqrtInput.value) || 0, // default 0 if empty/nan, but HTML default is 2
+    parseInt(maxFactInput.value) || 0,
+    parseInt(maxLgInput.value) || 0,
+    parseInt(maxLbInput.value) || 0,
+    parseInt(maxLogInput.value) || 0,
+    noNegInput.checked ? 1 : 0,
+    onlyMathInput.checked ? 1 : 0,
+    parseInt(maxPowInput.value) || 0,
+    parseInt(maxCatInput.value) || 0
+  );
+}
+
+function showResult(lines, limit) {
+  updateCount(lines.length);
+  renderSolutions(lines);
+
+  if (!lines.length) {
+    setStatus("没有找到解。请尝试调整数字。");
+    showNearMisses();
+  } else {
+    const tip = lines.length >= limit ? "（已截断显示）" : "";
+    setStatus(`完成，找到 ${lines.length} 条 ${tip}`.trim());
+  }
+  if (wasmTruncated && wasmTruncated()) {
+    setStatus(`${status.textContent}（超出内存预算，结果可能不完整）`);
+  }
+}
+
+// Lines are "value|distance|infix"; huge values come as "≈2^x" with no distance
+function showNearMisses() {
+  if (!wasmNearMisses) return;
+  const exprs = [];
+  const rhs = [];
+  (wasmNearMisses() || "").split(/\r?\n/).filter(Boolean).forEach((line) => {
+    const a = line.indexOf("|");
+    const b = line.indexOf("|", a + 1);
+    if (a < 0 || b < 0) return;
+    const value = line.slice(0, a);
+    exprs.push(line.slice(b + 1));
+    rhs.push(value.startsWith("≈")
+      ? ` \\approx ${value.slice(1).replace(/\^(.*)$/, "^{$1}")}`
+      : ` = ${value}`);
+  });
+  if (!exprs.length) return;
+  renderSolutions(exprs, rhs);
+  setStatus(`没有找到解。下面是最接近 ${targetInput.value || "24"} 的 ${exprs.length} 个值。`);
+}
+
+// First line is "exhausted|rounds|width|states|firstUs|us", then solutions
+function solveBeam(line, limit) {
+  const raw = wasmBeam(line, BEAM_MS, limit) || "";
+  const exhausted = raw.split("|")[0] === "1";
+  const lines = parseOutput(raw);
+  updateCount(lines.length);
+  renderSolutions(lines);
+  if (lines.length) {
+    const note = exhausted ? "" : "，数字较多，用启发式搜索，未必是全部";
+    setStatus(`完成，找到 ${lines.length} 条${note}`);
+  } else {
+    setStatus(exhausted ? "没有找到解。请尝试调整数字。" : `${BEAM_MS / 1000} 秒内没有找到解（数字较多，未穷尽）。`);
+  }
+}
+
+// Abandon any stepped solve still in flight
+function cancelRun() {
+  runId += 1;
+  solveBtn.disabled = false;
+}
+
+// Runs the search in short slices so the page stays responsive
+function solveStepped(line, limit) {
+  const id = ++runId;
+  if (!wasmStepper.begin(line, limit)) {
+    wasmStepper.end();
+    showResult([], limit);
+    solveBtn.disabled = false;
+    return;
+  }
+
+  const tick = () => {
+    if (id !== runId) return;
+    try {
+      const done = wasmStepper.step(SLICE_STATES, SLICE_US);
+      if (!done) {
+        const pct = Math.floor(wasmStepper.progress() * 100);
+        setStatus(`计算中，请稍候… ${pct}%`);
+        setTimeout(tick, 0);
+        return;
+      }
+      showResult(parseOutput(wasmStepper.end() || ""), limit);
+    } catch (err) {
+      setStatus(`出错：${err.message}`);
+      clearOutput();
+    }
+    solveBtn.disabled = false;
+  };
+  setTimeout(tick, 0);
+}
+
 function solve() {
   if (!wasmReady || !wasmSolve) {
     setStatus("WASM 尚未就绪，请稍候。", "warn");
@@ -370,56 +627,47 @@ function solve() {
   }
 
   const numbers = parseNumbers(input.value);
-  if (numbers.length < 2 || numbers.length > 8) {
-    setStatus("请输入 2~8 个整数。", "warn");
+  const maxNumbers = wasmBeam ? MAX_BEAM_NUMBERS : MAX_EXACT_NUMBERS;
+  if (numbers.length < 2 || numbers.length > maxNumbers) {
+    setStatus(`请输入 2~${maxNumbers} 个整数。`, "warn");
     clearOutput();
     return;
   }
 
+  cancelRun();
   setStatus("计算中，请稍候…");
   solveBtn.disabled = true;
 
   // Use a timeout to allow UI to update (show "Calculation...") before heavy work
   setTimeout(() => {
-      try {
-        // Configure WASM before solve
-        if (wasmConfig) {
-            wasmConfig(
-                parseInt(targetInput.value) || 24,
-                parseInt(maxNestInput.value) || 4,
-                parseInt(maxSqrtInput.value) || 0, // default 0 if empty/nan, but HTML default is 2
-                parseInt(maxFactInput.value) || 0,
-                parseInt(maxLgInput.value) || 0,
-                parseInt(maxLbInput.value) || 0,
-                parseInt(maxLogInput.value) || 0,
-                noNegInput.checked ? 1 : 0,
-                onlyMathInput.checked ? 1 : 0
-            );
-        }
+    try {
+      // Configure WASM before solve
+      configureWasm();
 
-        const line = numbers.join(" ");
+      const line = numbers.join(" ");
       const limit = Number(limitSelect.value);
-      const lines = getSolutions(line, limit);
-
-      updateCount(lines.length);
-      renderSolutions(lines);
-
-      if (!lines.length) {
-        setStatus("没有找到解。请尝试调整数字。");
-      } else {
-        const tip = lines.length >= limit ? "（已截断显示）" : "";
-        setStatus(`完成，找到 ${lines.length} 条 ${tip}`.trim());
+      if (numbers.length > MAX_EXACT_NUMBERS) {
+        solveBeam(line, limit);
+        solveBtn.disabled = false;
+        return;
+      }
+      if (wasmStepper) {
+        showSessionPreview(numbers, limit);
+        solveStepped(line, limit);
+        return;
       }
+
+      showResult(getSolutions(line, limit), limit);
     } catch (err) {
       setStatus(`出错：${err.message}`);
       clearOutput();
-    } finally {
-      solveBtn.disabled = false;
     }
+    solveBtn.disabled = false;
   }, 10);
 }
 
 solveBtn.addEventListener("click", solve);
+input.addEventListener("input", syncSession);
 input.addEventListener("keydown", (event) => {
   if (event.key === "Enter") {
     event.preventDefault();
@@ -436,6 +684,27 @@ exampleButtons.forEach((btn) => {
 
 
 
+// Next puzzle from the generator queue, refilled one batch at a time
+function nextPuzzle(count, min, max, band) {
+  const key = [count, min, max, band, targetInput.value, maxNestInput.value, maxSqrtInput.value,
+    maxFactInput.value, maxLgInput.value, maxLbInput.value, maxLogInput.value,
+    maxPowInput.value, maxCatInput.value, noNegInput.checked, onlyMathInput.checked].join(",");
+  if (key !== puzzleQueueKey) {
+    puzzleQueue = [];
+    puzzleQueueKey = key;
+  }
+  if (!puzzleQueue.length) {
+    configureWasm();
+    const batch = band < 0 ? PUZZLE_BATCH : RATED_PUZZLE_BATCH;
+    const raw = wasmGenerate(batch, count, min, max, band) || "";
+    puzzleQueue = raw
+      .split(/\r?\n/)
+      .filter(Boolean)
+      .map((line) => line.split("|")[0].split(" ").map(Number));
+  }
+  return puzzleQueue.shift() || null;
+}
+
 // Smart Random Generator
 randomBtn.addEventListener("click", () => {
   if (!wasmReady) {
@@ -446,6 +715,9 @@ randomBtn.addEventListener("click", () => {
   const count = parseInt(cardCountSelect.value, 10) || 4;
   const max = parseInt(maxNumberInput.value, 10) || 13;
 
+  // The existence checks below share the solver output buffer
+  cancelRun();
+
   // Attempt to find a solvable puzzle (max 10 retries)
   const MAX_RETRIES = 10;
   let candidates = [];
@@ -457,15 +729,24 @@ randomBtn.addEventListener("click", () => {
 
   // Async to let UI render the loading state
   setTimeout(() => {
-    for (let attempt = 0; attempt < MAX_RETRIES; attempt++) {
-      const nums = [];
-      const minVal = parseInt(minNumberInput.value, 10) || 1;
-      const maxVal = parseInt(maxNumberInput.value, 10) || 80; // Default to 80 as requested
-      
-      // Validation: Ensure min <= max
-      const actualMin = Math.min(minVal, maxVal);
-      const actualMax = Math.max(minVal, maxVal);
+    const minVal = parseInt(minNumberInput.value, 10) || 1;
+    const maxVal = parseInt(maxNumberInput.value, 10) || 80; // Default to 80 as requested
+
+    // Validation: Ensure min <= max
+    const actualMin = Math.min(minVal, maxVal);
+    const actualMax = Math.max(minVal, maxVal);
+
+    if (wasmGenerate) {
+      const band = parseInt(difficultySelect.value, 10);
+      const puzzle = nextPuzzle(count, actualMin, actualMax, Number.isInteger(band) ? band : -1);
+      if (puzzle) {
+        candidates = puzzle;
+        foundSolvable = true;
+      }
+    }
 
+    for (let attempt = 0; !foundSolvable && attempt < MAX_RETRIES; attempt++) {
+      const nums = [];
       for (let i = 0; i < count; i++) {
         nums.push(Math.floor(Math.random() * (actualMax - actualMin + 1)) + actualMin);
       }
@@ -0,0 +1,255 @@
+// 基准测试前端：对固定的一组题目测量启动（默认配置的派生数据）、找一个解、
+// 求全部解与解计数的用时，放宽函数次数时支配剪枝关 / 开的对比，找一个解时
+// 走法排序关 / 开的对比，没有已做部分时提示的用时，以及束搜索相对精确求解
+// 的命中率，与 hegel_core.cpp 一起编译：
+//   g++ -std=c++17 -O3 -pthread hegel_bench.cpp hegel_core.cpp -o hegel_bench
+//   ./hegel_bench [轮数，默认 1；整套一轮约半分钟]
+// 每项取各轮的最短用时。跨查询置换表在进程内保留，第二轮起找一个解走的是
+// 已建好的子表（与服务器常驻时相同）。WASM 的体积与实例化用时见
+// bench_wasm.js。
+#include "hegel_core.h"
+
+#include <cstdio>
+#include <random>
+
+// 题目：4 个数的各类（常见、只有一个解、无解），以及 5、6 个数
+static const char *const BENCH_HANDS[] = {
+    "3 3 8 8", "1 5 5 5", "4 4 10 10", "1 1 1 1", "13 13 13 13",
+    "2 3 4 5 6", "1 2 7 7 9", "3 5 7 11 13", "1 2 3 4 5 6", "2 2 9 9 11 13"};
+// 超过这么多个数的题目不求全部解（一次要几分钟）
+static const size_t BENCH_FIND_ALL_MAX = 5;
+// 支配剪枝对比：函数次数放宽后找一个解，题目要走到 DFS（可达表答不出）
+static const char *const BENCH_DOMINANCE_HANDS[] = {
+    "7 7 7 7 7", "1 1 1 1 1 1", "1 1 1 1 1 1 1"};
+// 走法排序对比：找一个解要走 DFS 的题目（7、8 个数超出可达表的拆分，
+// 以及放宽函数次数的支配剪枝题目）；固定顺序最多走这么多个状态
+static const char *const BENCH_ORDERING_HANDS[] = {
+    "1 2 3 4 5 6 7", "13 13 13 13 13 13 13", "2 3 4 5 6 7 8 9",
+    "1 1 2 2 3 3 4 4"};
+static const long long BENCH_ORDERING_CAP = 5000;
+// 束搜索命中率：每种个数随机抽这么多手（1~13，种子固定），每手的时限
+static const int BENCH_BEAM_HANDS = 50;
+static const long long BENCH_BEAM_US = 20000;
+// 只跑束搜索的大题个数（精确求解跑不动）
+static const int BENCH_BEAM_LARGE[] = {10, 12};
+
+typedef chrono::steady_clock bench_clock;
+
+static long long us_since(bench_clock::time_point t0) {
+  return chrono::duration_cast<chrono::microseconds>(bench_clock::now() - t0)
+      .count();
+}
+
+int main(int argc, char **argv) {
+  int rounds = argc > 1 ? max(1, atoi(argv[1])) : 1;
+
+  // 启动：第一次取默认配置时算出的派生数据（阶乘反查表、缓存键等）
+  bench_clock::time_point t0 = bench_clock::now();
+  const ConfigPtr &config = default_config();
+  long long startup_us = us_since(t0);
+  long long config_us = LLONG_MAX;
+  for (int r = 0; r < rounds; r++) {
+    t0 = bench_clock::now();
+    make_config(SolverConfig());
+    config_us = min(config_us, us_since(t0));
+  }
+  printf("启动 %lldus，make_config %lldus\n", startup_us, config_us);
+  printf("%-16s %12s %12s %10s %8s %12s %8s\n", "题目", "找一个(us)",
+         "全部解(us)", "状态", "解数", "计数(us)", "计数");
+
+  long long total_first = 0, total_all = 0, total_count = 0;
+  for (const char *hand : BENCH_HANDS) {
+    vector<Node> input = Solver::parse_nodes_from_line(*config, hand);
+    vector<long long> nums;
+    for (const Node &nd : input)
+      nums.push_back(nd.num.ll);
+
+    long long first_us = LLONG_MAX, all_us = LLONG_MAX, count_us = LLONG_MAX;
+    long long states = -1;
+    long long solutions = -1;
+    size_t counted = 0;
+    for (int r = 0; r < rounds; r++) {
+      Solver solver;
+      solver.config = config;
+      t0 = bench_clock::now();
+      solver.begin(input, true, false);
+      solver.step();
+      solver.finish();
+      first_us = min(first_us, us_since(t0));
+
+      if (nums.size() <= BENCH_FIND_ALL_MAX) {
+        Solver all;
+        all.config = config;
+        all.count_distinct = true;
+        t0 = bench_clock::now();
+        all.begin(input, false, false);
+        all.step();
+        all.finish();
+        all_us = min(all_us, us_since(t0));
+        states = all.states;
+        solutions = (long long)all.distinct_count();
+      }
+
+      SolutionCounter counter(config);
+      t0 = bench_clock::now();
+      counted = counter.count(nums).forms;
+      count_us = min(count_us, us_since(t0));
+    }
+    total_first += first_us;
+    total_count += count_us;
+    if (states >= 0)
+      total_all += all_us;
+    if (states >= 0)
+      printf("%-16s %12lld %12lld %10lld %8lld %12lld %8zu\n", hand, first_us,
+             all_us, states, solutions, count_us, counted);
+    else
+      printf("%-16s %12lld %12s %10s %8s %12lld %8zu\n", hand, first_us, "-",
+             "-", "-", count_us, counted);
+  }
+  printf("%-16s %12lld %12lld %10s %8s %12lld\n", "合计", total_first,
+         total_all, "", "", total_count);
+
+  SolverConfig loose;
+  loose.max_use = {3, 3, 2, 3, 2, 0, 0};
+  loose.max_nest = 5;
+  ConfigPtr loose_config = make_config(loose);
+  printf("\n支配剪枝（sqrt/!/lb 各 3 次，lg/log 各 2 次，嵌套 5 层，找一个解）\n");
+  printf("%-16s %10s %12s %10s %12s\n", "题目", "关:状态", "关(us)", "开:状态",
+         "开(us)");
+  for (const char *hand : BENCH_DOMINANCE_HANDS) {
+    vector<Node> input = Solver::parse_nodes_from_line(*loose_config, hand);
+    long long states[2] = {0, 0}, us[2] = {LLONG_MAX, LLONG_MAX};
+    for (int r = 0; r < rounds; r++)
+      for (int on = 0; on < 2; on++) {
+        Solver solver;
+        solver.config = loose_config;
+        solver.dominance = on;
+        t0 = bench_clock::now();
+        solver.begin(input, true, false);
+        solver.step();
+        solver.finish();
+        us[on] = min(us[on], us_since(t0));
+        states[on] = solver.states;
+      }
+    printf("%-16s %10lld %12lld %10lld %12lld\n", hand, states[0], us[0],
+           states[1], us[1]);
+  }
+
+  // 走法排序：“冷”为清空 history 后只靠目标导向的静态分，“热”为带着此前
+  // 各次求解（含本题的冷启动）学到的 history。固定顺序超出状态上限时记为
+  // “>上限”
+  printf("\n走法排序（找一个解，固定顺序至多 %lld 个状态）\n",
+         BENCH_ORDERING_CAP);
+  printf("%-22s %10s %12s %10s %12s %10s %12s\n", "题目", "固定:状态",
+         "固定(us)", "冷:状态", "冷(us)", "热:状态", "热(us)");
+  auto ordering_row = [&](const ConfigPtr &cfg, const char *hand,
+                          const char *label) {
+    vector<Node> input = Solver::parse_nodes_from_line(*cfg, hand);
+    long long states[3] = {0, 0, 0}, us[3] = {LLONG_MAX, LLONG_MAX, LLONG_MAX};
+    bool capped = false;
+    for (int r = 0; r < rounds; r++)
+      for (int mode = 0; mode < 3; mode++) {
+        if (mode == 1)
+          reset_move_history();
+        Solver solver;
+        solver.config = cfg;
+        solver.move_ordering = mode > 0;
+        t0 = bench_clock::now();
+        solver.begin(input, true, false);
+        bool done = solver.step(mode == 0 ? BENCH_ORDERING_CAP : 0);
+        solver.finish();
+        us[mode] = min(us[mode], us_since(t0));
+        states[mode] = solver.states;
+        if (mode == 0)
+          capped = !done && !solver.found;
+      }
+    string fixed = capped ? ">" + to_string(BENCH_ORDERING_CAP)
+                          : to_string(states[0]);
+    printf("%-22s %10s %12lld %10lld %12lld %10lld %12lld\n", label,
+           fixed.c_str(), us[0], states[1], us[1], states[2], us[2]);
+  };
+  for (const char *hand : BENCH_ORDERING_HANDS)
+    ordering_row(config, hand, hand);
+  for (const char *hand : BENCH_DOMINANCE_HANDS)
+    ordering_row(loose_config, hand, (string(hand) + "（放宽）").c_str());
+
+  // 提示：没有已做部分，即发牌后就要提示。每轮换一个新引擎，不走提示缓存；
+  // “排完”为首次请求是否在 HINT_BUDGET_US 内比较了那一级的全部解，没排完时
+  // 再用 idle 排完（前端在空闲时做的预先计算），之后同样的请求命中缓存
+  printf("\n提示（没有已做部分，保留 %d 个，预算 %lldus）\n", HINT_LIMIT,
+         HINT_BUDGET_US);
+  printf("%-16s %6s %12s %6s %12s %12s\n", "题目", "级别", "首次(us)", "排完",
+         "排完(us)", "再次(us)");
+  for (const char *hand : BENCH_HANDS) {
+    vector<long long> nums;
+    vector<string> parts;
+    if (!parse_verify_line(hand, nums, parts) ||
+        nums.size() > BENCH_FIND_ALL_MAX)
+      continue;
+    long long first_us = LLONG_MAX, idle_us = LLONG_MAX, again_us = LLONG_MAX;
+    HintResult h, again;
+    for (int r = 0; r < rounds; r++) {
+      HintEngine engine(config);
+      t0 = bench_clock::now();
+      h = engine.hint(nums, parts, HINT_LIMIT);
+      first_us = min(first_us, us_since(t0));
+      t0 = bench_clock::now();
+      engine.idle(0);
+      idle_us = min(idle_us, us_since(t0));
+      t0 = bench_clock::now();
+      again = engine.hint(nums, parts, HINT_LIMIT);
+      again_us = min(again_us, us_since(t0));
+    }
+    printf("%-16s %6d %12lld %6s %12lld %12lld%s\n", hand, h.stage, first_us,
+           h.complete ? "是" : "否", idle_us, again_us,
+           again.stage < 0 || again.complete ? "" : "（仍未排完）");
+  }
+
+  // 束搜索：命中率为精确求解有解的题目中束搜索在时限内找到解的比例；
+  // 大题不跑精确求解，“有解”一栏即手数
+  printf("\n束搜索（每手时限 %lldus，%d 手）\n", BENCH_BEAM_US,
+         BENCH_BEAM_HANDS);
+  printf("%-6s %8s %8s %14s %14s %8s\n", "个数", "有解", "命中",
+         "首解均值(us)", "精确均值(us)", "穷尽");
+  mt19937 rng(2024);
+  uniform_int_distribution<int> card(1, 13);
+  for (int n = 4; n <= 12; n++) {
+    bool large = find(begin(BENCH_BEAM_LARGE), end(BENCH_BEAM_LARGE), n) !=
+                 end(BENCH_BEAM_LARGE);
+    if (n > 6 && !large)
+      continue;
+    int solvable = 0, hit = 0, exhausted = 0;
+    long long first_sum = 0, exact_sum = 0;
+    for (int t = 0; t < BENCH_BEAM_HANDS; t++) {
+      string line;
+      for (int i = 0; i < n; i++)
+        line += to_string(card(rng)) + " ";
+      vector<Node> input = Solver::parse_nodes_from_line(*config, line);
+      bool exact_found = true;
+      if (!large) {
+        Solver solver;
+        solver.config = config;
+        t0 = bench_clock::now();
+        solver.begin(input, true, false);
+        solver.step();
+        solver.finish();
+        exact_sum += us_since(t0);
+        exact_found = solver.found;
+      }
+      BeamSearch beam(config);
+      BeamResult r = beam.run(input, BENCH_BEAM_US, 1);
+      exhausted += r.exhausted;
+      if (!exact_found)
+        continue;
+      solvable++;
+      if (r.found) {
+        hit++;
+        first_sum += r.first_us;
+      }
+    }
+    string exact_avg = large ? "-" : to_string(exact_sum / BENCH_BEAM_HANDS);
+    printf("%-6d %8d %8d %14lld %14s %8d\n", n, solvable, hit,
+           hit ? first_sum / hit : -1, exact_avg.c_str(), exhausted);
+  }
+  return 0;
+}
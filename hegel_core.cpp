@@ -0,0 +1,4337 @@
+// 求解核心库的实现：数值运算、规范形、运算符表、搜索、出题、可达表与置换表、
+// 计数、校验、提示、增量预求解、参数扫描与束搜索（声明与说明见 hegel_core.h）。
+// 随机数与线程同步只在这里用到，头文件不引入 <random>、<mutex>、<atomic>
+#include "hegel_core.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <tuple>
+
+// ======================= 规范形哈希 =======================
+Canon canon_leaf(const string &tok) {
+  bool minus = tok.size() > 1 && tok[0] == '-';
+  uint64_t h = 0;
+  for (size_t i = minus ? 1 : 0; i < tok.size(); i++)
+    h = canon_mix(h ^ (unsigned char)tok[i]);
+  Canon c;
+  c.key = canon_tag(CANON_LEAF, h);
+  if (minus)
+    c.key = canon_neg(c.key);
+  return c;
+}
+
+Canon canon_apply1(int op, const Canon &a) {
+  Canon c;
+  c.key = canon_tag(op, a.key);
+  return c;
+}
+
+Canon canon_group_of(const Canon &x, int root, bool add, bool flip) {
+  Canon g;
+  bool same = add ? (root == OP_ADD || root == OP_SUB)
+                  : (root == OP_MUL || root == OP_DIV);
+  if (same) {
+    g = x;
+  } else if (x.key != (add ? CANON_ZERO : CANON_ONE)) {
+    g.pos = canon_tag(CANON_TERM_POS, x.key);
+    g.neg = canon_tag(CANON_TERM_NEG, x.key);
+    g.cnt = 1;
+    g.one = x.key;
+  }
+  if (flip) {
+    swap(g.pos, g.neg);
+    g.one_neg = !g.one_neg;
+  }
+  return g;
+}
+
+Canon canon_apply2(int op, const Canon &a, int a_root, const Canon &b,
+                   int b_root) {
+  bool add = op == OP_ADD || op == OP_SUB;
+  if (!add && op != OP_MUL && op != OP_DIV) {
+    Canon c;
+    c.key = canon_tag(op, a.key, b.key);
+    return c;
+  }
+  Canon l = canon_group_of(a, a_root, add, false);
+  Canon r = canon_group_of(b, b_root, add, op == OP_SUB || op == OP_DIV);
+  Canon c;
+  c.pos = l.pos + r.pos;
+  c.neg = l.neg + r.neg;
+  c.cnt = l.cnt + r.cnt;
+  if (c.cnt == 1) {
+    const Canon &t = l.cnt ? l : r;
+    c.one = t.one;
+    c.one_neg = t.one_neg;
+  }
+  if (c.cnt == 0)
+    c.key = add ? CANON_ZERO : CANON_ONE;
+  else if (c.cnt == 1 && !c.one_neg)
+    c.key = c.one;
+  else if (!add)
+    c.key = canon_tag(CANON_MUL, c.pos);
+  else if (c.cnt == 1)
+    c.key = canon_neg(c.one);
+  else if (c.neg < c.pos)
+    c.key = canon_neg(canon_tag(CANON_ADD, c.neg));
+  else
+    c.key = canon_tag(CANON_ADD, c.pos);
+  return c;
+}
+
+uint64_t canon_of_expr(const vector<string> &expr) {
+  vector<pair<Canon, int>> st;
+  st.reserve(expr.size());
+  for (const string &t : expr) {
+    int op = op_of_token(t);
+    if (op == OP_LEAF) {
+      st.emplace_back(canon_leaf(t), OP_LEAF);
+    } else if (OPS[op].arity == 1) {
+      if (st.empty())
+        return 0;
+      st.back() = {canon_apply1(op, st.back().first), op};
+    } else {
+      if (st.size() < 2)
+        return 0;
+      pair<Canon, int> b = st.back();
+      st.pop_back();
+      st.back() = {canon_apply2(op, st.back().first, st.back().second,
+                                b.first, b.second),
+                   op};
+    }
+  }
+  return st.size() == 1 ? st.back().first.key : 0;
+}
+
+// --------------- 工具：RPN 拼接 ---------------
+bool scan_ll(const string &s, size_t &pos, long long &out) {
+  size_t i = pos;
+  while (i < s.size() && isspace((unsigned char)s[i]))
+    i++;
+  bool neg = false;
+  if (i < s.size() && (s[i] == '+' || s[i] == '-'))
+    neg = s[i++] == '-';
+  const unsigned long long lim =
+      neg ? (unsigned long long)LLONG_MAX + 1 : (unsigned long long)LLONG_MAX;
+  unsigned long long v = 0;
+  size_t first = i;
+  for (; i < s.size() && s[i] >= '0' && s[i] <= '9'; i++) {
+    unsigned d = (unsigned)(s[i] - '0');
+    if (v > (lim - d) / 10)
+      return false;
+    v = v * 10 + d;
+  }
+  if (i == first)
+    return false;
+  out = neg ? (long long)(0ULL - v) : (long long)v;
+  pos = i;
+  return true;
+}
+
+bool try_parse_ll(const string &t, long long &out) {
+  size_t pos = 0;
+  long long v = 0;
+  if (!scan_ll(t, pos, v) || pos != t.size())
+    return false;
+  out = v;
+  return true;
+}
+
+long long digit_span(long long b) {
+  long long p = 10;
+  while (p <= b)
+    p *= 10;
+  return p;
+}
+
+bool safe_cat_ll(long long a, long long b, long long &out) {
+  if (a < 1 || b < 0 || b >= 1000000000000000000LL) // digit_span 不溢出
+    return false;
+  __int128 r = (__int128)a * digit_span(b) + b;
+  if (r > LLONG_MAX)
+    return false;
+  out = (long long)r;
+  return true;
+}
+
+// ======================= 内存估算与 clock 淘汰 =======================
+int count_leaf_tokens(const vector<string> &expr) {
+  int c = 0;
+  for (const string &t : expr) {
+    if (op_of_token(t) == OP_LEAF)
+      c++;
+  }
+  return c;
+}
+
+// --------------- 解的排名 ---------------
+AnswerRank rank_expr(const vector<string> &expr) {
+  AnswerRank r;
+  vector<pair<double, int>> st; // 近似值、函数嵌套深度
+  st.reserve(expr.size());
+  for (const string &t : expr) {
+    int code = op_of_token(t);
+    if (code == OP_LEAF) {
+      st.emplace_back(strtod(t.c_str(), nullptr), 0);
+      continue;
+    }
+    const OpInfo &o = OPS[code];
+    if (st.size() < (size_t)o.arity)
+      break;
+    r.ops++;
+    if (o.func >= 0)
+      r.funcs++;
+    double v = 0;
+    int d;
+    if (o.arity == 2) {
+      pair<double, int> b = st.back();
+      st.pop_back();
+      pair<double, int> a = st.back();
+      st.pop_back();
+      d = max(a.second, b.second);
+      switch (code) {
+      case OP_ADD:
+        v = a.first + b.first;
+        r.neg_plus--;
+        break;
+      case OP_SUB:
+        v = a.first - b.first;
+        break;
+      case OP_MUL:
+        v = a.first * b.first;
+        break;
+      case OP_DIV:
+        v = a.first / b.first;
+        break;
+      case OP_LOG:
+        v = log(b.first) / log(a.first);
+        break;
+      case OP_POW:
+        v = pow(a.first, b.first);
+        break;
+      case OP_CAT:
+        v = a.first * (double)digit_span((long long)b.first) + b.first;
+        break;
+      }
+    } else {
+      pair<double, int> a = st.back();
+      st.pop_back();
+      d = a.second;
+      switch (code) {
+      case OP_SQRT:
+        v = sqrt(a.first);
+        break;
+      case OP_FACT:
+        v = tgamma(a.first + 1);
+        break;
+      case OP_LG:
+        v = log10(a.first);
+        break;
+      case OP_LB:
+        v = log2(a.first);
+        break;
+      }
+    }
+    if (o.nest)
+      d++;
+    if (v < 0 || fabs(v - nearbyint(v)) > 1e-9 * max(1.0, fabs(v)))
+      r.odd_steps++;
+    r.depth = max(r.depth, d);
+    st.emplace_back(v, d);
+  }
+  return r;
+}
+
+bool AnswerRank::operator<(const AnswerRank &o) const {
+  return tie(ops, funcs, depth, odd_steps, neg_plus) <
+         tie(o.ops, o.funcs, o.depth, o.odd_steps, o.neg_plus);
+}
+
+// --------------- 质因数分解（仅对 |v|<=max_abs_val 范围做） ---------------
+u64 powmod_u64(u64 a, u64 e, u64 m) {
+  u64 r = 1;
+  a %= m;
+  while (e) {
+    if (e & 1)
+      r = mulmod_u64(r, a, m);
+    a = mulmod_u64(a, a, m);
+    e >>= 1;
+  }
+  return r;
+}
+
+bool is_prime_u64(u64 n) {
+  if (n < 2)
+    return false;
+  static const u64 bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+  for (u64 p : bases) {
+    if (n % p == 0)
+      return n == p;
+  }
+  u64 d = n - 1;
+  int s = 0;
+  while ((d & 1) == 0) {
+    d >>= 1;
+    s++;
+  }
+  for (u64 a : bases) {
+    u64 x = powmod_u64(a, d, n);
+    if (x == 1 || x == n - 1)
+      continue;
+    bool composite = true;
+    for (int r = 1; r < s; r++) {
+      x = mulmod_u64(x, x, n);
+      if (x == n - 1) {
+        composite = false;
+        break;
+      }
+    }
+    if (composite)
+      return false;
+  }
+  return true;
+}
+
+u64 pollard_brent(u64 n) {
+  for (u64 c = 1;; c++) {
+    u64 y = 2, x = 2, q = 1, g = 1, ys = 2;
+    const u64 m = 128;
+    u64 r = 1;
+    auto f = [&](u64 v) { return (mulmod_u64(v, v, n) + c) % n; };
+    do {
+      x = y;
+      for (u64 i = 0; i < r; i++)
+        y = f(y);
+      u64 k = 0;
+      do {
+        ys = y;
+        for (u64 i = 0; i < min(m, r - k); i++) {
+          y = f(y);
+          q = mulmod_u64(q, x > y ? x - y : y - x, n);
+        }
+        g = gcd(q, n);
+        k += m;
+      } while (k < r && g == 1);
+      r <<= 1;
+    } while (g == 1);
+    if (g == n) {
+      do {
+        ys = f(ys);
+        g = gcd(x > ys ? x - ys : ys - x, n);
+      } while (g == 1);
+    }
+    if (g != n)
+      return g;
+  }
+}
+
+void collect_prime_factors(u64 n, vector<u64> &out) {
+  if (n == 1)
+    return;
+  if (is_prime_u64(n)) {
+    out.push_back(n);
+    return;
+  }
+  u64 d = pollard_brent(n);
+  collect_prime_factors(d, out);
+  collect_prime_factors(n / d, out);
+}
+
+vector<pair<int, int>> factorize_small(long long x) {
+  vector<pair<int, int>> res;
+  if (x <= 1)
+    return res;
+  for (long long p = 2; p < 128 && p * p <= x; p += (p == 2 ? 1 : 2)) {
+    if (x % p == 0) {
+      int e = 0;
+      while (x % p == 0) {
+        x /= p;
+        ++e;
+      }
+      res.push_back({(int)p, e});
+    }
+  }
+  if (x > 1) {
+    vector<u64> ps;
+    collect_prime_factors((u64)x, ps);
+    sort(ps.begin(), ps.end());
+    for (u64 p : ps) {
+      if (!res.empty() && res.back().first == (int)p)
+        res.back().second++;
+      else
+        res.push_back({(int)p, 1});
+    }
+  }
+  return res;
+}
+
+int exp_sum(const vector<pair<int, int>> &pe) {
+  int s = 0;
+  for (auto &kv : pe)
+    s += kv.second;
+  return s;
+}
+
+vector<pair<int, int>> factors_add(const vector<pair<int, int>> &a,
+                                   const vector<pair<int, int>> &b) {
+  vector<pair<int, int>> out;
+  out.reserve(a.size() + b.size());
+  size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size()) {
+    if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
+      out.push_back(a[i++]);
+    } else if (i == a.size() || b[j].first < a[i].first) {
+      out.push_back(b[j++]);
+    } else {
+      int p = a[i].first;
+      int e = a[i].second + b[j].second;
+      if (e)
+        out.push_back({p, e});
+      ++i;
+      ++j;
+    }
+  }
+  return out;
+}
+
+bool factors_subtract(const vector<pair<int, int>> &a,
+                      const vector<pair<int, int>> &b,
+                      vector<pair<int, int>> &out) {
+  out.clear();
+  out.reserve(a.size());
+  size_t i = 0, j = 0;
+  while (i < a.size() || j < b.size()) {
+    if (j == b.size() || (i < a.size() && a[i].first < b[j].first)) {
+      out.push_back(a[i++]);
+    } else if (i == a.size() || b[j].first < a[i].first) {
+      return false; // b 有 a 没有的质因子
+    } else {
+      int p = a[i].first;
+      int ea = a[i].second, eb = b[j].second;
+      if (ea < eb)
+        return false;
+      int e = ea - eb;
+      if (e)
+        out.push_back({p, e});
+      ++i;
+      ++j;
+    }
+  }
+  return true;
+}
+
+bool try_eval_small_abs(const SolverConfig &c, const vector<pair<int, int>> &pe,
+                        long long &out_abs) {
+  __int128 prod = 1;
+  for (auto &kv : pe) {
+    int p = kv.first;
+    int e = kv.second;
+    for (int i = 0; i < e; i++) {
+      prod *= p;
+      if (prod > c.max_abs_val)
+        return false;
+    }
+  }
+  out_abs = (long long)prod;
+  return true;
+}
+
+void normalize_num(const SolverConfig &c, Num &n) {
+  if (n.sign == 0) {
+    n.has_ll = true;
+    n.ll = 0;
+    n.pe.clear();
+    return;
+  }
+  long long abs_v;
+  if (try_eval_small_abs(c, n.pe, abs_v)) {
+    n.has_ll = true;
+    n.ll = (n.sign < 0 ? -abs_v : abs_v);
+  } else {
+    n.has_ll = false;
+    n.ll = 0;
+  }
+}
+
+Num make_num_from_ll_pruned(const SolverConfig &c, long long v, bool &ok) {
+  ok = false;
+  Num n;
+  if (c.no_negative && v < 0)
+    return n; // forbid negative intermediates
+  if (v == 0) {
+    n.sign = 0;
+    n.pe.clear();
+    n.has_ll = true;
+    n.ll = 0;
+    ok = true;
+    return n;
+  }
+  long long av = llabs(v);
+  if (av > c.max_abs_val)
+    return n; // 剪枝：普通整数太大直接丢
+  n.sign = (v < 0 ? -1 : 1);
+  n.pe = factorize_small(av);
+  n.has_ll = true;
+  n.ll = v;
+  ok = true;
+  return n;
+}
+
+// --------------- 完全平方判定（整数） ---------------
+bool is_perfect_square_ll(long long x, long long &r) {
+  if (x < 0)
+    return false;
+  long long lo = 0, hi = min<long long>(x, 3037000499LL);
+  while (lo <= hi) {
+    long long mid = lo + (hi - lo) / 2;
+    __int128 sq = (__int128)mid * mid;
+    if (sq == x) {
+      r = mid;
+      return true;
+    }
+    if (sq < x)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  return false;
+}
+
+// --------------- 阶乘质因子（Legendre） ---------------
+vector<int> primes_up_to(int n) {
+  return vector<int>(SMALL_PRIMES.begin(),
+                     upper_bound(SMALL_PRIMES.begin(), SMALL_PRIMES.end(), n));
+}
+
+vector<pair<int, int>> factorial_factors(const SolverConfig &c, int n) {
+  vector<pair<int, int>> res;
+  for (int p : c.fact->primes) {
+    if (p > n)
+      break;
+    int e = 0, t = n;
+    while (t) {
+      t /= p;
+      e += t;
+    }
+    if (e)
+      res.push_back({p, e});
+  }
+  return res;
+}
+
+// --------------- 函数使用次数合并检查 ---------------
+bool merge_used(const SolverConfig &c, const Node &A, const Node &B,
+                array<unsigned char, F_CNT> &out) {
+  for (int i = 0; i < F_CNT; i++) {
+    int s = (int)A.used[i] + (int)B.used[i];
+    if (s > c.max_use[i])
+      return false;
+    out[i] = (unsigned char)s;
+  }
+  return true;
+}
+
+bool inc_used(const SolverConfig &c, const Node &A, FuncIdx f,
+              array<unsigned char, F_CNT> &out) {
+  out = A.used;
+  if ((int)out[f] + 1 > c.max_use[f])
+    return false;
+  out[f] = (unsigned char)(out[f] + 1);
+  return true;
+}
+
+// --------------- 目标判断（不依赖大整数） ---------------
+bool is_target_24(const SolverConfig &c, const Num &n) {
+  if (n.sign <= 0)
+    return false;
+  if (n.has_ll)
+    return n.ll == c.target;
+  return n.pe == c.target_factors;
+}
+
+// --------------- 大数加减 ---------------
+bool BigNat::mul_small(u64 m) {
+  unsigned __int128 carry = 0;
+  for (int i = 0; i < n; i++) {
+    unsigned __int128 cur = (unsigned __int128)d[i] * m + carry;
+    d[i] = (u64)cur;
+    carry = cur >> 64;
+  }
+  if (carry) {
+    if (n == BIG_LIMBS)
+      return false;
+    d[n++] = (u64)carry;
+  }
+  return true;
+}
+
+u64 BigNat::mod_small(u64 m) const {
+  unsigned __int128 rem = 0;
+  for (int i = n - 1; i >= 0; i--)
+    rem = ((rem << 64) | d[i]) % m;
+  return (u64)rem;
+}
+
+void BigNat::div_small(u64 m) {
+  unsigned __int128 rem = 0;
+  for (int i = n - 1; i >= 0; i--) {
+    unsigned __int128 cur = (rem << 64) | d[i];
+    d[i] = (u64)(cur / m);
+    rem = cur % m;
+  }
+  while (n > 0 && d[n - 1] == 0)
+    n--;
+}
+
+int BigNat::bits() const {
+  if (n == 0)
+    return 0;
+  int b = 64 * (n - 1);
+  for (u64 x = d[n - 1]; x; x >>= 1)
+    b++;
+  return b;
+}
+
+bool BigNat::from_pe(const vector<pair<int, int>> &pe) {
+  n = 1;
+  d[0] = 1;
+  for (auto &kv : pe) {
+    u64 p = (u64)kv.first;
+    int e = kv.second;
+    while (e > 0) {
+      u64 m = 1; // 把若干个 p 合成一次乘法
+      while (e > 0 && m <= UINT64_MAX / p) {
+        m *= p;
+        --e;
+      }
+      if (!mul_small(m))
+        return false;
+    }
+  }
+  return true;
+}
+
+int big_cmp(const BigNat &a, const BigNat &b) {
+  if (a.n != b.n)
+    return a.n < b.n ? -1 : 1;
+  for (int i = a.n - 1; i >= 0; i--)
+    if (a.d[i] != b.d[i])
+      return a.d[i] < b.d[i] ? -1 : 1;
+  return 0;
+}
+
+bool big_add(BigNat &a, const BigNat &b) {
+  int n = max(a.n, b.n);
+  unsigned __int128 carry = 0;
+  for (int i = 0; i < n; i++) {
+    carry += (unsigned __int128)(i < a.n ? a.d[i] : 0) + (i < b.n ? b.d[i] : 0);
+    a.d[i] = (u64)carry;
+    carry >>= 64;
+  }
+  a.n = n;
+  if (carry) {
+    if (n == BIG_LIMBS)
+      return false;
+    a.d[a.n++] = (u64)carry;
+  }
+  return true;
+}
+
+void big_sub(BigNat &a, const BigNat &b) {
+  u64 borrow = 0;
+  for (int i = 0; i < a.n; i++) {
+    u64 x = a.d[i], y = i < b.n ? b.d[i] : 0;
+    a.d[i] = x - y - borrow;
+    borrow = (x < y || x - y < borrow) ? 1 : 0;
+  }
+  while (a.n > 0 && a.d[a.n - 1] == 0)
+    a.n--;
+}
+
+double log2_of_pe(const vector<pair<int, int>> &pe) {
+  double s = 0;
+  for (auto &kv : pe)
+    s += kv.second * log2((double)kv.first);
+  return s;
+}
+
+bool factorize_checked(u64 x, vector<pair<int, int>> &pe) {
+  pe = factorize_small((long long)x);
+  unsigned __int128 prod = 1;
+  for (auto &kv : pe)
+    for (int i = 0; i < kv.second && prod <= x; i++)
+      prod *= (unsigned)kv.first;
+  return prod == x;
+}
+
+const vector<TrialChunk> &trial_chunks() {
+  static const vector<TrialChunk> chunks = [] {
+    vector<TrialChunk> cs;
+    for (int p : primes_up_to(BIG_TRIAL_PRIME)) {
+      if (cs.empty() || cs.back().prod > UINT64_MAX / (u64)p)
+        cs.push_back({1, {}});
+      cs.back().prod *= (u64)p;
+      cs.back().primes.push_back(p);
+    }
+    return cs;
+  }();
+  return chunks;
+}
+
+bool big_factorize(const SolverConfig &cfg, BigNat &v,
+                   vector<pair<int, int>> &pe) {
+  pe.clear();
+  for (const TrialChunk &c : trial_chunks()) {
+    if (v.n == 1 && v.d[0] <= (u64)cfg.max_abs_val)
+      break;
+    u64 r = v.mod_small(c.prod);
+    for (int p : c.primes) {
+      if (r % (u64)p != 0)
+        continue;
+      int e = 0;
+      do {
+        v.div_small((u64)p);
+        ++e;
+      } while (v.mod_small((u64)p) == 0);
+      pe.push_back({p, e});
+    }
+  }
+  if (v.n != 1)
+    return false;
+  const u64 c = v.d[0]; // 没有试除范围内的因子
+  if (c == 1)
+    return true;
+  if (is_prime_u64(c)) {
+    if (c > (u64)INT_MAX)
+      return false;
+    pe.push_back({(int)c, 1});
+    return true;
+  }
+  if (c > (u64)cfg.max_abs_val)
+    return false;
+  vector<pair<int, int>> rest; // 素因子都不小于已试除的素数
+  if (!factorize_checked(c, rest))
+    return false;
+  pe.insert(pe.end(), rest.begin(), rest.end());
+  return true;
+}
+
+bool num_add_big(const SolverConfig &c, const Num &A, const Num &B, bool sub,
+                 Num &out) {
+  int sa = A.sign, sb = sub ? -B.sign : B.sign;
+  if (sa == 0 || sb == 0) {
+    out = sa == 0 ? B : A;
+    out.sign = sa == 0 ? sb : sa;
+    normalize_num(c, out);
+  } else {
+    // 提出公因子 g = gcd(|A|, |B|)，只对余下的 ra、rb 做加减
+    vector<pair<int, int>> g, ra, rb, rpe;
+    for (size_t i = 0, j = 0; i < A.pe.size() && j < B.pe.size();) {
+      if (A.pe[i].first < B.pe[j].first)
+        i++;
+      else if (A.pe[i].first > B.pe[j].first)
+        j++;
+      else {
+        g.push_back({A.pe[i].first, min(A.pe[i].second, B.pe[j].second)});
+        i++, j++;
+      }
+    }
+    factors_subtract(A.pe, g, ra);
+    factors_subtract(B.pe, g, rb);
+    int rs;
+    long long av, bv;
+    if (try_eval_small_abs(c, ra, av) && try_eval_small_abs(c, rb, bv)) {
+      __int128 r = (__int128)sa * av + (__int128)sb * bv;
+      if (r == 0) {
+        out = Num();
+        normalize_num(c, out);
+        return true;
+      }
+      rs = r < 0 ? -1 : 1;
+      if (!factorize_checked((u64)(r < 0 ? -r : r), rpe))
+        return false;
+    } else {
+      const double cap = BIG_COFACTOR_BITS + 1; // 留出估算误差
+      if (log2_of_pe(ra) > cap || log2_of_pe(rb) > cap)
+        return false;
+      BigNat x, y;
+      if (!x.from_pe(ra) || !y.from_pe(rb))
+        return false;
+      if (sa == sb) {
+        if (!big_add(x, y) || x.bits() > BIG_COFACTOR_BITS)
+          return false;
+        rs = sa;
+      } else {
+        if (max(x.bits(), y.bits()) > BIG_COFACTOR_BITS)
+          return false;
+        int cmp = big_cmp(x, y);
+        if (cmp == 0) {
+          out = Num();
+          normalize_num(c, out);
+          return true;
+        }
+        rs = cmp > 0 ? sa : sb;
+        if (cmp < 0)
+          swap(x, y);
+        big_sub(x, y);
+      }
+      if (!big_factorize(c, x, rpe))
+        return false;
+    }
+    out.sign = rs;
+    out.pe = factors_add(g, rpe);
+    // 与阶乘相同的指数上限
+    if (exp_sum(out.pe) > c.max_exp_sum * 2)
+      return false;
+    normalize_num(c, out);
+  }
+  if (c.no_negative && out.sign < 0)
+    return false;
+  return true;
+}
+
+bool pe_root(const vector<pair<int, int>> &pe, long long k,
+             vector<pair<int, int>> &out) {
+  out.clear();
+  for (auto &kv : pe) {
+    if (kv.second % k != 0)
+      return false;
+    out.push_back({kv.first, (int)(kv.second / k)});
+  }
+  return true;
+}
+
+bool pe_log(const vector<pair<int, int>> &a, const vector<pair<int, int>> &b,
+            long long &k) {
+  if (a.empty() || a.size() != b.size())
+    return false;
+  k = b[0].second / a[0].second;
+  if (k < 1)
+    return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (a[i].first != b[i].first || (long long)a[i].second * k != b[i].second)
+      return false;
+  return true;
+}
+
+// --------------- 各运算符的求值（含剪枝） ---------------
+bool num_sqrt(const SolverConfig &c, const Num &a, Num &out) {
+  if (!a.has_ll) {
+    if (a.sign <= 0 || !pe_root(a.pe, 2, out.pe))
+      return false;
+    out.sign = 1;
+    normalize_num(c, out);
+    return true;
+  }
+  long long v = a.ll;
+  if (v == 0 || v == 1)
+    return false;
+  long long r;
+  if (!is_perfect_square_ll(v, r))
+    return false;
+  bool ok;
+  out = make_num_from_ll_pruned(c, r, ok);
+  return ok;
+}
+
+bool num_fact(const SolverConfig &c, const Num &a, Num &out) {
+  if (!a.has_ll)
+    return false;
+  long long v = a.ll;
+  if (v < 0 || v > c.max_fact_arg)
+    return false;
+  if (v == 0 || v == 1 || v == 2)
+    return false;
+  if (v == 4)
+    return false;
+  out.sign = 1;
+  out.pe = factorial_factors(c, (int)v);
+  normalize_num(c, out);
+  // Allow large factorials even if they overflow long long
+  if (!out.has_ll &&
+      exp_sum(out.pe) > c.max_exp_sum * 2) // Double limit just in case
+    return false;
+  return true;
+}
+
+bool num_lg(const SolverConfig &c, const Num &a, Num &out) {
+  bool ok;
+  if (!a.has_ll) {
+    // 10^k = 2^k * 5^k
+    if (a.sign <= 0 || a.pe.size() != 2 || a.pe[0].first != 2 ||
+        a.pe[1].first != 5 || a.pe[0].second != a.pe[1].second)
+      return false;
+    out = make_num_from_ll_pruned(c, a.pe[0].second, ok);
+    return ok;
+  }
+  long long v = a.ll;
+  if (v <= 0 || v == 1)
+    return false;
+  if (v == 4 || v == 16)
+    return false;
+  long long x = v;
+  long long k = 0;
+  while (x % 10 == 0) {
+    x /= 10;
+    ++k;
+  }
+  if (x != 1)
+    return false;
+  out = make_num_from_ll_pruned(c, k, ok);
+  return ok;
+}
+
+bool num_lb(const SolverConfig &c, const Num &a, Num &out) {
+  bool ok;
+  if (!a.has_ll) {
+    if (a.sign <= 0 || a.pe.size() != 1 || a.pe[0].first != 2)
+      return false;
+    out = make_num_from_ll_pruned(c, a.pe[0].second, ok);
+    return ok;
+  }
+  long long v = a.ll;
+  if (v <= 0 || v == 1)
+    return false;
+  if (v == 4 || v == 16)
+    return false;
+  if ((v & (v - 1)) != 0)
+    return false;
+  long long k = 0;
+  while (v > 1) {
+    v >>= 1;
+    ++k;
+  }
+  out = make_num_from_ll_pruned(c, k, ok);
+  return ok;
+}
+
+bool num_log(const SolverConfig &c, const Num &A, const Num &B, Num &out) {
+  bool ok;
+  if (!A.has_ll || !B.has_ll) {
+    // 有大数：b 的指数须是 a 的同一倍数
+    long long k;
+    if (A.sign <= 0 || B.sign <= 0 || !pe_log(A.pe, B.pe, k))
+      return false;
+    out = make_num_from_ll_pruned(c, k, ok);
+    return ok;
+  }
+  long long a = A.ll;
+  long long b = B.ll;
+  if (a < 2)
+    return false;
+  if (b <= 0 || b == 1)
+    return false;
+  long long k = 0;
+  __int128 cur = 1;
+  while (cur < b) {
+    cur *= a;
+    ++k;
+    if (cur > c.max_abs_val)
+      break;
+  }
+  if (cur != b)
+    return false;
+  out = make_num_from_ll_pruned(c, k, ok);
+  return ok;
+}
+
+bool num_add(const SolverConfig &c, const Num &A, const Num &B, Num &out) {
+  if (!A.has_ll || !B.has_ll)
+    return num_add_big(c, A, B, false, out);
+  __int128 r = (__int128)A.ll + (__int128)B.ll;
+  if (r > c.max_abs_val || r < -c.max_abs_val)
+    return false;
+  bool ok;
+  out = make_num_from_ll_pruned(c, (long long)r, ok);
+  return ok;
+}
+
+bool num_sub(const SolverConfig &c, const Num &A, const Num &B, Num &out) {
+  if (!A.has_ll || !B.has_ll)
+    return num_add_big(c, A, B, true, out);
+  __int128 r = (__int128)A.ll - (__int128)B.ll;
+  if (r > c.max_abs_val || r < -c.max_abs_val)
+    return false;
+  bool ok;
+  out = make_num_from_ll_pruned(c, (long long)r, ok);
+  return ok;
+}
+
+bool num_mul(const SolverConfig &c, const Num &A, const Num &B, Num &out) {
+  if (A.sign == 0 || B.sign == 0) {
+    out.sign = 0;
+    out.pe.clear();
+    out.has_ll = true;
+    out.ll = 0;
+    return true;
+  }
+  out.sign = A.sign * B.sign;
+  out.pe = factors_add(A.pe, B.pe);
+  if (exp_sum(out.pe) > c.max_exp_sum)
+    return false;
+  normalize_num(c, out);
+  return true;
+}
+
+bool num_div(const SolverConfig &c, const Num &A, const Num &B, Num &out) {
+  if (B.sign == 0)
+    return false;
+  if (B.has_ll && B.ll == 1)
+    return false;
+  if (A.sign == 0) {
+    out.sign = 0;
+    out.pe.clear();
+    out.has_ll = true;
+    out.ll = 0;
+    return true;
+  }
+  vector<pair<int, int>> pe2;
+  if (!factors_subtract(A.pe, B.pe, pe2))
+    return false; // 必须整除
+  out.sign = A.sign * B.sign;
+  out.pe = std::move(pe2);
+  normalize_num(c, out);
+  if (!out.has_ll && exp_sum(out.pe) > c.max_exp_sum)
+    return false;
+  return true;
+}
+
+bool num_pow(const SolverConfig &c, const Num &A, const Num &B, Num &out) {
+  if (!B.has_ll || B.ll < 2 || B.ll > c.max_exp_sum)
+    return false;
+  if (A.sign == 0 || A.pe.empty())
+    return false;
+  long long k = B.ll;
+  if ((long long)exp_sum(A.pe) * k > c.max_exp_sum)
+    return false;
+  out.sign = (A.sign < 0 && (k & 1)) ? -1 : 1;
+  out.pe = A.pe;
+  for (auto &kv : out.pe)
+    kv.second = (int)(kv.second * k);
+  normalize_num(c, out);
+  return true;
+}
+
+bool num_cat(const SolverConfig &c, const Num &A, const Num &B, Num &out) {
+  if (!A.has_ll || !B.has_ll)
+    return false;
+  long long v;
+  if (!safe_cat_ll(A.ll, B.ll, v) || v > c.max_abs_val)
+    return false;
+  bool ok;
+  out = make_num_from_ll_pruned(c, v, ok);
+  return ok;
+}
+
+const OpInfo OPS[OP_CNT] = {
+    {"+", 2, 1, -1, false, true, false, 1, FORM_INFIX, nullptr, num_add},
+    {"-", 2, 1, -1, false, false, false, 1, FORM_INFIX, nullptr, num_sub},
+    {"*", 2, 1, -1, false, true, false, 2, FORM_INFIX, nullptr, num_mul},
+    {"/", 2, 2, -1, false, false, false, 2, FORM_INFIX, nullptr, num_div},
+    {"log", 2, 4, F_LOG, true, false, false, 3, FORM_CALL, nullptr, num_log},
+    {"sqrt", 1, 3, F_SQRT, true, false, false, 3, FORM_CALL, num_sqrt, nullptr},
+    {"!", 1, 3, F_FACT, true, false, false, 3, FORM_POSTFIX, num_fact, nullptr},
+    {"lg", 1, 3, F_LG, true, false, false, 3, FORM_CALL, num_lg, nullptr},
+    {"lb", 1, 3, F_LB, true, false, false, 3, FORM_CALL, num_lb, nullptr},
+    {"^", 2, 3, F_POW, false, false, false, 3, FORM_INFIX, nullptr, num_pow},
+    {"||", 2, 2, F_CAT, false, false, true, 3, FORM_INFIX, nullptr, num_cat},
+};
+
+bool num_exact1(const SolverConfig &c, int op, const Num &a, Num &out) {
+  if (a.has_ll) {
+    long long v = a.ll, r = -1;
+    if (op == OP_SQRT && (v == 0 || v == 1))
+      r = v;
+    else if (op == OP_FACT && v >= 0 && v <= 4 && v != 3)
+      r = v == 4 ? 24 : v == 2 ? 2 : 1;
+    else if ((op == OP_LG || op == OP_LB) && v == 1)
+      r = 0;
+    else if (op == OP_LB && (v == 4 || v == 16))
+      r = v == 4 ? 2 : 4;
+    if (r >= 0) {
+      bool ok;
+      out = make_num_from_ll_pruned(c, r, ok);
+      return ok;
+    }
+  }
+  return OPS[op].num1(c, a, out);
+}
+
+bool num_exact2(const SolverConfig &c, int op, const Num &A, const Num &B,
+                Num &out) {
+  bool ok;
+  if (op == OP_DIV && B.has_ll && B.ll == 1) {
+    out = A;
+    return true;
+  }
+  if (op == OP_LOG && B.has_ll && B.ll == 1 && A.has_ll && A.ll >= 2) {
+    out = make_num_from_ll_pruned(c, 0, ok);
+    return ok;
+  }
+  if (op == OP_POW && B.has_ll && (B.ll == 0 || B.ll == 1)) {
+    if (B.ll == 1) {
+      out = A;
+      return true;
+    }
+    if (A.sign == 0)
+      return false; // 0 ^ 0
+    out = make_num_from_ll_pruned(c, 1, ok);
+    return ok;
+  }
+  if (op == OP_POW && B.has_ll && B.ll >= 2 && A.has_ll &&
+      (A.ll == 0 || A.ll == 1 || A.ll == -1)) {
+    long long r = A.ll == -1 && (B.ll & 1) ? -1 : A.ll * A.ll;
+    out = make_num_from_ll_pruned(c, r, ok);
+    return ok;
+  }
+  return OPS[op].num2(c, A, B, out);
+}
+
+// =======================
+string rpn_raw(const vector<string> &expr) {
+  string raw;
+  for (size_t i = 0; i < expr.size(); i++) {
+    if (i)
+      raw.push_back(' ');
+    raw += expr[i];
+  }
+  return raw;
+}
+
+string rpn_to_infix(const vector<string> &expr) {
+  vector<InfixItem> st;
+  st.reserve(expr.size());
+
+  for (const string &t : expr) {
+    int code = op_of_token(t);
+    if (code == OP_LEAF) {
+      // number / atom
+      InfixItem a;
+      a.s = t;
+      a.prec = 4;
+      a.bop = 0;
+      st.push_back(std::move(a));
+      continue;
+    }
+    const OpInfo &o = OPS[code];
+    if (st.size() < (size_t)o.arity)
+      return rpn_raw(expr);
+    InfixItem c;
+    c.prec = o.prec;
+    c.bop = 0;
+    if (o.arity == 1) {
+      InfixItem a = std::move(st.back());
+      st.pop_back();
+      if (o.form == FORM_POSTFIX) {
+        bool need = (a.prec < 3 || a.bop != 0); // (a+b)! 这类需要括号
+        c.s = (need ? ("(" + a.s + ")") : a.s) + o.token;
+      } else {
+        c.s = o.token + ("(" + a.s + ")");
+      }
+      st.push_back(std::move(c));
+      continue;
+    }
+    InfixItem b = std::move(st.back());
+    st.pop_back();
+    InfixItem a = std::move(st.back());
+    st.pop_back();
+    if (o.form == FORM_CALL) {
+      c.s = o.token + ("(" + a.s + ", " + b.s + ")");
+      st.push_back(std::move(c));
+      continue;
+    }
+    char op = t[0];
+    bool lp = need_paren_left(op, a);
+    bool rp = need_paren_right(op, b);
+
+    string as = lp ? ("(" + a.s + ")") : a.s;
+    string bs = rp ? ("(" + b.s + ")") : b.s;
+
+    c.bop = op;
+    c.s.reserve(as.size() + bs.size() + t.size() + 2);
+    c.s = as;
+    c.s.push_back(' ');
+    c.s += t;
+    c.s.push_back(' ');
+    c.s += bs;
+    st.push_back(std::move(c));
+  }
+
+  if (st.size() != 1)
+    return rpn_raw(expr);
+  return st.back().s;
+}
+
+// --------------- 一组解 ---------------
+vector<const vector<string> *> AnswerBook::ranked() const {
+  vector<pair<AnswerRank, const vector<string> *>> order;
+  order.reserve(best_rank.size());
+  for (auto &kv : best_rank)
+    order.emplace_back(kv.second, &best_exprs.at(kv.first));
+  sort(order.begin(), order.end(),
+       [](const pair<AnswerRank, const vector<string> *> &a,
+          const pair<AnswerRank, const vector<string> *> &b) {
+         if (a.first < b.first || b.first < a.first)
+           return a.first < b.first;
+         return *a.second < *b.second;
+       });
+  vector<const vector<string> *> out;
+  out.reserve(order.size());
+  for (auto &o : order)
+    out.push_back(o.second);
+  return out;
+}
+
+void AnswerBook::release_answers() {
+  unordered_map<uint64_t, vector<string>>().swap(best_exprs);
+  unordered_map<uint64_t, AnswerRank>().swap(best_rank);
+  set<pair<AnswerRank, uint64_t>>().swap(best_order);
+  unordered_set<uint64_t>().swap(seen);
+}
+
+// --------------- 最接近目标的式子 ---------------
+int NearMiss::compare(bool big, long long dist, double lg, const Num &v,
+                      const Entry &e) {
+  if (big != e.big)
+    return big ? 1 : -1;
+  if (!big) {
+    if (dist != e.dist)
+      return dist < e.dist ? -1 : 1;
+    return v.ll == e.value.ll ? 0 : (v.ll < e.value.ll ? -1 : 1);
+  }
+  if (lg != e.log2)
+    return lg < e.log2 ? -1 : 1;
+  if (v.sign != e.value.sign)
+    return v.sign < e.value.sign ? -1 : 1;
+  return v.pe == e.value.pe ? 0 : (v.pe < e.value.pe ? -1 : 1);
+}
+
+void NearMiss::offer(const SolverConfig &c, const Node &nd, int leaves) {
+  const Num &v = nd.num;
+  bool big = !v.has_ll;
+  long long dist = big ? 0 : (v.ll < c.target ? c.target - v.ll
+                                              : v.ll - c.target);
+  double lg = big ? log2_of_pe(v.pe) : 0;
+  if (best.size() >= k && compare(big, dist, lg, v, best.back()) > 0)
+    return;
+  if (count_leaf_tokens(nd.expr) != leaves)
+    return;
+  AnswerRank rank = rank_expr(nd.expr);
+  size_t pos = 0;
+  while (pos < best.size()) {
+    int r = compare(big, dist, lg, v, best[pos]);
+    if (r == 0) {
+      if (rank < best[pos].rank) {
+        best[pos].expr = nd.expr;
+        best[pos].rank = rank;
+      }
+      return;
+    }
+    if (r < 0)
+      break;
+    pos++;
+  }
+  Entry e;
+  e.big = big;
+  e.dist = dist;
+  e.log2 = lg;
+  e.value = v;
+  e.expr = nd.expr;
+  e.rank = rank;
+  best.insert(best.begin() + pos, std::move(e));
+  if (best.size() > k)
+    best.pop_back();
+}
+
+string NearMiss::value_text(const Entry &e) {
+  if (!e.big)
+    return to_string(e.value.ll);
+  long long t = llround(e.log2 * 10);
+  return string(e.value.sign < 0 ? "≈-2^" : "≈2^") + to_string(t / 10) +
+         "." + to_string(t % 10);
+}
+
+// ======================= 出题：保证有解 + 难度分档 =======================
+unsigned expr_op_classes(const vector<string> &expr) {
+  unsigned m = 0;
+  for (const string &t : expr) {
+    switch (op_of_token(t)) {
+    case OP_LEAF:
+      break;
+    case OP_ADD:
+    case OP_SUB:
+      m |= OC_ADDSUB;
+      break;
+    case OP_MUL:
+      m |= OC_MUL;
+      break;
+    case OP_DIV:
+      m |= OC_DIV;
+      break;
+    default:
+      m |= OC_FUNC;
+    }
+  }
+  return m;
+}
+
+int expr_cost(const vector<string> &expr) {
+  int c = 0;
+  for (const string &t : expr) {
+    int code = op_of_token(t);
+    if (code != OP_LEAF)
+      c += OPS[code].cost;
+  }
+  return c;
+}
+
+struct PuzzleGenerator::Rng {
+  mt19937 engine;
+};
+
+PuzzleGenerator::PuzzleGenerator()
+    : rng(new Rng{mt19937((unsigned)chrono::high_resolution_clock::now()
+                              .time_since_epoch()
+                              .count())}) {
+  solver.top_k = 0; // 评级要数解的个数
+}
+
+PuzzleGenerator::~PuzzleGenerator() = default;
+
+void PuzzleGenerator::score(PuzzleRating &r, int n) {
+  // 解越少越难：SOLUTION_CAP 个解以上不再加分
+  double c = log2(1.0 + r.solutions) / log2(1.0 + SOLUTION_CAP);
+  int s_count = r.complete ? (int)lround(40.0 * (1.0 - min(1.0, c))) : 0;
+  // 最简解比 n-1 个加号贵多少
+  int s_cost = min(30, max(0, r.min_cost - (n - 1)) * 5);
+  int s_req = ((r.required & OC_DIV) ? 10 : 0) +
+              ((r.required & OC_FUNC) ? 20 : 0);
+  r.difficulty = min(100, s_count + s_cost + s_req);
+  r.band = r.difficulty < 25   ? BAND_EASY
+           : r.difficulty < 50 ? BAND_MEDIUM
+           : r.difficulty < 75 ? BAND_HARD
+                               : BAND_EXPERT;
+}
+
+PuzzleRating PuzzleGenerator::rate(vector<long long> nums, bool full) {
+  sort(nums.begin(), nums.end());
+  string key = solver.config->key;
+  key.push_back(full ? '|' : '?');
+  for (long long x : nums) {
+    key += to_string(x);
+    key.push_back(' ');
+  }
+  auto it = cache.find(key);
+  if (it != cache.end())
+    return it->second;
+
+  PuzzleRating r;
+  vector<Node> input;
+  if (Solver::nodes_from_values(*solver.config, nums, input)) {
+    solver.begin(input, true, false);
+    bool done = solver.step(exist_budget);
+    solver.finish();
+    r.solvable = solver.found;
+    if (r.solvable)
+      r.simplest = solver.first_expr;
+    (void)done;
+  }
+  if (r.solvable && full) {
+    r.rated = true;
+    solver.begin(input, false, false);
+    // 解数达到 SOLUTION_CAP 后计数项已为 0，不必再搜
+    long long spent = 0;
+    while (!(r.complete = solver.step(RATE_SLICE))) {
+      spent += RATE_SLICE;
+      if (spent >= rate_budget ||
+          (int)solver.best_exprs.size() >= SOLUTION_CAP)
+        break;
+    }
+    solver.finish();
+    r.solutions = (int)solver.best_exprs.size();
+    r.required = ~0u;
+    r.min_cost = INT_MAX;
+    for (auto &kv : solver.best_exprs) {
+      int c = expr_cost(kv.second);
+      if (c < r.min_cost) {
+        r.min_cost = c;
+        r.simplest = kv.second;
+      }
+      r.required &= expr_op_classes(kv.second);
+    }
+    score(r, (int)nums.size());
+  } else if (r.solvable) {
+    r.min_cost = expr_cost(r.simplest);
+  }
+
+  if (cache.size() >= MAX_CACHE)
+    cache.clear();
+  cache.emplace(std::move(key), r);
+  return r;
+}
+
+vector<pair<vector<long long>, PuzzleRating>>
+PuzzleGenerator::generate(int count, int n, int lo, int hi, int band,
+                          int max_attempts) {
+  vector<pair<vector<long long>, PuzzleRating>> out;
+  if (count <= 0 || n <= 0 || lo > hi)
+    return out;
+  if (max_attempts <= 0)
+    max_attempts = count * (band == BAND_ANY ? 50 : 200);
+  uniform_int_distribution<int> dist(lo, hi);
+  unordered_set<string> picked; // 同一批内不重复
+  for (int a = 0; a < max_attempts && (int)out.size() < count; a++) {
+    vector<long long> nums;
+    nums.reserve(n);
+    for (int i = 0; i < n; i++)
+      nums.push_back(dist(rng->engine));
+    PuzzleRating r = rate(nums, band != BAND_ANY);
+    if (!r.solvable || (band != BAND_ANY && r.band != band))
+      continue;
+    vector<long long> sorted = nums;
+    sort(sorted.begin(), sorted.end());
+    string k;
+    for (long long x : sorted)
+      k += to_string(x) + " ";
+    if (!picked.insert(k).second)
+      continue;
+    out.emplace_back(std::move(nums), std::move(r));
+  }
+  return out;
+}
+
+// ======================= 走法排序 =======================
+int value_class(const SolverConfig &c, const Num &v) {
+  if (v.sign == 0)
+    return VC_ZERO;
+  if (v.sign < 0 || !v.has_ll)
+    return VC_OTHER;
+  long long x = v.ll, t = c.target;
+  if (x == 1)
+    return VC_ONE;
+  if (t > 0) {
+    if (x == t)
+      return VC_TARGET;
+    if (t % x == 0)
+      return VC_DIVISOR;
+    if (x % t == 0)
+      return VC_MULTIPLE;
+  }
+  return x < t ? VC_SMALL : VC_LARGE;
+}
+
+// history 与 killer 表（说明见头文件 ValueClass 前）
+struct MoveHistory {
+  static const int MOVES = Solver::UNARY_OPS + Solver::BINARY_OPS;
+  static const int KEYS = MOVES * VC_CNT * VC_CNT;
+  static const int LEVELS = 16; // killer 按剩余个数分层，更多的共用最后一层
+  static const uint32_t MAX_SCORE = 1u << 20; // 超出时全部减半（老化）
+
+  atomic<uint32_t> score[KEYS];
+  atomic<int> killer[LEVELS]; // 走法类，-1 为空
+
+  MoveHistory() { clear(); }
+  void clear();
+  static int key(int move, int ca, int cb) {
+    return (move * VC_CNT + ca) * VC_CNT + cb;
+  }
+  uint32_t get(int k) const { return score[k].load(memory_order_relaxed); }
+  int killer_at(int n) const {
+    return killer[min(n, LEVELS - 1)].load(memory_order_relaxed);
+  }
+  // 在剩 n 个数的状态上走类 k 通向了解
+  void reward(int k, int n);
+};
+
+static MoveHistory g_move_history;
+
+void reset_move_history() { g_move_history.clear(); }
+
+void MoveHistory::clear() {
+  for (atomic<uint32_t> &s : score)
+    s.store(0, memory_order_relaxed);
+  for (atomic<int> &k : killer)
+    k.store(-1, memory_order_relaxed);
+}
+
+void MoveHistory::reward(int k, int n) {
+  killer[min(n, LEVELS - 1)].store(k, memory_order_relaxed);
+  uint32_t s = score[k].fetch_add((uint32_t)(n * n), memory_order_relaxed);
+  if (s + n * n > MAX_SCORE)
+    for (atomic<uint32_t> &x : score)
+      x.store(x.load(memory_order_relaxed) / 2, memory_order_relaxed);
+}
+
+// ======================= Solver =======================
+size_t Solver::equiv_bytes() const {
+  return equiv_seen.size() * (sizeof(uint64_t) + HASH_ENTRY_OVERHEAD / 2) +
+         equiv_seen.bucket_count() * sizeof(void *);
+}
+
+size_t Solver::mem_used() const {
+  return memo.bytes() + frontier.bytes() + equiv_bytes() + mem_answers +
+         mem_pairs;
+}
+
+void Solver::mem_check() {
+  size_t used = mem_used();
+  if (mem_budget > 0 && used > mem_budget) {
+    mem_peak = max(mem_peak, used);
+    if (mem_answers + mem_pairs > mem_budget) {
+      mem_truncated = true;
+      return;
+    }
+    const size_t low = mem_budget - mem_budget / 8;
+    if (used > low && !equiv_seen.empty()) {
+      unordered_set<uint64_t>().swap(equiv_seen);
+      used = mem_used();
+    }
+    while (used > low && (memo.evict_one() || frontier.evict_one()))
+      used = mem_used();
+    if (used > mem_budget)
+      mem_truncated = true;
+  }
+  mem_peak = max(mem_peak, used);
+}
+
+void Solver::release() {
+  memo.release();
+  frontier.release();
+  unordered_set<uint64_t>().swap(equiv_seen);
+  release_answers();
+  vector<TargetHits>().swap(targets);
+  unordered_map<long long, int>().swap(target_index);
+  vector<Frame>().swap(stack);
+  mem_answers = 0;
+  mem_pairs = 0;
+}
+
+string Solver::num_key(const Num &n) {
+  if (n.sign == 0)
+    return "0";
+  string s;
+  s.push_back(n.sign < 0 ? '-' : '+');
+  for (auto &kv : n.pe) {
+    s += to_string(kv.first);
+    s.push_back('^');
+    s += to_string(kv.second);
+    s.push_back(',');
+  }
+  return s;
+}
+
+string Solver::node_key(const Node &nd, bool cat) {
+  string s = num_key(nd.num);
+  s.push_back('|');
+  for (int i = 0; i < F_CNT; i++) {
+    s += to_string((int)nd.used[i]);
+    s.push_back(',');
+  }
+  s += "D";
+  s += to_string(nd.depth);
+  if (cat) {
+    // 启用拼接时数字与拼接结果还能继续拼，不能与同值的算式合并
+    if (nd.root == OP_LEAF)
+      s.push_back('L');
+    else if (nd.root == OP_CAT)
+      s.push_back('C');
+  }
+  return s;
+}
+
+string Solver::state_key(const vector<Node> &cur, bool cat) {
+  vector<string> ks;
+  ks.reserve(cur.size());
+  for (auto &nd : cur)
+    ks.push_back(node_key(nd, cat));
+  sort(ks.begin(), ks.end());
+  string s;
+  for (size_t i = 0; i < ks.size(); i++) {
+    if (i)
+      s.push_back(';');
+    s += ks[i];
+  }
+  return s;
+}
+
+bool Solver::dominated(const vector<Node> &cur) {
+  const bool cat = cat_enabled();
+  vector<pair<string, string>> parts; // (数值键, 次数与深度)
+  parts.reserve(cur.size());
+  for (const Node &nd : cur) {
+    string v = num_key(nd.num);
+    if (cat && nd.root == OP_LEAF)
+      v.push_back('L');
+    else if (cat && nd.root == OP_CAT)
+      v.push_back('C');
+    string b(F_CNT + 1, '\0');
+    for (int i = 0; i < F_CNT; i++)
+      b[i] = (char)nd.used[i];
+    b[F_CNT] = (char)nd.depth;
+    parts.emplace_back(std::move(v), std::move(b));
+  }
+  sort(parts.begin(), parts.end());
+  string key, rec;
+  for (size_t i = 0; i < parts.size(); i++) {
+    if (i)
+      key.push_back(';');
+    key += parts[i].first;
+    rec += parts[i].second;
+  }
+
+  string *front = frontier.find(key);
+  if (!front) {
+    frontier.insert(std::move(key), std::move(rec));
+    return false;
+  }
+  const size_t w = rec.size();
+  // a 的每一项都不超过 b
+  auto le = [w](const char *a, const char *b) {
+    for (size_t i = 0; i < w; i++)
+      if ((unsigned char)a[i] > (unsigned char)b[i])
+        return false;
+    return true;
+  };
+  for (size_t p = 0; p < front->size(); p += w)
+    if (le(front->data() + p, rec.data()))
+      return true;
+  string kept;
+  kept.reserve(front->size() + w);
+  for (size_t p = 0; p < front->size(); p += w)
+    if (!le(rec.data(), front->data() + p))
+      kept.append(*front, p, w);
+  kept += rec;
+  frontier.assign(key, std::move(kept));
+  return false;
+}
+
+uint64_t Solver::equiv_key(const vector<Node> &cur) const {
+  uint64_t h = 0;
+  for (const Node &nd : cur)
+    h += node_equiv(nd);
+  return h;
+}
+
+uint64_t Solver::node_equiv(const Node &nd) const {
+  uint64_t lit = 0;
+  if (cat_enabled() && nd.root == OP_LEAF)
+    lit = 1;
+  else if (cat_enabled() && nd.root == OP_CAT)
+    lit = 2;
+  return canon_mix(nd.canon.key + lit);
+}
+
+size_t Solver::answer_bytes(const vector<string> &expr) const {
+  size_t b = 2 * (sizeof(uint64_t) + HASH_ENTRY_OVERHEAD) +
+             sizeof(AnswerRank) + expr_bytes(expr);
+  if (top_k > 0)
+    b += sizeof(uint64_t) + sizeof(AnswerRank) + HASH_ENTRY_OVERHEAD;
+  return b;
+}
+
+uint64_t Solver::answer_key(uint64_t canon, const vector<string> &expr) {
+  return canon_mix(canon + (uint64_t)count_leaf_tokens(expr));
+}
+
+bool Solver::record_answer(AnswerBook &book, const vector<string> &expr,
+                           uint64_t canon, bool &is_better) {
+  if (canon == 0)
+    return false;
+  const uint64_t key = answer_key(canon, expr);
+  if (count_distinct && book.seen.insert(key).second)
+    mem_answers += sizeof(uint64_t) + HASH_ENTRY_OVERHEAD / 2;
+  AnswerRank rank = rank_expr(expr);
+  auto it = book.best_rank.find(key);
+  if (it != book.best_rank.end() && !(rank < it->second))
+    return false;
+  is_better = (it != book.best_rank.end());
+  if (is_better) {
+    vector<string> &old = book.best_exprs[key];
+    mem_answers -= expr_bytes(old);
+    old = expr;
+    mem_answers += expr_bytes(old);
+    if (top_k > 0) {
+      book.best_order.erase(make_pair(it->second, key));
+      book.best_order.emplace(rank, key);
+    }
+    it->second = rank;
+  } else {
+    if (top_k > 0 && book.best_exprs.size() >= top_k) {
+      auto worst = prev(book.best_order.end());
+      if (!(make_pair(rank, key) < *worst))
+        return false;
+      auto e = book.best_exprs.find(worst->second);
+      mem_answers -= answer_bytes(e->second);
+      book.best_exprs.erase(e);
+      book.best_rank.erase(worst->second);
+      book.best_order.erase(worst);
+    }
+    mem_answers += answer_bytes(expr);
+    book.best_exprs[key] = expr;
+    if (top_k > 0)
+      book.best_order.emplace(rank, key);
+    book.best_rank.emplace(key, rank);
+  }
+  mem_check();
+  return true;
+}
+
+void Solver::add_answer(const vector<string> &expr, uint64_t canon) {
+  bool is_better = false;
+  if (record_answer(*this, expr, canon, is_better) && immediate_print)
+    emit(expr);
+}
+
+void Solver::emit(const vector<string> &expr) const {
+  if (print_answer)
+    print_answer(expr, config->target, immediate_prefix);
+}
+
+bool Solver::search_done() const {
+  if (mem_truncated)
+    return true;
+  if (!find_first)
+    return false;
+  return targets.empty() ? found : targets_pending == 0;
+}
+
+void Solver::hit_targets(const Node &nd) {
+  const Num &n = nd.num;
+  if (n.sign <= 0 || !n.has_ll)
+    return;
+  auto it = target_index.find(n.ll);
+  if (it == target_index.end())
+    return;
+  if (count_leaf_tokens(nd.expr) != expected_leaf_count)
+    return;
+  TargetHits &h = targets[it->second];
+  found = true;
+  if (find_first) {
+    if (h.found)
+      return;
+    h.found = true;
+    h.first_expr = nd.expr;
+    targets_pending--;
+  } else {
+    h.found = true;
+    bool is_better;
+    record_answer(h, nd.expr, nd.canon.key, is_better);
+  }
+}
+
+bool Solver::try_op1(int op, const Node &A, Node &out) {
+  const SolverConfig &c = *config;
+  const OpInfo &o = OPS[op];
+  if (o.func >= 0 && c.max_use[o.func] == 0)
+    return false;
+  int d = A.depth + (o.nest ? 1 : 0);
+  if (d > c.max_nest)
+    return false;
+  array<unsigned char, F_CNT> used2;
+  if (!inc_used(c, A, (FuncIdx)o.func, used2))
+    return false;
+  Num n;
+  if (!(exact ? num_exact1(c, op, A.num, n) : o.num1(c, A.num, n)))
+    return false;
+
+  out.num = std::move(n);
+  if (keep_expr)
+    out.expr = apply_unary_expr(A.expr, o.token);
+  else
+    out.expr.clear();
+  out.used = used2;
+  out.depth = d;
+  out.root = (unsigned char)op;
+  out.canon = canon_apply1(op, A.canon);
+  return true;
+}
+
+bool Solver::try_op2(int op, const Node &A, const Node &B, Node &out) {
+  const SolverConfig &c = *config;
+  const OpInfo &o = OPS[op];
+  if (o.func >= 0 && c.max_use[o.func] == 0)
+    return false;
+  int d = max(A.depth, B.depth) + (o.nest ? 1 : 0);
+  if (d > c.max_nest)
+    return false;
+  array<unsigned char, F_CNT> used2;
+  if (!merge_used(c, A, B, used2))
+    return false;
+  if (o.func >= 0) {
+    if ((int)used2[o.func] + 1 > c.max_use[o.func])
+      return false;
+    used2[o.func] = (unsigned char)(used2[o.func] + 1);
+  }
+  // 拼接只接受左结合的写法：左边是数字或拼接，右边是数字
+  if (o.literals && (!is_literal_node(A) || B.root != OP_LEAF))
+    return false;
+  Num n;
+  if (!(exact ? num_exact2(c, op, A.num, B.num, n)
+              : o.num2(c, A.num, B.num, n)))
+    return false;
+
+  out.num = std::move(n);
+  if (keep_expr)
+    out.expr = merge_expr(A.expr, B.expr, o.token);
+  else
+    out.expr.clear();
+  out.used = used2;
+  out.depth = d;
+  out.root = (unsigned char)op;
+  out.canon = canon_apply2(op, A.canon, A.root, B.canon, B.root);
+  return true;
+}
+
+bool Solver::try_unary(int op, const Node &A, Node &out) {
+  return try_op1(OP_SQRT + op, A, out);
+}
+
+bool Solver::try_binary(int op, const Node &A, const Node &B, Node &out) {
+  const BinMove &m = BIN_MOVES[op];
+  return m.swap ? try_op2(m.op, B, A, out) : try_op2(m.op, A, B, out);
+}
+
+void Solver::NodeSeen::clear() {
+  small.clear();
+  big.clear();
+}
+
+unsigned long long Solver::NodeSeen::small_tag(const Node &nd, bool cat) {
+  unsigned long long tag = (unsigned)nd.depth;
+  for (int i = 0; i < F_CNT; i++)
+    tag = (tag << 8) | nd.used[i];
+  if (cat && is_literal_node(nd))
+    tag |= nd.root == OP_LEAF ? 1ULL << 63 : 1ULL << 62;
+  return tag;
+}
+
+bool Solver::NodeSeen::insert(const Node &nd) {
+  if (!nd.num.has_ll)
+    return big.insert(node_key(nd, cat)).second;
+  return small.insert({nd.num.ll, small_tag(nd, cat)}).second;
+}
+
+void Solver::add_closure(const Node &A, vector<Node> &out, NodeSeen &seen) {
+  if (!seen.insert(A))
+    return;
+  size_t k = out.size();
+  out.push_back(A);
+  if (config->only_arithmetic)
+    return;
+  for (; k < out.size(); k++) {
+    for (int op = 0; op < UNARY_OPS; op++) {
+      Node nd;
+      if (try_unary(op, out[k], nd) && seen.insert(nd))
+        out.push_back(std::move(nd));
+    }
+  }
+}
+
+Solver::Want Solver::Want::of_ll(long long v) {
+  Want w;
+  w.num.sign = v > 0 ? 1 : (v < 0 ? -1 : 0);
+  w.num.has_ll = true;
+  w.num.ll = v;
+  w.has_pe = (v == 0);
+  return w;
+}
+
+Solver::Want Solver::Want::of_num(const SolverConfig &cfg, Num n) {
+  normalize_num(cfg, n);
+  Want w;
+  w.num = std::move(n);
+  w.has_pe = true;
+  return w;
+}
+
+const Num &Solver::Want::full() {
+  if (!has_pe) {
+    num.pe = factorize_small(llabs(num.ll));
+    has_pe = true;
+  }
+  return num;
+}
+
+void Solver::ValueIndex::clear() {
+  small.clear();
+  big.clear();
+  all.clear();
+}
+
+void Solver::ValueIndex::add(const Num &n, int i) {
+  if (n.has_ll)
+    small[n.ll].push_back(i);
+  else
+    big[num_key(n)].push_back(i);
+  all.push_back(i);
+}
+
+void Solver::ValueIndex::build(const vector<Node> &nodes) {
+  clear();
+  for (int i = 0; i < (int)nodes.size(); i++)
+    add(nodes[i].num, i);
+}
+
+const vector<int> *Solver::ValueIndex::find(const Want &w) const {
+  if (w.any)
+    return &all;
+  if (w.num.has_ll) {
+    auto it = small.find(w.num.ll);
+    return it == small.end() ? nullptr : &it->second;
+  }
+  auto it = big.find(num_key(w.num));
+  return it == big.end() ? nullptr : &it->second;
+}
+
+template <class Fn>
+bool Solver::for_each_inverse(const SolverConfig &cfg, const Num &xn, Want &t,
+                              bool big_ok, Fn fn) {
+  if (for_each_arith_inverse(cfg, xn, t, big_ok, fn))
+    return true;
+  if (cfg.max_use[F_POW] == 0 && cfg.max_use[F_CAT] == 0)
+    return false;
+  return for_each_extra_inverse(cfg, xn, t, big_ok, fn);
+}
+
+template <class Fn>
+bool Solver::for_each_extra_inverse(const SolverConfig &cfg, const Num &xn,
+                                    Want &t, bool big_ok, Fn fn) {
+  if (cfg.max_use[F_POW] > 0 && xn.sign != 0 && t.num.sign != 0) {
+    const Num &tn = t.full();
+    // X^Y = t  =>  t 的各指数都是 X 的同一倍数 Y
+    long long k;
+    if (pe_log(xn.pe, tn.pe, k) && k >= 2) {
+      Want y = Want::of_ll(k);
+      if (fn(8, y))
+        return true;
+    }
+    // Y^X = t  =>  Y 为 t 的 X 次方根（负数只有奇数次方根）
+    if (xn.has_ll && xn.ll >= 2 && xn.ll <= cfg.max_exp_sum &&
+        (tn.sign > 0 || (xn.ll & 1))) {
+      Num r;
+      r.sign = tn.sign;
+      if (!tn.pe.empty() && pe_root(tn.pe, xn.ll, r.pe)) {
+        Want y = Want::of_num(cfg, std::move(r));
+        if ((y.num.has_ll || big_ok) && fn(9, y))
+          return true;
+      }
+    }
+  }
+  if (cfg.max_use[F_CAT] > 0 && xn.has_ll && t.num.has_ll) {
+    const long long x = xn.ll, v = t.num.ll;
+    // X || Y = v  =>  Y 为 v 去掉前缀 X 后的部分（不能有前导零）
+    if (x >= 1 && v > x) {
+      for (long long span = 10; span <= v; span *= 10) {
+        if (v / span != x)
+          continue;
+        long long y = v % span;
+        if (digit_span(y) == span) {
+          Want w = Want::of_ll(y);
+          if (fn(10, w))
+            return true;
+        }
+        break;
+      }
+    }
+    // Y || X = v  =>  v 以 X 结尾，Y 为剩下的前缀
+    if (x >= 0 && v >= 10) {
+      long long span = digit_span(x);
+      if (v % span == x && v / span >= 1) {
+        Want w = Want::of_ll(v / span);
+        if (fn(11, w))
+          return true;
+      }
+    }
+  }
+  return false;
+}
+
+template <class Fn>
+bool Solver::for_each_arith_inverse(const SolverConfig &cfg, const Num &xn,
+                                    Want &t, bool big_ok, Fn fn) {
+  if (xn.has_ll && t.num.has_ll) {
+    const __int128 x = xn.ll, v = t.num.ll;
+    const __int128 ys[3] = {v - x, x - v, v + x}; // X+Y, X-Y, Y-X
+    for (int op = 0; op < 3; op++) {
+      Want y;
+      if (ys[op] <= cfg.max_abs_val && ys[op] >= -cfg.max_abs_val) {
+        y = Want::of_ll((long long)ys[op]);
+      } else {
+        // 略超 max_abs_val 的 Y 只可能是大数
+        Num r;
+        r.sign = ys[op] < 0 ? -1 : 1;
+        if (!big_ok ||
+            !factorize_checked((u64)(ys[op] < 0 ? -ys[op] : ys[op]), r.pe))
+          continue;
+        y = Want::of_num(cfg, std::move(r));
+      }
+      if (fn(op, y))
+        return true;
+    }
+  } else if (big_ok) {
+    // 有大数参与的加减
+    Num r;
+    const Num &tn = t.full();
+    if (num_add_big(cfg, tn, xn, true, r)) {
+      Want y = Want::of_num(cfg, r);
+      if (fn(0, y))
+        return true;
+    }
+    if (num_add_big(cfg, xn, tn, true, r)) {
+      Want y = Want::of_num(cfg, r);
+      if (fn(1, y))
+        return true;
+    }
+    if (num_add_big(cfg, tn, xn, false, r)) {
+      Want y = Want::of_num(cfg, std::move(r));
+      if (fn(2, y))
+        return true;
+    }
+  }
+  if (t.num.has_ll && t.num.ll >= 1 && xn.sign > 0 && !xn.pe.empty()) {
+    const long long v = t.num.ll;
+    // log_X(Y) = t  =>  Y = X^t
+    __int128 p = 1;
+    long long k = 0;
+    while (xn.has_ll && k < v && p <= cfg.max_abs_val) {
+      p *= xn.ll;
+      ++k;
+    }
+    if (xn.has_ll && k == v && p <= cfg.max_abs_val) {
+      Want y = Want::of_ll((long long)p);
+      if (fn(6, y))
+        return true;
+    } else if (big_ok && exp_sum(xn.pe) * v <= cfg.max_exp_sum * 2) {
+      Num r;
+      r.sign = 1;
+      r.pe = xn.pe;
+      for (auto &kv : r.pe)
+        kv.second = (int)(kv.second * v);
+      Want y = Want::of_num(cfg, std::move(r));
+      if (fn(6, y))
+        return true;
+    }
+    // log_Y(X) = t  =>  Y^t = X
+    Num r;
+    r.sign = 1;
+    if (pe_root(xn.pe, v, r.pe)) {
+      Want y = Want::of_num(cfg, std::move(r));
+      if ((y.num.has_ll || big_ok) && fn(7, y))
+        return true;
+    }
+  }
+
+  // X*Y、X/Y、Y/X
+  if (xn.sign == 0) {
+    if (t.num.sign != 0)
+      return false;
+    Want y;
+    y.any = true;
+    return fn(3, y) || fn(4, y);
+  }
+  if (t.num.sign == 0) {
+    Want y = Want::of_ll(0);
+    return fn(3, y) || fn(5, y);
+  }
+  if (xn.has_ll && t.num.has_ll) {
+    // 常见情形直接整除，省去质因数分解
+    const long long x = xn.ll, v = t.num.ll;
+    if (v % x == 0) {
+      Want y = Want::of_ll(v / x);
+      if (fn(3, y))
+        return true;
+    }
+    if (x % v == 0) {
+      Want y = Want::of_ll(x / v);
+      if (fn(4, y))
+        return true;
+    }
+    const __int128 m = (__int128)v * x;
+    if (m <= cfg.max_abs_val && m >= -cfg.max_abs_val) {
+      Want y = Want::of_ll((long long)m);
+      return fn(5, y);
+    }
+    if (!big_ok)
+      return false;
+    Num r;
+    r.sign = xn.sign * t.num.sign;
+    r.pe = factors_add(xn.pe, t.full().pe);
+    Want y = Want::of_num(cfg, std::move(r));
+    return fn(5, y);
+  }
+  // 有大数参与：在质因数指数上反解
+  const Num &tn = t.full();
+  Num r;
+  r.sign = xn.sign * tn.sign;
+  if (factors_subtract(tn.pe, xn.pe, r.pe)) {
+    Want y = Want::of_num(cfg, r);
+    if (fn(3, y))
+      return true;
+  }
+  if (factors_subtract(xn.pe, tn.pe, r.pe)) {
+    Want y = Want::of_num(cfg, r);
+    if (fn(4, y))
+      return true;
+  }
+  r.pe = factors_add(xn.pe, tn.pe);
+  Want y = Want::of_num(cfg, std::move(r));
+  return fn(5, y);
+}
+
+void Solver::unary_preimages(const SolverConfig &cfg, const Want &y,
+                             vector<Preimage> &out) {
+  out.clear();
+  out.push_back({y, {}});
+  if (cfg.only_arithmetic)
+    return;
+  for (size_t k = 0; k < out.size(); k++) {
+    if ((int)out[k].chain.size() >= cfg.max_nest)
+      continue;
+    const Want cur = out[k].z;
+    const vector<int> chain = out[k].chain;
+    auto push_want = [&](int op, Want z) {
+      int uses = (int)count(chain.begin(), chain.end(), op);
+      if (uses + 1 > cfg.max_use[op])
+        return;
+      Preimage pre;
+      pre.z = std::move(z);
+      pre.chain.reserve(chain.size() + 1);
+      pre.chain.push_back(op);
+      pre.chain.insert(pre.chain.end(), chain.begin(), chain.end());
+      out.push_back(std::move(pre));
+    };
+    auto push = [&](int op, long long z) { push_want(op, Want::of_ll(z)); };
+    // 超出 long long 的原像按质因数指数给出（大数的 sqrt、lg、lb）
+    auto push_pe = [&](int op, vector<pair<int, int>> pe) {
+      if (exp_sum(pe) > cfg.max_exp_sum * 2)
+        return;
+      Num z;
+      z.sign = 1;
+      z.pe = std::move(pe);
+      push_want(op, Want::of_num(cfg, std::move(z)));
+    };
+    if (!cur.num.has_ll) {
+      auto it = cfg.fact->big.find(num_key(cur.num));
+      if (it != cfg.fact->big.end())
+        push(F_FACT, it->second);
+      if (cur.num.sign > 0) {
+        vector<pair<int, int>> sq = cur.num.pe;
+        for (auto &kv : sq)
+          kv.second *= 2;
+        push_pe(F_SQRT, std::move(sq));
+      }
+      continue;
+    }
+    long long v = cur.num.ll;
+    if (v >= 2 && (__int128)v * v <= cfg.max_abs_val)
+      push(F_SQRT, v * v);
+    else if (v >= 2)
+      push_pe(F_SQRT, factors_add(factorize_small(v), factorize_small(v)));
+    auto it = cfg.fact->small.find(v);
+    if (it != cfg.fact->small.end())
+      push(F_FACT, it->second);
+    // 10^v、2^v 超出 max_abs_val 时按质因数指数给出
+    if (v >= 1) {
+      __int128 z = 1;
+      for (long long i = 0; i < v && z <= cfg.max_abs_val; i++)
+        z *= 10;
+      if (z <= cfg.max_abs_val)
+        push(F_LG, (long long)z);
+      else if (v <= cfg.max_exp_sum)
+        push_pe(F_LG, {{2, (int)v}, {5, (int)v}});
+    }
+    if (v >= 1 && v != 2 && v != 4) {
+      if (v <= 62 && (1LL << v) <= cfg.max_abs_val)
+        push(F_LB, 1LL << v);
+      else if (v <= cfg.max_exp_sum * 2)
+        push_pe(F_LB, {{2, (int)v}});
+    }
+  }
+}
+
+bool Solver::try_last(int op, const Node &X, const Node &Y) {
+  Node C;
+  if (!try_binary(op, X, Y, C))
+    return false;
+  vector<Node> leaf;
+  leaf.push_back(std::move(C));
+  enter(std::move(leaf));
+  return found;
+}
+
+void Solver::solve_last(const vector<Node> &cur) {
+  const SolverConfig &cfg = *config;
+  if (cfg.target <= 0)
+    return;
+  int n = (int)cur.size();
+  last_seen.cat = cat_enabled();
+  for (int i = 0; i < n; i++) {
+    last_seen.clear();
+    last_closure[i].clear();
+    add_closure(cur[i], last_closure[i], last_seen);
+  }
+  Want target;
+  target.num.sign = 1;
+  target.num.pe = cfg.target_factors;
+  normalize_num(cfg, target.num);
+  target.has_pe = true;
+
+  if (n == 2) {
+    const vector<Node> &ys = last_closure[1];
+    last_index.build(ys);
+    for (const Node &X : last_closure[0]) {
+      bool hit = for_each_inverse(cfg, X.num, target,
+                                  !last_index.big.empty(),
+                                  [&](int op, Want &y) {
+        if (const vector<int> *idx = last_index.find(y))
+          for (int i : *idx)
+            if (try_last(op, X, ys[i]))
+              return true;
+        return false;
+      });
+      if (hit)
+        return;
+    }
+    return;
+  }
+
+  for (int p = 0; p < 3; p++) {
+    const vector<Node> &cq = last_closure[(p + 1) % 3];
+    const vector<Node> &cr = last_closure[(p + 2) % 3];
+    last_index.build(cr);
+    for (const Node &X : last_closure[p]) {
+      bool hit = for_each_inverse(cfg, X.num, target, true,
+                                  [&](int op1, Want &y) {
+        if (y.any)
+          return false; // 目标为正，不会出现
+        unary_preimages(cfg, y, last_pre);
+        for (Preimage &pre : last_pre) {
+          for (const Node &Q : cq) {
+            bool ok = for_each_inverse(cfg, Q.num, pre.z,
+                                       !last_index.big.empty(),
+                                       [&](int op2, Want &r) {
+              const vector<int> *idx = last_index.find(r);
+              if (!idx)
+                return false;
+              for (int i : *idx) {
+                Node Z;
+                if (!try_binary(op2, Q, cr[i], Z))
+                  continue;
+                bool chain_ok = true;
+                for (int u : pre.chain) {
+                  Node next;
+                  if (!try_unary(u, Z, next)) {
+                    chain_ok = false;
+                    break;
+                  }
+                  Z = std::move(next);
+                }
+                if (chain_ok && try_last(op1, X, Z))
+                  return true;
+              }
+              return false;
+            });
+            if (ok)
+              return true;
+          }
+        }
+        return false;
+      });
+      if (hit)
+        return;
+    }
+  }
+}
+
+void Solver::enter(vector<Node> &&cur) {
+  if (search_done())
+    return;
+
+  if (cur.size() == 1) {
+    if (!targets.empty()) {
+      hit_targets(cur[0]);
+      return;
+    }
+    if (is_target_24(*config, cur[0].num) &&
+        count_leaf_tokens(cur[0].expr) == expected_leaf_count) {
+      if (find_first) {
+        found = true;
+        first_expr = cur[0].expr;
+        if (immediate_print)
+          emit(cur[0].expr);
+      } else {
+        found = true;
+        add_answer(cur[0].expr, cur[0].canon.key);
+      }
+    } else if (near.k > 0 && !found) {
+      near.offer(*config, cur[0], expected_leaf_count);
+    }
+    return;
+  }
+
+  if (find_first || MEMO_IN_FIND_ALL) {
+    if (SKIP_EQUIV_DURING_SEARCH && !equiv_seen.insert(equiv_key(cur)).second)
+      return;
+    if (find_first && dominance ? dominated(cur)
+                                : !memo.insert(state_key(cur, cat_enabled()),
+                                               true))
+      return;
+    mem_check();
+  }
+
+  if (find_first && targets.empty() && cur.size() <= 3) {
+    solve_last(cur);
+    return;
+  }
+
+  Frame f;
+  f.cur = std::move(cur);
+  if (config->only_arithmetic)
+    f.stage = ST_BINARY;
+  f.ordered = find_first && move_ordering;
+  stack.push_back(std::move(f));
+}
+
+int Solver::class_bonus(int vc) {
+  static const int BONUS[VC_CNT] = {2, 3, 3, 4, 1, 1, 0, -1};
+  return BONUS[vc] * 16;
+}
+
+void Solver::order_moves(Frame &f) {
+  const SolverConfig &cfg = *config;
+  const int n = (int)f.cur.size();
+  const int killer = g_move_history.killer_at(n);
+  size_t bytes = 0;
+  Move m;
+  while (next_move(f, m)) {
+    int ca = value_class(cfg, f.cur[m.i].num);
+    int cb = m.j < 0 ? 0 : value_class(cfg, f.cur[m.j].num);
+    m.key = MoveHistory::key(m.move, ca, cb);
+    m.score = (int)g_move_history.get(m.key) +
+              class_bonus(value_class(cfg, m.node.num));
+    if (m.j < 0)
+      m.score -= 16; // 一元走法不减少个数
+    if (m.key == killer)
+      m.score = INT_MAX;
+    bytes += sizeof(Move) + expr_bytes(m.node.expr);
+    f.moves.push_back(std::move(m));
+    m = Move();
+  }
+  f.pair_bytes += bytes; // 与 pair_seen 一起在出栈时扣除
+  mem_pairs += bytes;
+  mem_check();
+  stable_sort(f.moves.begin(), f.moves.end(),
+              [](const Move &a, const Move &b) { return a.score > b.score; });
+}
+
+void Solver::reward_path() {
+  for (const Frame &f : stack)
+    if (f.ordered && f.next > 0)
+      g_move_history.reward(f.moves[f.next - 1].key, (int)f.cur.size());
+}
+
+bool Solver::next_child(Frame &f, vector<Node> &child) {
+  if (f.ordered) {
+    if (f.next == 0 && f.moves.empty())
+      order_moves(f);
+    if (f.next == f.moves.size())
+      return false;
+    const Move &m = f.moves[f.next++];
+    if (m.j < 0) {
+      child = f.cur;
+      child[m.i] = m.node;
+      return true;
+    }
+    child.clear();
+    child.reserve(f.cur.size() - 1);
+    for (int k = 0; k < (int)f.cur.size(); k++)
+      if (k != m.i && k != m.j)
+        child.push_back(f.cur[k]);
+    child.push_back(m.node);
+    return true;
+  }
+  Move m;
+  if (!next_move(f, m))
+    return false;
+  if (m.j < 0) {
+    child = f.cur;
+    child[m.i] = std::move(m.node);
+  } else {
+    child.reserve(f.rest.size() + 1);
+    child = f.rest;
+    child.push_back(std::move(m.node));
+  }
+  return true;
+}
+
+bool Solver::next_move(Frame &f, Move &m) {
+  int n = (int)f.cur.size();
+  while (f.stage == ST_UNARY) {
+    if (f.i >= n) {
+      f.stage = ST_BINARY;
+      f.i = 0;
+      f.j = 1;
+      f.op = 0;
+      break;
+    }
+    bool ok = try_unary(f.op, f.cur[f.i], m.node);
+    m.move = f.op;
+    m.i = f.i;
+    m.j = -1;
+    if (++f.op == UNARY_OPS) {
+      f.op = 0;
+      f.i++;
+    }
+    if (ok)
+      return true;
+  }
+
+  while (f.stage == ST_BINARY) {
+    if (f.j >= n) {
+      f.i++;
+      f.j = f.i + 1;
+      if (f.j >= n) {
+        f.stage = ST_DONE;
+        break;
+      }
+    }
+    if (f.op == 0) {
+      string pair_key = node_key(f.cur[f.i], cat_enabled());
+      pair_key.push_back('|');
+      pair_key += node_key(f.cur[f.j], cat_enabled());
+      size_t kb = string_bytes(pair_key) + HASH_ENTRY_OVERHEAD;
+      if (!f.pair_seen.insert(std::move(pair_key)).second) {
+        f.j++;
+        continue;
+      }
+      f.pair_bytes += kb;
+      mem_pairs += kb;
+      mem_check();
+      f.rest.clear();
+      f.rest.reserve(n - 1);
+      for (int k = 0; k < n; k++)
+        if (k != f.i && k != f.j)
+          f.rest.push_back(f.cur[k]);
+    }
+    bool ok = try_binary(f.op, f.cur[f.i], f.cur[f.j], m.node);
+    m.move = UNARY_OPS + f.op;
+    m.i = f.i;
+    m.j = f.j;
+    if (++f.op == BINARY_OPS) {
+      f.op = 0;
+      f.j++;
+    }
+    if (ok)
+      return true;
+  }
+  return false;
+}
+
+bool Solver::step(long long max_states, long long max_us) {
+  using clk = chrono::steady_clock;
+  const clk::time_point t0 = clk::now();
+  long long slice = 0;
+  while (!stack.empty()) {
+    if (search_done()) {
+      clear_stack();
+      break;
+    }
+    vector<Node> child;
+    if (!next_child(stack.back(), child)) {
+      mem_pairs -= stack.back().pair_bytes;
+      stack.pop_back();
+      continue;
+    }
+    bool had = found;
+    enter(std::move(child));
+    if (!had && found && find_first)
+      reward_path();
+    ++states;
+    ++slice;
+    if (max_states > 0 && slice >= max_states)
+      return stack.empty();
+    if (max_us > 0 && (slice & 63) == 0 &&
+        chrono::duration_cast<chrono::microseconds>(clk::now() - t0)
+                .count() >= max_us)
+      return stack.empty();
+  }
+  return true;
+}
+
+double Solver::progress() const {
+  if (stack.empty())
+    return 1.0;
+  double done = 0.0, weight = 1.0;
+  for (const Frame &f : stack) {
+    int n = (int)f.cur.size();
+    int unary = config->only_arithmetic ? 0 : n * UNARY_OPS;
+    int total = unary + n * (n - 1) / 2 * BINARY_OPS;
+    if (total <= 0)
+      break;
+    int pos;
+    if (f.ordered) {
+      total = (int)max<size_t>(f.moves.size(), 1);
+      pos = (int)f.next;
+    } else if (f.stage == ST_UNARY) {
+      pos = f.i * UNARY_OPS + f.op;
+    } else if (f.stage == ST_BINARY) {
+      // (i,j) 之前的二元对个数
+      int before = f.i * n - f.i * (f.i + 1) / 2 + (f.j - f.i - 1);
+      pos = unary + before * BINARY_OPS + f.op;
+    } else {
+      pos = total;
+    }
+    // 游标已越过当前子状态，回退一格得到其起点
+    double at = max(0, pos - 1);
+    done += weight * at / total;
+    weight /= total;
+  }
+  return min(1.0, done);
+}
+
+void Solver::clear_stack() {
+  stack.clear();
+  mem_pairs = 0;
+}
+
+void Solver::dfs(vector<Node> cur) {
+  clear_stack();
+  enter(std::move(cur));
+  step();
+}
+
+double Solver::merge_orders(const vector<Node> &cur) {
+  double orders = 1;
+  int k = 0;
+  vector<int> st;
+  for (const Node &nd : cur) {
+    st.clear();
+    for (const string &t : nd.expr) {
+      int op = op_of_token(t);
+      if (op == OP_LEAF) {
+        st.push_back(0);
+        continue;
+      }
+      int h = 1;
+      for (int a = 0; a < OPS[op].arity; a++) {
+        h += st.back();
+        st.pop_back();
+      }
+      st.push_back(h);
+      orders /= h;
+      orders *= ++k;
+    }
+  }
+  return orders;
+}
+
+CostEstimate Solver::estimate_cost(const vector<Node> &input,
+                                   bool findFirstOnly, int samples,
+                                   uint64_t seed) {
+  using clk = chrono::steady_clock;
+  const clk::time_point t0 = clk::now();
+  reset(input, findFirstOnly, false);
+  mem_budget = 0;
+  const SolverConfig &cfg = *config;
+
+  CostEstimate e;
+  e.find_first = findFirstOnly;
+  e.samples = max(1, samples);
+  e.numbers = (int)input.size();
+  for (const Node &nd : input)
+    if (nd.num.has_ll)
+      e.max_abs = max(e.max_abs, fabs((double)nd.num.ll));
+  if (!cfg.only_arithmetic)
+    for (int f = 0; f < F_CNT; f++)
+      e.func_budget += cfg.max_use[f];
+
+  const size_t leaf = findFirstOnly ? 3 : 1;
+  mt19937_64 rng(seed);
+  double sum = 0, sum_sq = 0, vsum = 0, vsum_sq = 0;
+  for (int s = 0; s < e.samples; s++) {
+    vector<Node> cur = input;
+    double width = 1, est = 1, visits = 0;
+    while (cur.size() > leaf) {
+      Frame f;
+      f.cur = std::move(cur);
+      if (cfg.only_arithmetic)
+        f.stage = ST_BINARY;
+      // 蓄水池抽样：第 d 个子状态以 1/d 的概率替换已选的
+      vector<Node> child, pick;
+      unsigned long long d = 0;
+      while (next_child(f, child))
+        if (rng() % ++d == 0)
+          pick.swap(child);
+      mem_pairs -= f.pair_bytes;
+      if (d == 0)
+        break;
+      visits += width * (double)d / merge_orders(f.cur);
+      width *= (double)d;
+      est += width;
+      cur = std::move(pick);
+    }
+    sum += est;
+    sum_sq += est * est;
+    vsum += visits;
+    vsum_sq += visits * visits;
+  }
+  const double k = e.samples;
+  e.tree = sum / k;
+  e.states = vsum / k;
+  if (e.samples > 1 && e.states > 0) {
+    double var = max(0.0, (vsum_sq - vsum * vsum / k) / (k - 1));
+    e.rel_err = sqrt(var / k) / e.states;
+  }
+  e.probe_us =
+      chrono::duration_cast<chrono::microseconds>(clk::now() - t0).count();
+  return e;
+}
+
+vector<Node> Solver::parse_nodes_from_line(const SolverConfig &cfg,
+                                           const string &line) {
+  vector<Node> res;
+  long long x;
+  size_t pos = 0;
+  while (scan_ll(line, pos, x)) {
+    bool ok;
+    Num n = make_num_from_ll_pruned(cfg, x, ok);
+    if (!ok)
+      continue;
+    Node nd;
+    nd.num = std::move(n);
+    nd.expr = {to_string(x)};
+    nd.used.fill(0);
+    nd.depth = 0;
+    nd.canon = canon_leaf(nd.expr[0]);
+    res.push_back(std::move(nd));
+  }
+  return res;
+}
+
+bool Solver::parse_targets(const SolverConfig &cfg, const string &text,
+                           vector<long long> &out, size_t max_count) {
+  out.clear();
+  unordered_set<long long> seen;
+  static const char *const SEP = " \t\r\n,";
+  for (size_t b = text.find_first_not_of(SEP); b != string::npos;) {
+    size_t e = text.find_first_of(SEP, b);
+    string tok = text.substr(b, e - b); // e 为 npos 时取到末尾
+    b = text.find_first_not_of(SEP, e);
+    long long lo, hi;
+    size_t dash = tok.find('-', 1);
+    if (dash == string::npos) {
+      if (!try_parse_ll(tok, lo))
+        return false;
+      hi = lo;
+    } else if (!try_parse_ll(tok.substr(0, dash), lo) ||
+               !try_parse_ll(tok.substr(dash + 1), hi)) {
+      return false;
+    }
+    if (lo <= 0 || lo > hi || hi > cfg.max_abs_val)
+      return false;
+    if ((unsigned long long)(hi - lo) >= max_count)
+      return false;
+    for (long long t = lo; t <= hi; t++) {
+      if (!seen.insert(t).second)
+        continue;
+      if (out.size() >= max_count)
+        return false;
+      out.push_back(t);
+    }
+  }
+  return !out.empty();
+}
+
+bool Solver::nodes_from_values(const SolverConfig &cfg,
+                               const vector<long long> &nums,
+                               vector<Node> &out) {
+  out.clear();
+  out.reserve(nums.size());
+  for (long long x : nums) {
+    bool ok;
+    Num n = make_num_from_ll_pruned(cfg, x, ok);
+    if (!ok)
+      return false;
+    Node nd;
+    nd.num = std::move(n);
+    nd.expr = {to_string(x)};
+    nd.used.fill(0);
+    nd.depth = 0;
+    nd.canon = canon_leaf(nd.expr[0]);
+    out.push_back(std::move(nd));
+  }
+  return true;
+}
+
+bool Solver::solve_first(const vector<long long> &nums,
+                         vector<string> &out_expr) {
+  found = false;
+  vector<Node> cur;
+  if (!nodes_from_values(*config, nums, cur))
+    return false;
+
+  reset(cur, true, false);
+  immediate_print = true;
+  immediate_prefix = ">>> ";
+  int tt = reach_tt_find_first(config, nums, first_expr);
+  if (tt >= 0) {
+    found = tt == 1;
+    if (found)
+      emit(first_expr);
+  } else {
+    dfs(cur);
+  }
+  if (found)
+    out_expr = first_expr;
+  return found;
+}
+
+void Solver::begin(const vector<Node> &input, bool findFirstOnly, bool print) {
+  reset(input, findFirstOnly, print);
+  if (findFirstOnly) {
+    vector<long long> nums;
+    for (const Node &nd : input) {
+      if (nd.expr.size() != 1 || !nd.num.has_ll)
+        break;
+      nums.push_back(nd.num.ll);
+    }
+    if (nums.size() == input.size()) {
+      int tt = reach_tt_find_first(config, nums, first_expr);
+      if (tt >= 0) {
+        found = tt == 1;
+        return; // 栈为空，step 立即结束
+      }
+    }
+  }
+  enter(vector<Node>(input));
+}
+
+void Solver::begin_targets(const vector<Node> &input,
+                           const vector<long long> &ts, bool findFirstOnly) {
+  reset(input, findFirstOnly, false);
+  for (long long t : ts) {
+    if (!target_index.emplace(t, (int)targets.size()).second)
+      continue;
+    TargetHits h;
+    h.target = t;
+    targets.push_back(std::move(h));
+  }
+  targets_pending = (int)targets.size();
+  enter(vector<Node>(input));
+}
+
+void Solver::reset(const vector<Node> &input, bool findFirstOnly, bool print) {
+  found = false;
+  first_expr.clear();
+  release();
+  targets_pending = 0;
+  near.clear();
+  mem_budget = config->memory_budget;
+  mem_peak = 0;
+  mem_truncated = false;
+  states = 0;
+  immediate_print = print && !findFirstOnly && top_k == 0;
+  immediate_prefix.clear();
+  // 初始结点可以是已做好的式子（提示模式），按叶子数而不是结点数计
+  expected_leaf_count = 0;
+  for (const Node &nd : input)
+    expected_leaf_count += count_leaf_tokens(nd.expr);
+  find_first = findFirstOnly;
+}
+
+void Solver::finish() {
+  clear_stack();
+  if (find_first) {
+    if (found && !immediate_print && targets.empty())
+      add_answer(first_expr, canon_of_expr(first_expr));
+    for (TargetHits &h : targets) {
+      bool is_better;
+      if (h.found)
+        record_answer(h, h.first_expr, canon_of_expr(h.first_expr),
+                      is_better);
+    }
+  }
+}
+
+void Solver::solve_all_or_first_normal(const vector<Node> &input,
+                                       bool findFirstOnly) {
+  begin(input, findFirstOnly);
+  step();
+  finish();
+}
+
+// ======================= 可达表：子多重集的全部可达值 =======================
+string ReachBuilder::multiset_key(const vector<long long> &ms) {
+  string k;
+  for (long long x : ms) {
+    k += to_string(x);
+    k.push_back(' ');
+  }
+  return k;
+}
+
+bool ReachBuilder::halted() {
+  if (!stopped && stop && stop())
+    stopped = true;
+  return stopped;
+}
+
+void ReachBuilder::Acc::add(Node &&nd, unsigned long long cnt) {
+  pair<size_t *, bool> slot;
+  if (nd.num.has_ll) {
+    auto r = small.emplace(
+        make_pair(nd.num.ll, Solver::NodeSeen::small_tag(nd, cat)),
+        out.size());
+    slot = {&r.first->second, r.second};
+  } else {
+    auto r = big.emplace(Solver::node_key(nd, cat), out.size());
+    slot = {&r.first->second, r.second};
+  }
+  if (!slot.second) {
+    out[*slot.first].count = sat_add_u64(out[*slot.first].count, cnt);
+    return;
+  }
+  ReachEntry e;
+  e.node = std::move(nd);
+  e.count = cnt;
+  out.push_back(std::move(e));
+}
+
+template <class Emit>
+void ReachBuilder::combine(const ReachEntry &a, const ReachEntry &b,
+                           unsigned long long comm, unsigned long long ord,
+                           Emit &emit) {
+  static const unsigned char order[] = {OP_ADD, OP_MUL, OP_SUB, OP_DIV,
+                                        OP_LOG, OP_POW, OP_CAT};
+  const Node &A = a.node, &B = b.node;
+  Node C;
+  for (unsigned char op : order)
+    if (ops.try_op2(op, A, B, C))
+      emit(std::move(C), OPS[op].commutative ? comm : ord);
+  if (&a == &b)
+    return; // 同一项：反向与正向相同
+  for (unsigned char op : order)
+    if (!OPS[op].commutative && ops.try_op2(op, B, A, C))
+      emit(std::move(C), ord);
+}
+
+void ReachBuilder::unary_closure(Acc &acc) {
+  const SolverConfig &c = *ops.config;
+  if (c.only_arithmetic)
+    return;
+  int max_level = 0;
+  for (int i = 0; i < F_CNT; i++)
+    max_level += c.max_use[i];
+  for (int level = 0; level < max_level; level++) {
+    size_t n = acc.out.size();
+    for (size_t i = 0; i < n; i++) {
+      if (used_sum(acc.out[i].node) != level)
+        continue;
+      Node src = acc.out[i].node;
+      unsigned long long cnt = acc.out[i].count;
+      Node out;
+      for (int op = 0; op < Solver::UNARY_OPS; op++)
+        if (ops.try_unary(op, src, out))
+          acc.add(std::move(out), cnt);
+    }
+  }
+}
+
+template <class Fn>
+void ReachBuilder::for_each_split(const vector<long long> &ms, Fn fn) {
+  // 不同取值及其重数；枚举子重数向量 sub（补集 comp），无序拆分只取 sub <= comp
+  vector<long long> vals;
+  vector<int> mult;
+  for (long long x : ms) {
+    if (vals.empty() || vals.back() != x) {
+      vals.push_back(x);
+      mult.push_back(0);
+    }
+    mult.back()++;
+  }
+  size_t d = vals.size();
+  vector<int> sub(d, 0), comp(d);
+  while (true) {
+    size_t p = 0;
+    while (p < d && sub[p] == mult[p])
+      sub[p++] = 0;
+    if (p == d)
+      break;
+    sub[p]++;
+
+    bool comp_empty = true;
+    for (size_t i = 0; i < d; i++) {
+      comp[i] = mult[i] - sub[i];
+      if (comp[i])
+        comp_empty = false;
+    }
+    if (comp_empty || comp < sub)
+      continue;
+    vector<long long> A, B;
+    for (size_t i = 0; i < d; i++) {
+      A.insert(A.end(), sub[i], vals[i]);
+      B.insert(B.end(), comp[i], vals[i]);
+    }
+    fn(A, B, sub == comp);
+  }
+}
+
+template <class Emit>
+void ReachBuilder::for_each_combo(const vector<long long> &ms, Emit &emit) {
+  for_each_split(ms, [&](const vector<long long> &A,
+                         const vector<long long> &B, bool same) {
+    if (halted())
+      return;
+    shared_ptr<const ReachSet> RA = get(A), RB = get(B);
+    if (same) {
+      // A、B 为同一多重集：无序对 {a,b} 只算一次
+      for (size_t i = 0; i < RA->size() && !halted(); i++)
+        for (size_t j = i; j < RA->size(); j++) {
+          const ReachEntry &a = (*RA)[i], &b = (*RA)[j];
+          unsigned long long ord = sat_mul_u64(a.count, b.count);
+          unsigned long long comm = ord;
+          if (i == j) // 同一项内取两棵（可重复）：c(c+1)/2
+            comm = (a.count == ULLONG_MAX)
+                       ? ULLONG_MAX
+                       : sat_mul_u64(a.count, a.count + 1) / 2;
+          combine(a, b, comm, ord, emit);
+        }
+    } else {
+      for (const ReachEntry &a : *RA) {
+        if (halted())
+          return;
+        for (const ReachEntry &b : *RB) {
+          unsigned long long c = sat_mul_u64(a.count, b.count);
+          combine(a, b, c, c, emit);
+        }
+      }
+    }
+  });
+}
+
+ReachSet ReachBuilder::build(const vector<long long> &ms) {
+  Acc acc;
+  acc.cat = ops.cat_enabled();
+  if (ms.size() == 1) {
+    vector<Node> leaf;
+    if (Solver::nodes_from_values(*ops.config, ms, leaf))
+      acc.add(std::move(leaf[0]), 1);
+  } else {
+    size_t added = 0;
+    auto emit = [&](Node &&nd, unsigned long long cnt) {
+      const size_t n = acc.out.size();
+      acc.add(std::move(nd), cnt);
+      added += acc.out.size() - n;
+      pending_entries += acc.out.size() - n;
+    };
+    for_each_combo(ms, emit);
+    pending_entries -= added;
+  }
+  unary_closure(acc);
+  return std::move(acc.out);
+}
+
+unsigned long long ReachBuilder::count_target(const vector<long long> &ms,
+                                              vector<string> &witness) {
+  const SolverConfig &c = *ops.config;
+  unsigned long long total = 0;
+  witness.clear();
+  function<void(const Node &, unsigned long long)> visit =
+      [&](const Node &nd, unsigned long long cnt) {
+        if (is_target_24(c, nd.num)) {
+          total = sat_add_u64(total, cnt);
+          if (witness.empty())
+            witness = nd.expr;
+        }
+        if (c.only_arithmetic)
+          return;
+        Node out;
+        for (int op = 0; op < Solver::UNARY_OPS; op++)
+          if (ops.try_unary(op, nd, out))
+            visit(out, cnt);
+      };
+  if (ms.size() == 1) {
+    vector<Node> leaf;
+    if (Solver::nodes_from_values(c, ms, leaf))
+      visit(leaf[0], 1);
+    return total;
+  }
+  auto emit = [&](Node &&nd, unsigned long long cnt) { visit(nd, cnt); };
+  for_each_combo(ms, emit);
+  return total;
+}
+
+shared_ptr<const ReachSet> ReachBuilder::get(const vector<long long> &ms) {
+  if (use_tt) {
+    shared_ptr<const ReachTable> t = reach_tt_get(*this, ms);
+    return shared_ptr<const ReachSet>(t, &t->set);
+  }
+  string k = multiset_key(ms);
+  auto it = cache.find(k);
+  if (it != cache.end())
+    return it->second;
+  auto rs = make_shared<const ReachSet>(build(ms));
+  if (stopped)
+    return rs;
+  if (cached_entries + rs->size() > max_cached_entries) {
+    cache.clear();
+    cached_entries = 0;
+  }
+  cached_entries += rs->size();
+  cache.emplace(std::move(k), rs);
+  return rs;
+}
+
+// ======================= 跨查询置换表 =======================
+size_t REACH_TT_MAX_BYTES = (size_t)64 << 20;
+static ClockMap<shared_ptr<const ReachTable>> g_reach_tt;
+static mutex g_reach_tt_mutex;
+
+// 在锁内查找 key 的子表（置访问位），没有时返回空
+static shared_ptr<const ReachTable> reach_tt_lookup(const string &key) {
+  lock_guard<mutex> lock(g_reach_tt_mutex);
+  shared_ptr<const ReachTable> *hit = g_reach_tt.find(key);
+  return hit ? *hit : nullptr;
+}
+
+// 在锁内插入 t 并按 REACH_TT_MAX_BYTES 淘汰；其他线程已插入同一个键时
+// 返回先插入的那张
+static shared_ptr<const ReachTable>
+reach_tt_insert(const string &key, shared_ptr<const ReachTable> t) {
+  lock_guard<mutex> lock(g_reach_tt_mutex);
+  if (!g_reach_tt.insert(key, t))
+    return *g_reach_tt.find(key);
+  g_reach_tt.find(key); // 置访问位，刚建的表不会被立即淘汰
+  while (g_reach_tt.bytes() > REACH_TT_MAX_BYTES && g_reach_tt.evict_one()) {
+  }
+  return t;
+}
+
+shared_ptr<const ReachTable> reach_tt_get(ReachBuilder &rb,
+                                          const vector<long long> &ms) {
+  string key = rb.ops.config->reach_key + ReachBuilder::multiset_key(ms);
+  if (shared_ptr<const ReachTable> hit = reach_tt_lookup(key))
+    return hit;
+  auto t = make_shared<ReachTable>();
+  t->set = rb.build(ms); // 子多重集递归经 get 回到本表
+  t->bytes = sizeof(ReachTable) + t->set.capacity() * sizeof(ReachEntry);
+  for (int i = 0; i < (int)t->set.size(); i++) {
+    const Node &nd = t->set[i].node;
+    t->index.add(nd.num, i);
+    t->bytes += expr_bytes(nd.expr) - sizeof(nd.expr) +
+                nd.num.pe.capacity() * sizeof(pair<int, int>) +
+                sizeof(int) + HASH_ENTRY_OVERHEAD / 2;
+  }
+  if (rb.stopped)
+    return t; // 不完整的表不进置换表
+  return reach_tt_insert(key, std::move(t));
+}
+
+bool reach_tt_has(const SolverConfig &cfg, const vector<long long> &ms) {
+  return reach_tt_lookup(cfg.reach_key + ReachBuilder::multiset_key(ms)) !=
+         nullptr;
+}
+
+int reach_tt_find_first(const ConfigPtr &config, const vector<long long> &nums,
+                        vector<string> &witness) {
+  const SolverConfig &cfg = *config;
+  if (cfg.target <= 0 || nums.size() < 2)
+    return -1;
+  vector<long long> ms = nums;
+  sort(ms.begin(), ms.end());
+  ReachBuilder rb(config);
+  rb.use_tt = true;
+  Solver::Want target;
+  target.num.sign = 1;
+  target.num.pe = cfg.target_factors;
+  normalize_num(cfg, target.num);
+  target.has_pe = true;
+
+  bool complete = true, hit = false;
+  ReachBuilder::for_each_split(ms, [&](const vector<long long> &A,
+                                       const vector<long long> &B, bool) {
+    if (hit)
+      return;
+    if ((int)max(A.size(), B.size()) > REACH_TT_MAX_SUBSET) {
+      complete = false;
+      return;
+    }
+    shared_ptr<const ReachTable> TA = reach_tt_get(rb, A);
+    shared_ptr<const ReachTable> TB = reach_tt_get(rb, B);
+    // 遍历较小的一侧，在另一侧的索引中查找（反解覆盖两种操作数顺序）
+    if (TA->set.size() > TB->set.size())
+      swap(TA, TB);
+    Node C;
+    for (const ReachEntry &x : TA->set) {
+      const Node &X = x.node;
+      hit = Solver::for_each_inverse(
+          cfg, X.num, target, !TB->index.big.empty(),
+          [&](int op, Solver::Want &y) {
+            if (const vector<int> *idx = TB->index.find(y))
+              for (int i : *idx)
+                if (rb.ops.try_binary(op, X, TB->set[i].node, C) &&
+                    is_target_24(cfg, C.num)) {
+                  witness = C.expr;
+                  return true;
+                }
+            return false;
+          });
+      if (hit)
+        return;
+    }
+  });
+  if (hit)
+    return 1;
+  return complete ? 0 : -1;
+}
+
+// ======================= 解计数：不同解的个数（不生成表达式） =======================
+SolutionCounter::SolutionCounter(ConfigPtr config)
+    : rb(std::move(config)) {
+  rb.ops.keep_expr = false;
+}
+
+SolutionCounter::Table &SolutionCounter::table(const vector<long long> &ms) {
+  string k = ReachBuilder::multiset_key(ms);
+  auto it = tables.find(k);
+  if (it != tables.end())
+    return it->second;
+  Table &t = tables[k];
+  t.ms = ms;
+  t.set = rb.get(ms);
+  for (int i = 0; i < (int)t.set->size(); i++)
+    t.index.add((*t.set)[i].node.num, i);
+  t.forms.resize(t.set->size());
+  t.expanded.assign(t.set->size(), 0);
+  return t;
+}
+
+bool SolutionCounter::same_num(const Num &a, const Num &b) {
+  if (a.sign != b.sign || a.has_ll != b.has_ll)
+    return false;
+  return a.has_ll ? a.ll == b.ll : a.pe == b.pe;
+}
+
+bool SolutionCounter::same_state(const Node &a, const Node &b, bool cat) {
+  if (!same_num(a.num, b.num) || a.used != b.used || a.depth != b.depth)
+    return false;
+  return !cat || (is_literal_node(a) ? a.root : 0) ==
+                     (is_literal_node(b) ? b.root : 0);
+}
+
+Solver::Want SolutionCounter::want_of(const Num &n) {
+  Solver::Want w;
+  w.num = n;
+  w.has_pe = true;
+  return w;
+}
+
+template <class Fn>
+void SolutionCounter::for_each_binary(const vector<long long> &ms,
+                                      Solver::Want want, Fn fn) {
+  const SolverConfig &cfg = *rb.ops.config;
+  ReachBuilder::for_each_split(ms, [&](const vector<long long> &A,
+                                       const vector<long long> &B, bool) {
+    if (halted())
+      return;
+    Table *TX = &table(A), *TY = &table(B);
+    if (TX->set->size() > TY->set->size())
+      swap(TX, TY);
+    Node C;
+    for (int i = 0; i < (int)TX->set->size() && !halted(); i++) {
+      const Node &X = (*TX->set)[i].node;
+      Solver::for_each_inverse(
+          cfg, X.num, want, !TY->index.big.empty(),
+          [&](int op, Solver::Want &y) {
+            if (const vector<int> *idx = TY->index.find(y))
+              for (int j : *idx)
+                if (rb.ops.try_binary(op, X, (*TY->set)[j].node, C) &&
+                    same_num(C.num, want.num))
+                  fn(C, *TX, i, *TY, j, op);
+            return false;
+          });
+    }
+  });
+}
+
+void SolutionCounter::FormSet::add(const CountForm &f) {
+  auto r = pos.emplace(f.canon.key, out.size());
+  if (r.second)
+    out.push_back(f);
+  else
+    out[r.first->second].classes |= f.classes;
+}
+
+void SolutionCounter::combine_forms(int op, const vector<CountForm> &fx,
+                                    const vector<CountForm> &fy, FormSet &acc) {
+  const Solver::BinMove &m = Solver::BIN_MOVES[op];
+  const unsigned short bit = count_class_bit(m.op);
+  for (const CountForm &a : fx)
+    for (const CountForm &b : fy) {
+      const CountForm &l = m.swap ? b : a, &r = m.swap ? a : b;
+      CountForm f;
+      f.canon = canon_apply2(m.op, l.canon, l.root, r.canon, r.root);
+      f.root = m.op;
+      f.classes = l.classes | r.classes | bit;
+      acc.add(f);
+    }
+}
+
+const vector<CountForm> &SolutionCounter::forms(Table &T, int idx) {
+  if (T.expanded[idx] || halted())
+    return T.forms[idx];
+  T.expanded[idx] = 1;
+  expanded++;
+  const SolverConfig &cfg = *rb.ops.config;
+  const bool cat = rb.ops.cat_enabled();
+  const Node &E = (*T.set)[idx].node;
+  FormSet acc;
+  if (T.ms.size() == 1 && used_sum(E) == 0) {
+    CountForm f;
+    f.canon = E.canon;
+    acc.add(f);
+  }
+  if (!cfg.only_arithmetic && used_sum(E) > 0) {
+    vector<Solver::Preimage> pre;
+    Solver::unary_preimages(cfg, want_of(E.num), pre);
+    for (const Solver::Preimage &p : pre) {
+      if (p.chain.size() != 1)
+        continue;
+      const vector<int> *idx2 = T.index.find(p.z);
+      if (!idx2)
+        continue;
+      const int op = OP_SQRT + p.chain[0];
+      for (int j : *idx2) {
+        Node out;
+        if (!rb.ops.try_unary(p.chain[0], (*T.set)[j].node, out) ||
+            !same_state(out, E, cat))
+          continue;
+        for (const CountForm &a : forms(T, j)) {
+          CountForm f;
+          f.canon = canon_apply1(op, a.canon);
+          f.root = (unsigned char)op;
+          f.classes = a.classes | count_class_bit(op);
+          acc.add(f);
+        }
+      }
+    }
+  }
+  if (T.ms.size() >= 2)
+    for_each_binary(T.ms, want_of(E.num),
+                    [&](const Node &C, Table &TX, int i, Table &TY, int j,
+                        int op) {
+                      if (same_state(C, E, cat))
+                        combine_forms(op, forms(TX, i), forms(TY, j), acc);
+                    });
+  form_count += acc.out.size();
+  T.forms[idx] = std::move(acc.out);
+  return T.forms[idx];
+}
+
+size_t SolutionCounter::mem_used() const {
+  return (rb.cached_entries + rb.pending_entries) *
+             (2 * sizeof(ReachEntry) + 2 * HASH_ENTRY_OVERHEAD) +
+         form_count * sizeof(CountForm);
+}
+
+bool SolutionCounter::halted() {
+  if (stopped || mem_truncated)
+    return true;
+  if ((stop && stop()) ||
+      (max_us > 0 && chrono::duration_cast<chrono::microseconds>(
+                         chrono::steady_clock::now() - t0)
+                             .count() >= max_us))
+    stopped = true;
+  else if (mem_budget > 0 && mem_used() > mem_budget)
+    mem_truncated = true;
+  return stopped || mem_truncated;
+}
+
+SolutionCount SolutionCounter::count(vector<long long> nums,
+                                     long long max_us) {
+  using clk = chrono::steady_clock;
+  t0 = clk::now();
+  this->max_us = max_us;
+  const SolverConfig &cfg = *rb.ops.config;
+  mem_budget = cfg.memory_budget;
+  if (stop || max_us > 0 || mem_budget > 0)
+    rb.stop = [this] { return halted(); };
+  SolutionCount res;
+  sort(nums.begin(), nums.end());
+  FormSet sols;
+  if (cfg.target > 0 && nums.size() == 1) {
+    // 只有一个数时解就是它本身（同 DFS，不对整个式子再套一元函数）
+    Table &T = table(nums);
+    for (int i = 0; i < (int)T.set->size(); i++)
+      if (used_sum((*T.set)[i].node) == 0 &&
+          is_target_24(cfg, (*T.set)[i].node.num))
+        for (const CountForm &f : forms(T, i))
+          sols.add(f);
+  } else if (cfg.target > 0 && nums.size() >= 2) {
+    Solver::Want target;
+    target.num.sign = 1;
+    target.num.pe = cfg.target_factors;
+    normalize_num(cfg, target.num);
+    target.has_pe = true;
+    for_each_binary(nums, target,
+                    [&](const Node &, Table &TX, int i, Table &TY, int j,
+                        int op) {
+                      combine_forms(op, forms(TX, i), forms(TY, j), sols);
+                    });
+  }
+  res.forms = sols.out.size();
+  for (const CountForm &f : sols.out)
+    for (int c = 0; c < CC_CNT; c++)
+      if (f.classes & (1u << c))
+        res.by_class[c]++;
+  for (auto &kv : tables)
+    res.states += kv.second.set->size();
+  res.expanded = expanded;
+  res.us = chrono::duration_cast<chrono::microseconds>(clk::now() - t0)
+               .count();
+  res.stopped = stopped;
+  res.mem_truncated = mem_truncated;
+  return res;
+}
+
+// ======================= 答案校验：中缀解析与精确求值 =======================
+bool parse_verify_line(const string &line, vector<long long> &nums,
+                       vector<string> &exprs) {
+  nums.clear();
+  exprs.clear();
+  size_t bar = line.find('|');
+  string head = line.substr(0, bar);
+  size_t pos = 0;
+  long long x;
+  while (scan_ll(head, pos, x))
+    nums.push_back(x);
+  if (nums.empty() || head.find_first_not_of(" \t\r\n", pos) != string::npos)
+    return false;
+  size_t b = bar == string::npos ? line.size() + 1 : bar + 1;
+  while (b <= line.size()) {
+    size_t e = line.find(';', b);
+    if (e == string::npos)
+      e = line.size();
+    size_t l = line.find_first_not_of(" \t\r", b);
+    if (l < e) {
+      size_t r = line.find_last_not_of(" \t\r", e - 1);
+      exprs.push_back(line.substr(l, r + 1 - l));
+    }
+    b = e + 1;
+  }
+  return true;
+}
+
+void InfixParser::skip() {
+  while (i < s.size() && isspace((unsigned char)s[i]))
+    i++;
+}
+
+bool InfixParser::peek(const char *t) {
+  skip();
+  return s.compare(i, strlen(t), t) == 0;
+}
+
+bool InfixParser::eat(const char *t) {
+  if (!peek(t))
+    return false;
+  i += strlen(t);
+  return true;
+}
+
+void InfixParser::emit(string t, size_t p) {
+  rpn.push_back(std::move(t));
+  at.push_back((int)p);
+}
+
+bool InfixParser::fail() {
+  if (err < 0)
+    err = (int)min(i, s.size());
+  return false;
+}
+
+bool InfixParser::parse() {
+  if (!expr())
+    return false;
+  skip();
+  return i == s.size() || fail();
+}
+
+bool InfixParser::expr() {
+  if (!term())
+    return false;
+  while (peek("+") || peek("-")) {
+    size_t p = i;
+    char op = s[i++];
+    if (!term())
+      return false;
+    emit(string(1, op), p);
+  }
+  return true;
+}
+
+bool InfixParser::term() {
+  if (!power())
+    return false;
+  while (peek("*") || peek("/")) {
+    size_t p = i;
+    char op = s[i++];
+    if (!power())
+      return false;
+    emit(string(1, op), p);
+  }
+  return true;
+}
+
+bool InfixParser::power() {
+  if (!cat())
+    return false;
+  size_t p = i;
+  if (!eat("^"))
+    return true;
+  if (!power())
+    return false;
+  emit("^", p);
+  return true;
+}
+
+bool InfixParser::cat() {
+  if (!post())
+    return false;
+  while (peek("||")) {
+    size_t p = i;
+    i += 2;
+    if (!post())
+      return false;
+    emit("||", p);
+  }
+  return true;
+}
+
+bool InfixParser::post() {
+  if (!atom())
+    return false;
+  while (peek("!"))
+    emit("!", i++);
+  return true;
+}
+
+bool InfixParser::atom() {
+  skip();
+  size_t p = i, j = i;
+  if (j < s.size() && s[j] == '-')
+    j++;
+  if (j < s.size() && isdigit((unsigned char)s[j])) {
+    while (j < s.size() && isdigit((unsigned char)s[j]))
+      j++;
+    long long v;
+    if (!try_parse_ll(s.substr(p, j - p), v))
+      return fail();
+    i = j;
+    emit(to_string(v), p);
+    return true;
+  }
+  if (eat("(")) {
+    if (!expr())
+      return false;
+    return eat(")") || fail();
+  }
+  for (j = i; j < s.size() && isalpha((unsigned char)s[j]);)
+    j++;
+  string name = s.substr(p, j - p);
+  int code = op_of_token(name);
+  if (code == OP_LEAF || OPS[code].form != FORM_CALL)
+    return fail();
+  i = j;
+  if (!eat("(") || !expr())
+    return fail();
+  if (OPS[code].arity == 2 && (!eat(",") || !expr()))
+    return fail();
+  if (!eat(")"))
+    return fail();
+  emit(name, p);
+  return true;
+}
+
+AnswerChecker::AnswerChecker(ConfigPtr config) {
+  ops.config = std::move(config);
+  ops.keep_expr = false;
+  ops.exact = true;
+}
+
+bool AnswerChecker::parse(const string &infix, VerifyResult &r, vector<int> &at,
+                          vector<long long> &leaves) {
+  InfixParser ps(infix);
+  if (!ps.parse()) {
+    r.status = VS_SYNTAX;
+    r.pos = ps.err;
+    return false;
+  }
+  r.rpn = std::move(ps.rpn);
+  at = std::move(ps.at);
+  leaves.clear();
+  for (const string &t : r.rpn) {
+    long long v;
+    if (op_of_token(t) == OP_LEAF && try_parse_ll(t, v))
+      leaves.push_back(v);
+  }
+  sort(leaves.begin(), leaves.end());
+  return true;
+}
+
+bool AnswerChecker::evaluate(VerifyResult &r, const vector<int> &at,
+                             Node &out) {
+  const SolverConfig &cfg = *ops.config;
+  vector<Node> st;
+  st.reserve(r.rpn.size());
+  for (size_t k = 0; k < r.rpn.size(); k++) {
+    const string &t = r.rpn[k];
+    int code = op_of_token(t);
+    if (code == OP_LEAF) {
+      vector<Node> leaf;
+      long long v = 0;
+      try_parse_ll(t, v);
+      if (!Solver::nodes_from_values(cfg, {v}, leaf)) {
+        r.status = VS_ILLEGAL;
+        r.pos = at[k];
+        return false;
+      }
+      st.push_back(std::move(leaf[0]));
+      continue;
+    }
+    // 解析保证了元数，这里的栈不会不够
+    Node nd;
+    bool ok;
+    Num probe;
+    if (OPS[code].arity == 1) {
+      ok = !cfg.only_arithmetic && ops.try_op1(code, st.back(), nd);
+      if (!ok)
+        r.status = num_exact1(cfg, code, st.back().num, probe) ? VS_LIMIT
+                                                               : VS_ILLEGAL;
+      st.pop_back();
+    } else {
+      const Node &A = st[st.size() - 2], &B = st.back();
+      ok = ops.try_op2(code, A, B, nd);
+      if (!ok) {
+        // 拼接的操作数只能是数字（与求解时相同），否则算非法而不是超限
+        bool operands = !OPS[code].literals ||
+                        (is_literal_node(A) && B.root == OP_LEAF);
+        r.status = operands && num_exact2(cfg, code, A.num, B.num, probe)
+                       ? VS_LIMIT
+                       : VS_ILLEGAL;
+      }
+      st.pop_back();
+      st.pop_back();
+    }
+    if (!ok) {
+      r.pos = at[k];
+      return false;
+    }
+    st.push_back(std::move(nd));
+  }
+  out = std::move(st.back());
+  return true;
+}
+
+VerifyResult AnswerChecker::check(const vector<long long> &nums,
+                                  const string &infix) {
+  VerifyResult r;
+  vector<int> at;
+  vector<long long> leaves, want = nums;
+  if (!parse(infix, r, at, leaves))
+    return r;
+  // 叶子的多重集须与题目相同
+  sort(want.begin(), want.end());
+  if (leaves != want) {
+    r.status = VS_NUMBERS;
+    return r;
+  }
+  Node out;
+  if (!evaluate(r, at, out))
+    return r;
+  r.value = std::move(out.num);
+  r.status = is_target_24(*ops.config, r.value) ? VS_OK : VS_WRONG;
+  return r;
+}
+
+// ======================= 提示：从玩家已做的部分续出最简解 =======================
+HintEngine::HintEngine(ConfigPtr config)
+    : checker(std::move(config)) {
+  checker.ops.keep_expr = true;
+}
+
+void HintEngine::set_config(ConfigPtr config) {
+  if (config == checker.ops.config)
+    return;
+  checker.ops.config = std::move(config);
+  stage_configs.clear();
+  cache.clear();
+  rank_key.clear();
+  ranker.release();
+}
+
+ConfigPtr HintEngine::stage_config(int k,
+                                   const array<unsigned char, F_CNT> &used,
+                                   int depth, bool &last) {
+  SolverConfig c = *config();
+  last = true;
+  string key;
+  for (int f = 0; f < F_CNT; f++) {
+    c.max_use[f] = min(c.max_use[f], (int)used[f] + k);
+    last = last && c.max_use[f] == config()->max_use[f];
+    key += to_string(c.max_use[f]) + ",";
+  }
+  c.max_nest = min(c.max_nest, depth + k);
+  last = last && c.max_nest == config()->max_nest;
+  key += to_string(c.max_nest);
+  ConfigPtr &slot = stage_configs[key];
+  if (!slot)
+    slot = last ? config() : make_config(std::move(c));
+  return slot;
+}
+
+HintResult HintEngine::hint(const vector<long long> &nums,
+                            const vector<string> &parts, int limit) {
+  auto t0 = chrono::steady_clock::now();
+  auto elapsed = [&] {
+    return (long long)chrono::duration_cast<chrono::microseconds>(
+               chrono::steady_clock::now() - t0)
+        .count();
+  };
+  vector<long long> rest = nums;
+  sort(rest.begin(), rest.end());
+  string key = ReachBuilder::multiset_key(rest) + "|" + to_string(limit);
+  for (const string &p : parts)
+    key += "|" + p;
+  auto hit = cache.find(key);
+  if (hit != cache.end()) {
+    HintResult r = hit->second;
+    r.cached = true;
+    r.us = elapsed();
+    return r;
+  }
+  if (!rank_key.empty() && key == rank_key) {
+    HintResult r = rank(HINT_BUDGET_US);
+    r.us = elapsed();
+    return r;
+  }
+
+  HintResult res;
+  vector<Node> start;
+  array<unsigned char, F_CNT> used{};
+  int depth = 0;
+  for (size_t i = 0; i < parts.size(); i++) {
+    VerifyResult vr;
+    vector<int> at;
+    vector<long long> leaves;
+    Node nd;
+    bool ok = AnswerChecker::parse(parts[i], vr, at, leaves);
+    if (ok) {
+      // 从剩余数字中扣掉这个式子用到的（都是排好序的多重集）
+      vector<long long> left;
+      set_difference(rest.begin(), rest.end(), leaves.begin(), leaves.end(),
+                     back_inserter(left));
+      if (left.size() + leaves.size() != rest.size()) {
+        vr.status = VS_NUMBERS;
+        ok = false;
+      } else {
+        rest.swap(left);
+        ok = checker.evaluate(vr, at, nd);
+      }
+    }
+    if (!ok) {
+      res.status = vr.status;
+      res.part = (int)i;
+      res.pos = vr.pos;
+      res.us = elapsed();
+      return res;
+    }
+    for (int f = 0; f < F_CNT; f++)
+      used[f] = (unsigned char)(used[f] + nd.used[f]);
+    depth = max(depth, nd.depth);
+    start.push_back(std::move(nd));
+  }
+  vector<Node> leaves;
+  if (!Solver::nodes_from_values(*config(), rest, leaves)) {
+    res.status = VS_NUMBERS;
+    res.us = elapsed();
+    return res;
+  }
+  for (Node &nd : leaves)
+    start.push_back(std::move(nd));
+
+  solver.top_k = limit > 0 ? (size_t)limit : 0;
+  solver.count_distinct = false;
+  bool last = false;
+  for (int k = 0; !last; k++) {
+    // 先找一个解判断这一级有没有解（只有数字时走置换表，子表跨请求复用）
+    solver.config = stage_config(k, used, depth, last);
+    solver.begin(start, true, false);
+    solver.step();
+    solver.finish();
+    if (!solver.found)
+      continue;
+    res.stage = k;
+    res.completions.push_back(solver.first_expr);
+    // 再在时间预算内求全部解排出最简的几个；超时则先用已找到的，ranker
+    // 挂起留给下次同样的请求或 idle 接着排
+    ranker.config = solver.config;
+    ranker.top_k = solver.top_k;
+    ranker.count_distinct = false;
+    ranker.begin(start, false, false);
+    solver.release();
+    rank_key = key;
+    rank_res = res;
+    res = rank(HINT_BUDGET_US);
+    res.us = elapsed();
+    return res;
+  }
+  solver.release();
+
+  if (cache.size() >= max_cache)
+    cache.clear();
+  cache.emplace(std::move(key), res);
+  res.us = elapsed();
+  return res;
+}
+
+bool HintEngine::idle(long long max_us) {
+  if (!rank_key.empty())
+    rank(max_us);
+  return !rank_key.empty();
+}
+
+HintResult HintEngine::rank(long long max_us) {
+  if (ranker.step(0, max_us)) {
+    ranker.finish();
+    rank_res.complete = true;
+  }
+  vector<const vector<string> *> ranked = ranker.ranked();
+  if (!ranked.empty()) {
+    rank_res.completions.clear();
+    for (const vector<string> *e : ranked)
+      rank_res.completions.push_back(*e);
+  }
+  HintResult res = rank_res;
+  if (res.complete) {
+    ranker.release();
+    if (cache.size() >= max_cache)
+      cache.clear();
+    cache.emplace(std::move(rank_key), res);
+    rank_key.clear();
+  }
+  return res;
+}
+
+// ======================= 增量预求解：边输入数字边建子表 =======================
+void ReachSession::set_config(ConfigPtr c) {
+  if (c != config) {
+    config = std::move(c);
+    dirty = true;
+  }
+}
+
+void ReachSession::submultisets(const vector<long long> &ms, size_t max_size,
+                                const long long *must,
+                                vector<vector<long long>> &out) {
+  vector<long long> vals;
+  vector<int> mult;
+  for (long long x : ms) {
+    if (vals.empty() || vals.back() != x) {
+      vals.push_back(x);
+      mult.push_back(0);
+    }
+    mult.back()++;
+  }
+  vector<int> sub(vals.size(), 0);
+  while (true) {
+    size_t p = 0;
+    while (p < vals.size() && sub[p] == mult[p])
+      sub[p++] = 0;
+    if (p == vals.size())
+      break;
+    sub[p]++;
+    vector<long long> s;
+    bool has = !must;
+    for (size_t i = 0; i < vals.size(); i++) {
+      s.insert(s.end(), sub[i], vals[i]);
+      has = has || (sub[i] && vals[i] == *must);
+    }
+    if (has && s.size() <= max_size)
+      out.push_back(std::move(s));
+  }
+}
+
+void ReachSession::plan() {
+  vector<long long> ms = nums;
+  sort(ms.begin(), ms.end());
+  size_t max_size = (size_t)max(1, hand_size - 1);
+  vector<vector<long long>> sure, guess;
+  submultisets(ms, max_size, nullptr, sure);
+  if ((int)nums.size() + 1 == hand_size) {
+    size_t spec_size = min(max_size, (size_t)REACH_TT_MAX_SUBSET);
+    for (long long x = spec_lo; x <= spec_hi; x++) {
+      vector<long long> with = ms;
+      with.insert(upper_bound(with.begin(), with.end(), x), x);
+      submultisets(with, spec_size, &x, guess);
+    }
+  }
+  // 各自按大小排，子表的子表总是先建好
+  auto smaller = [](const vector<long long> &a, const vector<long long> &b) {
+    return a.size() < b.size();
+  };
+  stable_sort(sure.begin(), sure.end(), smaller);
+  stable_sort(guess.begin(), guess.end(), smaller);
+  pending = std::move(sure);
+  pending.insert(pending.end(), guess.begin(), guess.end());
+  next = 0;
+  dirty = false;
+}
+
+size_t ReachSession::idle(long long max_us) {
+  if (dirty)
+    plan();
+  auto t0 = chrono::steady_clock::now();
+  ReachBuilder rb(config);
+  rb.use_tt = true;
+  while (next < pending.size()) {
+    const vector<long long> &ms = pending[next++];
+    if (!reach_tt_has(*config, ms)) {
+      reach_tt_get(rb, ms);
+      built++;
+    }
+    if (max_us > 0 && chrono::duration_cast<chrono::microseconds>(
+                          chrono::steady_clock::now() - t0)
+                              .count() >= max_us)
+      break;
+  }
+  return pending.size() - next;
+}
+
+bool ReachSession::solve(Solver &book) {
+  const SolverConfig &cfg = *config;
+  book.config = config;
+  book.release();
+  book.immediate_print = false;
+  book.found = false;
+  if (nums.empty() || cfg.target <= 0)
+    return false;
+  vector<long long> ms = nums;
+  sort(ms.begin(), ms.end());
+  ReachBuilder rb(config);
+  rb.use_tt = true;
+  auto table = [&](const vector<long long> &s) {
+    if (!reach_tt_has(cfg, s))
+      built++;
+    return reach_tt_get(rb, s);
+  };
+  if (ms.size() == 1) {
+    for (const ReachEntry &e : table(ms)->set)
+      if (used_sum(e.node) == 0 && is_target_24(cfg, e.node.num)) {
+        book.found = true;
+        book.add_answer(e.node.expr, e.node.canon.key);
+      }
+    return book.found;
+  }
+  Solver::Want target;
+  target.num.sign = 1;
+  target.num.pe = cfg.target_factors;
+  normalize_num(cfg, target.num);
+  target.has_pe = true;
+  ReachBuilder::for_each_split(ms, [&](const vector<long long> &A,
+                                       const vector<long long> &B, bool) {
+    shared_ptr<const ReachTable> TA = table(A), TB = table(B);
+    if (TA->set.size() > TB->set.size())
+      swap(TA, TB);
+    Node C;
+    for (const ReachEntry &x : TA->set) {
+      const Node &X = x.node;
+      Solver::for_each_inverse(
+          cfg, X.num, target, !TB->index.big.empty(),
+          [&](int op, Solver::Want &y) {
+            if (const vector<int> *idx = TB->index.find(y))
+              for (int i : *idx)
+                if (rb.ops.try_binary(op, X, TB->set[i].node, C) &&
+                    is_target_24(cfg, C.num)) {
+                  book.found = true;
+                  book.add_answer(C.expr, C.canon.key);
+                }
+            return false;
+          });
+    }
+  });
+  return book.found;
+}
+
+// ==================== 求解配置 ====================
+// 阶乘反查：n! 的值 -> n（与 num_fact 的范围一致）。按数值上限缓存，
+// 换目标或函数次数的配置直接复用；不同上限的组合很少，超过 64 种时清空
+static shared_ptr<const FactTables> fact_tables(SolverConfig &c) {
+  static mutex lock;
+  static map<tuple<int, long long, int>, shared_ptr<const FactTables>> cache;
+  const auto key = make_tuple(c.max_fact_arg, c.max_abs_val, c.max_exp_sum);
+  {
+    lock_guard<mutex> g(lock);
+    auto it = cache.find(key);
+    if (it != cache.end())
+      return it->second;
+  }
+  auto t = make_shared<FactTables>();
+  t->primes = primes_up_to(c.max_fact_arg);
+  c.fact = t; // factorial_factors 读 primes
+  for (int n = 3; n <= c.max_fact_arg; n++) {
+    if (n == 4)
+      continue;
+    Num f;
+    f.sign = 1;
+    f.pe = factorial_factors(c, n);
+    normalize_num(c, f);
+    if (f.has_ll)
+      t->small[f.ll] = n;
+    else
+      t->big[Solver::num_key(f)] = n;
+  }
+  lock_guard<mutex> g(lock);
+  if (cache.size() >= 64)
+    cache.clear();
+  return cache.emplace(key, t).first->second;
+}
+
+// 校正取值范围并算出派生数据（WASM 的 hegel_configure 与 Node 扩展共用）
+ConfigPtr make_config(SolverConfig c) {
+  c.max_nest = max(0, c.max_nest);
+  for (int &u : c.max_use)
+    u = min(max(u, 0), 255); // Node::used 为 unsigned char
+  c.max_abs_val = min(max(c.max_abs_val, 1LL), 1LL << 62);
+  c.max_fact_arg = min(max(c.max_fact_arg, 0), 1000);
+  c.max_exp_sum = min(max(c.max_exp_sum, 1), 10000);
+
+  c.target_factors = factorize_small(c.target);
+  c.fact = fact_tables(c);
+
+  string k = to_string(c.max_nest);
+  for (int i = 0; i < F_CNT; i++)
+    k += "," + to_string(c.max_use[i]);
+  k += c.no_negative ? ",N" : ",n";
+  k += c.only_arithmetic ? "A" : "a";
+  // 数值上限只在偏离默认值时写入，默认配置的普查文件头保持不变
+  if (c.max_abs_val != MAX_ABS_VAL || c.max_fact_arg != MAX_FACT_ARG ||
+      c.max_exp_sum != MAX_EXP_SUM)
+    k += ",V" + to_string(c.max_abs_val) + ",F" + to_string(c.max_fact_arg) +
+         ",E" + to_string(c.max_exp_sum);
+  c.reach_key = k + "|";
+  c.key = to_string(c.target) + "," + k;
+  return make_shared<const SolverConfig>(std::move(c));
+}
+
+// 源码顶部默认参数对应的配置
+const ConfigPtr &default_config() {
+  static const ConfigPtr c = make_config(SolverConfig());
+  return c;
+}
+
+// ======================= 参数扫描 =======================
+bool SweepGrid::parse(const string &text, SweepGrid &out, size_t max_cells) {
+  out = SweepGrid();
+  static const char *const SEP = " \t\r\n";
+  for (size_t at = text.find_first_not_of(SEP); at != string::npos;) {
+    size_t end = text.find_first_of(SEP, at);
+    string item = text.substr(at, end - at); // end 为 npos 时取到末尾
+    at = text.find_first_not_of(SEP, end);
+    size_t eq = item.find('=');
+    if (eq == string::npos)
+      return false;
+    string name = item.substr(0, eq);
+    vector<int> *dim = nullptr;
+    if (name == "nest")
+      dim = &out.nest;
+    for (int f = 0; f < F_CNT && !dim; f++)
+      if (name == FUNC_NAMES[f])
+        dim = &out.use[f];
+    if (!dim || !dim->empty())
+      return false;
+    string spec = item.substr(eq + 1);
+    size_t pos = 0;
+    while (true) {
+      long long a, b;
+      if (!scan_ll(spec, pos, a))
+        return false;
+      b = a;
+      if (pos < spec.size() && spec[pos] == '-') {
+        pos++;
+        if (!scan_ll(spec, pos, b))
+          return false;
+      }
+      if (a < 0 || b > 255 || a > b)
+        return false;
+      for (long long v = a; v <= b; v++)
+        if (find(dim->begin(), dim->end(), (int)v) == dim->end())
+          dim->push_back((int)v);
+      if (pos == spec.size())
+        break;
+      if (spec[pos++] != ',')
+        return false;
+    }
+    sort(dim->begin(), dim->end());
+    if (out.cells() > max_cells)
+      return false;
+  }
+  return true;
+}
+
+size_t SweepGrid::cells() const {
+  size_t n = max<size_t>(nest.size(), 1);
+  for (const vector<int> &u : use)
+    n *= max<size_t>(u.size(), 1);
+  return n;
+}
+
+void SweepGrid::cell(const SolverConfig &base, size_t idx, int &nest_out,
+                     array<int, F_CNT> &max_use) const {
+  nest_out = base.max_nest;
+  if (!nest.empty()) {
+    nest_out = nest[idx % nest.size()];
+    idx /= nest.size();
+  }
+  for (int f = 0; f < F_CNT; f++) {
+    max_use[f] = base.max_use[f];
+    if (!use[f].empty()) {
+      max_use[f] = use[f][idx % use[f].size()];
+      idx /= use[f].size();
+    }
+  }
+}
+
+// f 是否为一元函数（only_arithmetic 只关掉这些，log、^、|| 仍按次数预算）
+static bool unary_func(int f) {
+  for (const OpInfo &o : OPS)
+    if (o.func == f && o.arity == 1)
+      return true;
+  return false;
+}
+
+SolverConfig SweepGrid::loosest(const SolverConfig &base) const {
+  SolverConfig c = base;
+  c.only_arithmetic = false;
+  // 只四则运算一格沿用基础配置的嵌套深度与二元函数次数，最宽的一格须盖住它
+  if (!nest.empty())
+    c.max_nest = max(nest.back(), base.max_nest);
+  for (int f = 0; f < F_CNT; f++)
+    if (!use[f].empty())
+      c.max_use[f] = unary_func(f) ? use[f].back()
+                                   : max(use[f].back(), base.max_use[f]);
+  return c;
+}
+
+ConfigSweep::ConfigSweep(ConfigPtr base_, const SweepGrid &grid_)
+    : base(std::move(base_)), grid(grid_),
+      rb(make_config(grid_.loosest(*base))) {
+  rb.use_tt = true;
+  for (size_t k = 0; k < grid.cells(); k++) {
+    pair<int, array<int, F_CNT>> p;
+    grid.cell(*base, k, p.first, p.second);
+    params.push_back(p);
+  }
+  // 同求解器的 only_arithmetic：一元函数次数为 0，其余沿用基础配置
+  pair<int, array<int, F_CNT>> arith;
+  arith.first = base->max_nest;
+  for (int f = 0; f < F_CNT; f++)
+    arith.second[f] = unary_func(f) ? 0 : base->max_use[f];
+  params.push_back(arith);
+  solvable.assign(params.size(), 0);
+}
+
+bool SweepProfile::within(const SweepProfile &o) const {
+  for (int f = 0; f < F_CNT; f++)
+    if (used[f] > o.used[f])
+      return false;
+  return depth <= o.depth;
+}
+
+vector<SweepProfile> ConfigSweep::profiles(vector<long long> nums) {
+  const SolverConfig &cfg = *rb.ops.config;
+  vector<SweepProfile> out;
+  auto offer = [&](const Node &nd) {
+    SweepProfile p;
+    p.used = nd.used;
+    p.depth = nd.depth;
+    for (const SweepProfile &q : out)
+      if (q.within(p))
+        return;
+    out.erase(remove_if(out.begin(), out.end(),
+                        [&](const SweepProfile &q) { return p.within(q); }),
+              out.end());
+    out.push_back(p);
+  };
+  if (nums.empty() || cfg.target <= 0)
+    return out;
+  sort(nums.begin(), nums.end());
+  if (nums.size() == 1) {
+    for (const ReachEntry &e : reach_tt_get(rb, nums)->set)
+      if (used_sum(e.node) == 0 && is_target_24(cfg, e.node.num))
+        offer(e.node);
+    return out;
+  }
+  Solver::Want target;
+  target.num.sign = 1;
+  target.num.pe = cfg.target_factors;
+  normalize_num(cfg, target.num);
+  target.has_pe = true;
+  // 子表小的拆分先做：各格都有解后不必再建大的子表
+  vector<pair<vector<long long>, vector<long long>>> splits;
+  ReachBuilder::for_each_split(nums, [&](const vector<long long> &A,
+                                         const vector<long long> &B, bool) {
+    splits.emplace_back(A, B);
+  });
+  stable_sort(splits.begin(), splits.end(),
+              [](const pair<vector<long long>, vector<long long>> &a,
+                 const pair<vector<long long>, vector<long long>> &b) {
+                return max(a.first.size(), a.second.size()) <
+                       max(b.first.size(), b.second.size());
+              });
+  for (const auto &split : splits) {
+    if (!out.empty() && admits_all(out))
+      break;
+    shared_ptr<const ReachTable> TA = reach_tt_get(rb, split.first);
+    shared_ptr<const ReachTable> TB = reach_tt_get(rb, split.second);
+    if (TA->set.size() > TB->set.size())
+      swap(TA, TB);
+    Node C;
+    for (const ReachEntry &x : TA->set) {
+      const Node &X = x.node;
+      Solver::for_each_inverse(
+          cfg, X.num, target, !TB->index.big.empty(),
+          [&](int op, Solver::Want &y) {
+            if (const vector<int> *idx = TB->index.find(y))
+              for (int i : *idx)
+                if (rb.ops.try_binary(op, X, TB->set[i].node, C) &&
+                    is_target_24(cfg, C.num))
+                  offer(C);
+            return false;
+          });
+    }
+  }
+  return out;
+}
+
+bool ConfigSweep::admits_all(const vector<SweepProfile> &ps) const {
+  for (size_t k = 0; k < params.size(); k++)
+    if (!admits(ps, k))
+      return false;
+  return true;
+}
+
+bool ConfigSweep::admits(const vector<SweepProfile> &ps, size_t k) const {
+  const pair<int, array<int, F_CNT>> &c = params[k];
+  for (const SweepProfile &p : ps) {
+    bool ok = p.depth <= c.first;
+    for (int f = 0; f < F_CNT && ok; f++)
+      ok = p.used[f] <= c.second[f];
+    if (ok)
+      return true;
+  }
+  return false;
+}
+
+vector<SweepProfile> ConfigSweep::add(const vector<long long> &nums) {
+  vector<SweepProfile> ps = profiles(nums);
+  hands++;
+  if (!ps.empty())
+    loose_solvable++;
+  for (size_t k = 0; k < params.size(); k++)
+    if (admits(ps, k))
+      solvable[k]++;
+  return ps;
+}
+
+// ======================= 大题：束搜索（随时可停） =======================
+BeamResult BeamSearch::run(const vector<Node> &input, long long max_us,
+                           size_t limit) {
+  typedef chrono::steady_clock clk;
+  const clk::time_point t0 = clk::now();
+  auto elapsed = [&] {
+    return chrono::duration_cast<chrono::microseconds>(clk::now() - t0)
+        .count();
+  };
+  auto out_of_time = [&] {
+    return (stop && stop()) || (max_us > 0 && elapsed() >= max_us);
+  };
+
+  BeamResult res;
+  Run run{res, limit, {}, t0, {}};
+  size_t w = max<size_t>(1, width);
+  for (int round = 0; !res.exhausted; round++) {
+    const bool closure =
+        round > 0 || solver.config->only_arithmetic || input.size() <= 3;
+    const double noise = round >= 2 ? NOISE : 0;
+    bool truncated = false, timed_out = false;
+    vector<vector<Node>> level(1, input);
+    while (!level.empty() && level[0].size() > 3) {
+      level = expand(level, w, closure, noise,
+                     canon_mix(seed + (uint64_t)round), truncated, res,
+                     out_of_time);
+      if (out_of_time()) {
+        timed_out = true;
+        break;
+      }
+    }
+    for (size_t k = 0; !timed_out && k < level.size(); k++) {
+      finish_state(level[k], run);
+      res.states++;
+      timed_out = out_of_time();
+    }
+    if (timed_out)
+      break;
+    res.rounds++;
+    res.width = w;
+    res.exhausted = closure && !truncated;
+    if (max_us <= 0 && w >= max_width)
+      break;
+    w = min(max_width, w * 2);
+    if (out_of_time())
+      break;
+  }
+  for (auto &a : run.best)
+    res.solutions.push_back(std::move(a.second));
+  res.us = elapsed();
+  return res;
+}
+
+void BeamSearch::finish_state(const vector<Node> &cur, Run &run) {
+  solver.begin(cur, true, false);
+  if (!solver.found)
+    return;
+  const vector<string> &e = solver.first_expr;
+  string key;
+  for (const string &t : e) {
+    key += t;
+    key.push_back(' ');
+  }
+  if (!run.seen.insert(std::move(key)).second)
+    return;
+  BeamResult &res = run.res;
+  if (res.found++ == 0)
+    res.first_us = chrono::duration_cast<chrono::microseconds>(
+                       chrono::steady_clock::now() - run.t0)
+                       .count();
+  pair<AnswerRank, vector<string>> a(rank_expr(e), e);
+  run.best.insert(upper_bound(run.best.begin(), run.best.end(), a), a);
+  if (run.limit > 0 && run.best.size() > run.limit)
+    run.best.pop_back();
+}
+
+double BeamSearch::value_score(const Num &v) const {
+  const SolverConfig &cfg = *solver.config;
+  const double lt = log2((double)max(1, cfg.target));
+  if (v.sign == 0)
+    return lt;
+  double lv = v.has_ll ? log2(fabs((double)v.ll)) : log2_of_pe(v.pe);
+  double d = fabs(lv - lt) + (v.sign < 0 ? 1 : 0);
+  if (v.has_ll && v.ll > 0 && cfg.target > 0 &&
+      (cfg.target % v.ll == 0 || v.ll % cfg.target == 0))
+    d *= 0.5;
+  return d;
+}
+
+double BeamSearch::value_size(const Num &v) {
+  if (v.sign == 0)
+    return 0;
+  return v.has_ll ? log2(1 + fabs((double)v.ll)) : log2_of_pe(v.pe);
+}
+
+template <class OutOfTime>
+vector<vector<Node>> BeamSearch::expand(const vector<vector<Node>> &level,
+                                        size_t w, bool closure, double noise,
+                                        uint64_t salt, bool &truncated,
+                                        BeamResult &res,
+                                        OutOfTime &out_of_time) {
+  auto worse = [](const Cand &a, const Cand &b) { return a.score < b.score; };
+  vector<Cand> heap; // 最差者在堆顶
+  unordered_set<uint64_t> kept;
+  auto offer = [&](Cand &&c) {
+    if (kept.count(c.key))
+      return;
+    if (heap.size() >= w) {
+      truncated = true;
+      if (!(c.score < heap.front().score))
+        return;
+      pop_heap(heap.begin(), heap.end(), worse);
+      kept.erase(heap.back().key);
+      heap.pop_back();
+    }
+    kept.insert(c.key);
+    heap.push_back(std::move(c));
+    push_heap(heap.begin(), heap.end(), worse);
+  };
+
+  Solver::NodeSeen seen;
+  seen.cat = solver.cat_enabled();
+  vector<vector<Node>> cl;
+  for (int s = 0; s < (int)level.size(); s++) {
+    const vector<Node> &cur = level[s];
+    const int n = (int)cur.size();
+    res.states++;
+    uint64_t h = solver.equiv_key(cur);
+    vector<double> term(n), size(n);
+    double size_sum = 0;
+    cl.assign(n, vector<Node>());
+    for (int k = 0; k < n; k++) {
+      term[k] = value_score(cur[k].num);
+      size[k] = value_size(cur[k].num);
+      size_sum += size[k];
+      if (closure) {
+        seen.clear();
+        solver.add_closure(cur[k], cl[k], seen);
+      } else {
+        cl[k].push_back(cur[k]);
+      }
+    }
+    for (int i = 0; i < n; i++)
+      for (int j = i + 1; j < n; j++) {
+        double rest_min = 1e300;
+        for (int k = 0; k < n; k++)
+          if (k != i && k != j)
+            rest_min = min(rest_min, term[k]);
+        const double rest_size = size_sum - size[i] - size[j];
+        const uint64_t rest_h =
+            h - solver.node_equiv(cur[i]) - solver.node_equiv(cur[j]);
+        for (const Node &X : cl[i])
+          for (const Node &Y : cl[j])
+            for (int op = 0; op < Solver::BINARY_OPS; op++) {
+              Cand c;
+              if (!solver.try_binary(op, X, Y, c.node))
+                continue;
+              c.key = rest_h + solver.node_equiv(c.node);
+              c.score = min(rest_min, value_score(c.node.num)) +
+                        SPREAD * (rest_size + value_size(c.node.num)) /
+                            (n - 1);
+              if (noise > 0)
+                c.score += noise * (double)(canon_mix(c.key ^ salt) >> 11) *
+                           0x1p-53;
+              c.parent = s;
+              c.i = i;
+              c.j = j;
+              offer(std::move(c));
+            }
+        if (out_of_time())
+          return {};
+      }
+  }
+
+  sort(heap.begin(), heap.end(), worse);
+  vector<vector<Node>> next;
+  next.reserve(heap.size());
+  for (Cand &c : heap) {
+    const vector<Node> &cur = level[c.parent];
+    vector<Node> child;
+    child.reserve(cur.size() - 1);
+    for (int k = 0; k < (int)cur.size(); k++)
+      if (k != c.i && k != c.j)
+        child.push_back(cur[k]);
+    child.push_back(std::move(c.node));
+    next.push_back(std::move(child));
+  }
+  return next;
+}
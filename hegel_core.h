@@ -0,0 +1,1695 @@
+// 24 点求解核心库：参数、数值与运算、搜索（Solver）、可达表与跨查询置换表、
+// 出题、计数、校验、提示与增量预求解。核心不做 I/O，也不引入 iostream、
+// sstream、fstream，命令行（Hegel Infix.cpp）、WASM（hegel_wasm.cpp）、Node
+// 扩展（hegel_napi.cpp）与基准测试（hegel_bench.cpp）各是一个前端，与
+// hegel_core.cpp 一起编译。即时输出的解经 Solver::print_answer 交给前端。
+#ifndef HEGEL_CORE_H
+#define HEGEL_CORE_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <climits>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace std;
+// ==================== Default Parameters ====================
+// 以下只是默认配置（见 default_config），求解时一律经 SolverConfig 读取，
+// hegel_configure 与 Node 扩展按需另建配置，不修改这里的值。
+static const int MAX_NEST = 4;
+static const int TARGET = 24;
+static const int MAX_USE_SQRT = 2;
+static const int MAX_USE_FACT = 2;
+static const int MAX_USE_LG = 1;
+static const int MAX_USE_LB = 2;
+static const int MAX_USE_LOG = 1;
+static const int MAX_USE_POW = 0; // 乘方 a ^ b（默认不启用）
+static const int MAX_USE_CAT = 0; // 数字拼接 a || b，只能拼输入的数字（默认不启用）
+static const bool NO_NEGATIVE_INTERMEDIATE = true;
+static const bool ONLY_ARITHMETIC = false;
+// 单次求解的内存上限（字节，0 表示不限），见 Solver::mem_budget
+static const size_t SOLVE_MEMORY_BUDGET = 0;
+// 求全部解时只保留排名最前的 K 个（0 表示全部保留），见 rank_expr
+static const int ANSWER_TOP_K = 0;
+// 另外统计见过的不同解总数（每个解只多记一个 64 位哈希）
+static const bool ANSWER_COUNT_DISTINCT = false;
+static const long long MAX_ABS_VAL = 1LL << 50;
+static const int MAX_FACT_ARG = 100;
+static const int MAX_EXP_SUM =
+    100; // Increased significantly for factorial chains
+
+// ==================== Constants ====================
+static const bool SKIP_EQUIV_DURING_SEARCH = true;
+static const bool MEMO_IN_FIND_ALL = true;
+// 找一个解时按函数次数与嵌套深度做支配剪枝（见 Solver::dominated）
+static const bool DOMINANCE_IN_FIND_FIRST = true;
+// 找一个解时按 history / killer 与目标导向的分数给子走法排序（见 ValueClass）
+static const bool MOVE_ORDERING_IN_FIND_FIRST = true;
+static const bool NORMAL_FIND_FIRST_ONLY = false;
+// 代价估计的默认探测次数（见 Solver::estimate_cost）
+static const int ESTIMATE_SAMPLES = 64;
+// 提示模式默认给出的续法个数，以及排出最简续法的时间预算（微秒，见
+// HintEngine）
+static const int HINT_LIMIT = 3;
+static const long long HINT_BUDGET_US = 2000;
+// 最接近模式默认给出的值的个数（见 NearMiss）
+static const int NEAR_MISS_K = 5;
+// 束搜索（见 BeamSearch）：第一轮的束宽、束宽上限与默认时限（微秒）
+static const int BEAM_WIDTH = 16;
+static const int BEAM_MAX_WIDTH = 2048;
+static const long long BEAM_BUDGET_US = 1000000;
+// Node 扩展的 count 未给 timeoutMs 时的时限（微秒，见 SolutionCounter::count）
+static const long long COUNT_BUDGET_US = 30000000;
+
+enum FuncIdx { F_SQRT, F_FACT, F_LG, F_LB, F_LOG, F_POW, F_CAT, F_CNT };
+// 各函数在参数里的名字（同原生扩展的 maxUse；参数扫描的网格与输出用）
+static const char *const FUNC_NAMES[F_CNT] = {"sqrt", "fact", "lg", "lb",
+                                              "log",  "pow",  "cat"};
+
+// ==================== 求解配置 ====================
+// 阶乘反查表：只取决于数值上限（max_fact_arg、max_abs_val、max_exp_sum），
+// 同一组上限的配置共用一份，make_config 不必每次重建
+struct FactTables {
+  vector<int> primes;                  // 不超过 max_fact_arg 的素数
+  unordered_map<long long, int> small; // n! -> n（能还原为 long long 的）
+  unordered_map<string, int> big;      // n! 的 num_key -> n
+};
+
+// 一次求解用到的全部参数。由 make_config 建好后只读共享（ConfigPtr），
+// Solver、可达表、出题与普查都只经它读取参数，所以不同配置的求解可以在同一
+// 进程的多个线程里同时进行。派生数据（目标的质因数、阶乘反查表、缓存键）
+// 也在 make_config 中一次算好。
+struct SolverConfig {
+  int target = TARGET;
+  int max_nest = MAX_NEST;
+  array<int, F_CNT> max_use = {MAX_USE_SQRT, MAX_USE_FACT, MAX_USE_LG,
+                               MAX_USE_LB,   MAX_USE_LOG,  MAX_USE_POW,
+                               MAX_USE_CAT};
+  bool no_negative = NO_NEGATIVE_INTERMEDIATE;
+  bool only_arithmetic = ONLY_ARITHMETIC;
+  long long max_abs_val = MAX_ABS_VAL; // 1 ~ 2^62
+  int max_fact_arg = MAX_FACT_ARG;     // 0 ~ 1000
+  int max_exp_sum = MAX_EXP_SUM;       // 1 ~ 10000
+  size_t memory_budget = SOLVE_MEMORY_BUDGET;
+
+  // ---- 派生数据（make_config 填写） ----
+  vector<pair<int, int>> target_factors; // 目标的质因数指数
+  shared_ptr<const FactTables> fact;    // 阶乘反查表（与同上限的配置共享）
+  string reach_key; // 影响可达集的参数（不含目标），置换表键的前缀
+  string key;       // 影响解集的全部参数，出题缓存与普查文件头用
+};
+typedef shared_ptr<const SolverConfig> ConfigPtr;
+ConfigPtr make_config(SolverConfig c);
+const ConfigPtr &default_config();
+
+struct Num {
+  int sign = 0;
+  vector<pair<int, int>> pe;
+  bool has_ll = false;
+  long long ll = 0;
+};
+
+// ======================= 运算符表 =======================
+// 每个运算符一个紧凑编号，RPN 记号、元数、代价、次数预算、求值与中缀写法
+// 都登记在 OPS 表里（定义在求值函数之后）；搜索、归一化、打印都按编号查表，
+// 记号字符串只在解析 RPN 时经 op_of_token 转换一次。
+// 编号顺序即二进制输出格式中的记号编码，只能在末尾追加。
+enum Opcode : unsigned char {
+  OP_ADD,
+  OP_SUB,
+  OP_MUL,
+  OP_DIV,
+  OP_LOG,
+  OP_SQRT,
+  OP_FACT,
+  OP_LG,
+  OP_LB,
+  OP_POW,
+  OP_CAT,
+  OP_CNT,
+  OP_LEAF = 0xff // 数字
+};
+// 中缀写法：a op b、name(a[, b])、a!
+enum OpForm { FORM_INFIX, FORM_CALL, FORM_POSTFIX };
+
+struct OpInfo {
+  const char *token;
+  int arity;
+  int cost;         // 评级代价：+ - * 各 1，/ || 2，一元函数与 ^ 3，log 4
+  int func;         // 计入 max_use 的编号（FuncIdx），-1 表示不限次数
+  bool nest;        // 是否算一层函数嵌套（max_nest）
+  bool commutative; // 交换律（决定是否还要尝试交换操作数）
+  bool literals;    // 操作数只能是输入的数字或其拼接
+  int prec;         // 中缀优先级：1 加减，2 乘除，3 函数、乘方与拼接，4 数字
+  OpForm form;
+  // 搜索时的求值（含剪枝规则）
+  bool (*num1)(const SolverConfig &, const Num &, Num &);
+  bool (*num2)(const SolverConfig &, const Num &, const Num &, Num &);
+};
+extern const OpInfo OPS[OP_CNT];
+
+// RPN 记号 -> 编号，数字返回 OP_LEAF
+inline int op_of_token(const string &t) {
+  switch (t.size()) {
+  case 1:
+    switch (t[0]) {
+    case '+':
+      return OP_ADD;
+    case '-':
+      return OP_SUB;
+    case '*':
+      return OP_MUL;
+    case '/':
+      return OP_DIV;
+    case '!':
+      return OP_FACT;
+    case '^':
+      return OP_POW;
+    }
+    return OP_LEAF;
+  case 2:
+    if (t[0] == 'l' && t[1] == 'g')
+      return OP_LG;
+    if (t[0] == 'l' && t[1] == 'b')
+      return OP_LB;
+    if (t[0] == '|' && t[1] == '|')
+      return OP_CAT;
+    return OP_LEAF;
+  case 3:
+    return t == "log" ? OP_LOG : OP_LEAF;
+  case 4:
+    return t == "sqrt" ? OP_SQRT : OP_LEAF;
+  }
+  return OP_LEAF;
+}
+
+// ======================= 规范形哈希 =======================
+// 表达式在“加减、乘除的交换律与结合律，去掉 +0、*1”下的等价类用 64 位哈希
+// 表示，由子式的哈希在 O(1) 内增量算出，判等只需比较整数：
+//   连续的 + -（或 * /）展开成一组带符号的项，组的哈希是各项哈希之和
+//   （多重集哈希，与顺序无关，合并两组只需相加）；值为 0 的项（乘除组里为 1）
+//   直接丢掉。整组变号后的和也一并维护，取两者中较小的一个，必要时再取负，
+//   使 a - b 与 0 - (b - a) 同类；只剩一项时该组就是这一项本身（或其负）。
+// 组内各项不排序、不拼字符串，每个结点只多几个整数。
+struct Canon {
+  uint64_t key = 0;
+  // 根为 + -（或 * /）时该组的展开：pos 为各项哈希之和，neg 为整组变号后的
+  // 和，cnt 为项数；只有一项时 one、one_neg 为该项及其符号
+  uint64_t pos = 0, neg = 0, one = 0;
+  int cnt = 0;
+  bool one_neg = false;
+};
+
+inline uint64_t canon_mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+inline uint64_t canon_tag(uint64_t tag, uint64_t a, uint64_t b = 0) {
+  return canon_mix(canon_mix(a ^ (tag << 56)) + b);
+}
+enum : uint64_t {
+  CANON_LEAF = 0x41, // 运算符编号之外的标签
+  CANON_ADD,
+  CANON_MUL,
+  CANON_TERM_POS,
+  CANON_TERM_NEG
+};
+// 取负是对合（异或同一个常数），-(-x) 与 x 同类
+inline uint64_t canon_neg(uint64_t k) {
+  return k ^ 0x5bd1e9955bd1e995ULL;
+}
+
+// 数字记号；负数记为其绝对值取负，与 0 - x 同类
+Canon canon_leaf(const string &tok);
+static const uint64_t CANON_ZERO = canon_leaf("0").key;
+static const uint64_t CANON_ONE = canon_leaf("1").key;
+
+// 一元运算
+Canon canon_apply1(int op, const Canon &a);
+
+// x 作为加减组（add）或乘除组中的一项；flip 为整体变号（减数、除数）
+Canon canon_group_of(const Canon &x, int root, bool add, bool flip);
+
+// 二元运算：a、b 为左右操作数的规范形，a_root、b_root 为其最后一步运算
+Canon canon_apply2(int op, const Canon &a, int a_root, const Canon &b,
+                   int b_root);
+
+// 由 RPN 重算规范形哈希（只有表达式、没有 Node 时用）；格式错误返回 0
+uint64_t canon_of_expr(const vector<string> &expr);
+
+struct Node {
+  Num num;
+  vector<string> expr;                // RPN tokens
+  array<unsigned char, F_CNT> used{}; // 每种函数使用次数
+  int depth = 0;                      // 最大嵌套深度
+  unsigned char root = OP_LEAF;       // 最后一步运算的编号
+  Canon canon;                        // 规范形哈希，等价的表达式相同
+};
+
+// 可以作为拼接操作数：输入的数字或其拼接
+inline bool is_literal_node(const Node &nd) {
+  return nd.root == OP_LEAF || nd.root == OP_CAT;
+}
+
+// --------------- 工具：RPN 拼接 ---------------
+inline vector<string>
+merge_expr(const vector<string> &a, const vector<string> &b, const string &op) {
+  vector<string> res;
+  res.reserve(a.size() + b.size() + 1);
+  res.insert(res.end(), a.begin(), a.end());
+  res.insert(res.end(), b.begin(), b.end());
+  res.push_back(op);
+  return res;
+}
+inline vector<string> apply_unary_expr(const vector<string> &a,
+                                              const string &op) {
+  vector<string> res = a;
+  res.push_back(op);
+  return res;
+}
+
+// 从 s[pos] 起跳过空白读一个十进制整数（可带正负号），成功时 pos 移到它之后，
+// 溢出或没有数字时返回 false。核心不用 stoll / istringstream，不依赖异常与流
+bool scan_ll(const string &s, size_t &pos, long long &out);
+
+bool try_parse_ll(const string &t, long long &out);
+// 10^(b 的位数)，b >= 0
+long long digit_span(long long b);
+bool safe_cat_ll(long long a, long long b, long long &out);
+// Forward declarations
+bool is_perfect_square_ll(long long x, long long &r);
+int reach_tt_find_first(const ConfigPtr &config, const vector<long long> &nums,
+                        vector<string> &witness);
+
+// ======================= 内存估算与 clock 淘汰 =======================
+// 按“字符串堆容量 + 容器结点开销”估算字节数，只求量级可靠，用于内存预算。
+static const size_t HASH_ENTRY_OVERHEAD = 48; // 哈希结点、缓存的 hash、桶指针
+
+inline size_t string_bytes(const string &s) {
+  return sizeof(string) + (s.capacity() > 15 ? s.capacity() + 1 : 0);
+}
+inline size_t expr_bytes(const vector<string> &e) {
+  size_t b = sizeof(e) + (e.capacity() - e.size()) * sizeof(string);
+  for (const string &t : e)
+    b += string_bytes(t);
+  return b;
+}
+inline size_t value_bytes(bool) { return 0; }
+inline size_t value_bytes(const string &s) { return string_bytes(s); }
+
+// 字符串键哈希表，满了按 clock（二次机会）策略逐项淘汰：命中时置访问位，
+// 时钟指针扫过环形槽位，访问位为 1 的清零放过，为 0 的淘汰。
+template <class V> struct ClockMap {
+  struct Entry {
+    V value;
+    bool ref = false;
+  };
+  unordered_map<string, Entry> map;
+  vector<const string *> ring; // 指向 map 中的键（rehash 不会使其失效）
+  size_t hand = 0;
+  size_t entry_bytes = 0;
+
+  size_t size() const { return map.size(); }
+  size_t bytes() const {
+    return entry_bytes + map.bucket_count() * sizeof(void *) +
+           ring.capacity() * sizeof(void *);
+  }
+
+  V *find(const string &k) {
+    auto it = map.find(k);
+    if (it == map.end())
+      return nullptr;
+    it->second.ref = true;
+    return &it->second.value;
+  }
+  // 已存在时只置访问位并返回 false
+  bool insert(string k, V v) {
+    auto r = map.emplace(std::move(k), Entry{std::move(v), false});
+    if (!r.second) {
+      r.first->second.ref = true;
+      return false;
+    }
+    ring.push_back(&r.first->first);
+    entry_bytes += string_bytes(r.first->first) +
+                   value_bytes(r.first->second.value) + HASH_ENTRY_OVERHEAD;
+    return true;
+  }
+  // 改写 k 的值并按新旧大小修正字节数；k 不存在时同 insert
+  void assign(const string &k, V v) {
+    auto it = map.find(k);
+    if (it == map.end()) {
+      insert(k, std::move(v));
+      return;
+    }
+    entry_bytes -= value_bytes(it->second.value);
+    it->second.value = std::move(v);
+    entry_bytes += value_bytes(it->second.value);
+    it->second.ref = true;
+  }
+  // 淘汰一项；表为空时返回 false
+  bool evict_one() {
+    while (!ring.empty()) {
+      if (hand >= ring.size())
+        hand = 0;
+      auto it = map.find(*ring[hand]);
+      if (it->second.ref) {
+        it->second.ref = false;
+        hand++;
+        continue;
+      }
+      entry_bytes -= string_bytes(it->first) + value_bytes(it->second.value) +
+                     HASH_ENTRY_OVERHEAD;
+      ring[hand] = ring.back();
+      ring.pop_back();
+      map.erase(it);
+      return true;
+    }
+    return false;
+  }
+  // 清空并归还内存（clear 不会释放桶数组）
+  void release() {
+    unordered_map<string, Entry>().swap(map);
+    vector<const string *>().swap(ring);
+    hand = 0;
+    entry_bytes = 0;
+  }
+};
+
+int count_leaf_tokens(const vector<string> &expr);
+
+// --------------- 解的排名 ---------------
+// 越小越好：运算符个数、函数个数、函数嵌套深度、负数或分数中间结果的步数，
+// 最后加号多的写法优先（与原先同类解只保留加号最多者一致）
+struct AnswerRank {
+  int ops = 0;
+  int funcs = 0;
+  int depth = 0;
+  int odd_steps = 0;
+  int neg_plus = 0;
+  bool operator<(const AnswerRank &o) const;
+};
+
+AnswerRank rank_expr(const vector<string> &expr);
+
+// --------------- 质因数分解（仅对 |v|<=max_abs_val 范围做） ---------------
+// 小因子试除，剩余部分用 Miller-Rabin + Pollard-Brent rho；
+// 纯试除在 ~2^50 的大素数上要循环 3000 多万次，是搜索的主要热点。
+typedef unsigned long long u64;
+
+inline u64 mulmod_u64(u64 a, u64 b, u64 m) {
+  return (u64)((unsigned __int128)a * b % m);
+}
+u64 powmod_u64(u64 a, u64 e, u64 m);
+// 对 2^64 以内确定性正确的 Miller-Rabin
+bool is_prime_u64(u64 n);
+// n 为奇合数，返回一个非平凡因子
+u64 pollard_brent(u64 n);
+void collect_prime_factors(u64 n, vector<u64> &out);
+
+vector<pair<int, int>> factorize_small(long long x);
+
+int exp_sum(const vector<pair<int, int>> &pe);
+
+// factors: out = a + b (指数相加)
+vector<pair<int, int>> factors_add(const vector<pair<int, int>> &a,
+                                   const vector<pair<int, int>> &b);
+
+// factors: out = a - b (指数相减)，要求 a 可被 b 整除（每个指数>=）
+bool factors_subtract(const vector<pair<int, int>> &a,
+                      const vector<pair<int, int>> &b,
+                      vector<pair<int, int>> &out);
+
+// 尝试把质因数指数还原为 |v|（只在 <=max_abs_val 时成功；全程不用浮点）
+bool try_eval_small_abs(const SolverConfig &c, const vector<pair<int, int>> &pe,
+                        long long &out_abs);
+
+void normalize_num(const SolverConfig &c, Num &n);
+
+Num make_num_from_ll_pruned(const SolverConfig &c, long long v, bool &ok);
+
+// --------------- 完全平方判定（整数） ---------------
+bool is_perfect_square_ll(long long x, long long &r);
+
+// --------------- 阶乘质因子（Legendre） ---------------
+// 不超过 SMALL_PRIME_MAX 的素数表在编译期筛好，作为只读数据放进程序，启动与
+// 每次 make_config 都不再筛。阶乘的参数（max_fact_arg）与大数试除的素数
+// （BIG_TRIAL_PRIME）都不超过它
+static const int SMALL_PRIME_MAX = 1000;
+constexpr int count_primes(int n) {
+  int c = 0;
+  for (int i = 2; i <= n; i++) {
+    bool prime = true;
+    for (int d = 2; d * d <= i && prime; d++)
+      prime = i % d != 0;
+    c += prime;
+  }
+  return c;
+}
+typedef array<int, count_primes(SMALL_PRIME_MAX)> SmallPrimes;
+constexpr SmallPrimes make_small_primes() {
+  SmallPrimes ps = {};
+  bool comp[SMALL_PRIME_MAX + 1] = {};
+  size_t k = 0;
+  for (int i = 2; i <= SMALL_PRIME_MAX; i++) {
+    if (comp[i])
+      continue;
+    ps[k++] = i;
+    for (int j = i * i; j <= SMALL_PRIME_MAX; j += i)
+      comp[j] = true;
+  }
+  return ps;
+}
+static constexpr SmallPrimes SMALL_PRIMES = make_small_primes();
+
+// 不超过 n（<= SMALL_PRIME_MAX）的素数
+vector<int> primes_up_to(int n);
+
+vector<pair<int, int>> factorial_factors(const SolverConfig &c, int n);
+
+// --------------- 函数使用次数合并检查 ---------------
+bool merge_used(const SolverConfig &c, const Node &A, const Node &B,
+                array<unsigned char, F_CNT> &out);
+bool inc_used(const SolverConfig &c, const Node &A, FuncIdx f,
+              array<unsigned char, F_CNT> &out);
+
+// --------------- 目标判断（不依赖大整数） ---------------
+bool is_target_24(const SolverConfig &c, const Num &n);
+
+// --------------- 大数加减 ---------------
+// 超出 max_abs_val 的值只以质因数指数表示（如 (5!)!）。加减时先提出两数的
+// 公因子 g（只在指数上运算，不展开），余下部分都不大时直接用 __int128 计算；
+// 否则才在定长 limb 数组里展开。结果再用小素数试除还原为质因数指数，除不尽
+// （含大素因子）的无法表示，放弃。
+// 去掉 g 后 A、B、A±B 中最大者超过 BIG_COFACTOR_BITS 位时，和差几乎不可能
+// 只含小素因子，直接放弃：先按指数估算位数，展开后再按实际位数判断。三个数
+// 同时出现在正向运算和末步反解里，两边的取舍一致。
+static const int BIG_LIMBS = 4;           // 256 位
+static const int BIG_COFACTOR_BITS = 128; // 去掉公因子后的位数上限
+static const int BIG_TRIAL_PRIME = 1000;  // 试除的素数上限
+
+struct BigNat {
+  u64 d[BIG_LIMBS]; // 低位在前
+  int n = 0;        // 有效 limb 数，0 表示 0
+
+  bool mul_small(u64 m);
+  u64 mod_small(u64 m) const;
+  void div_small(u64 m);
+  int bits() const;
+  bool from_pe(const vector<pair<int, int>> &pe);
+};
+
+int big_cmp(const BigNat &a, const BigNat &b);
+// a += b
+bool big_add(BigNat &a, const BigNat &b);
+// a -= b（a >= b）
+void big_sub(BigNat &a, const BigNat &b);
+
+double log2_of_pe(const vector<pair<int, int>> &pe);
+
+// x 分解为质因数指数；素因子放不进 int 时返回 false
+bool factorize_checked(u64 x, vector<pair<int, int>> &pe);
+
+// 试除用的素数分组：每组素数之积不超过 64 位，先对组积取一次模，
+// 只有余数与组积不互素时才逐个试除，大数的长除法次数降到约 1/6
+struct TrialChunk {
+  u64 prod;
+  vector<int> primes;
+};
+const vector<TrialChunk> &trial_chunks();
+
+// v（非零）还原为质因数指数：先试除小素数，余下部分须是放得进 int 的素数，
+// 或者不超过 max_abs_val（与普通整数一样完整分解），否则放弃。v 会被改写
+bool big_factorize(const SolverConfig &cfg, BigNat &v,
+                   vector<pair<int, int>> &pe);
+
+// A + B（sub 时 A - B），供至少一方为大数时使用；剪枝规则与小数一致
+bool num_add_big(const SolverConfig &c, const Num &A, const Num &B, bool sub,
+                 Num &out);
+
+// 按质因数指数开 k 次方（各指数都须能被 k 整除）
+bool pe_root(const vector<pair<int, int>> &pe, long long k,
+             vector<pair<int, int>> &out);
+
+// b 是否为 a 的整数次幂（a >= 2），是则给出指数
+bool pe_log(const vector<pair<int, int>> &a, const vector<pair<int, int>> &b,
+            long long &k);
+
+// --------------- 各运算符的求值（含剪枝） ---------------
+bool num_sqrt(const SolverConfig &c, const Num &a, Num &out);
+
+bool num_fact(const SolverConfig &c, const Num &a, Num &out);
+
+bool num_lg(const SolverConfig &c, const Num &a, Num &out);
+
+bool num_lb(const SolverConfig &c, const Num &a, Num &out);
+
+// log_a(b)
+bool num_log(const SolverConfig &c, const Num &A, const Num &B, Num &out);
+
+bool num_add(const SolverConfig &c, const Num &A, const Num &B, Num &out);
+
+bool num_sub(const SolverConfig &c, const Num &A, const Num &B, Num &out);
+
+bool num_mul(const SolverConfig &c, const Num &A, const Num &B, Num &out);
+
+bool num_div(const SolverConfig &c, const Num &A, const Num &B, Num &out);
+
+// a ^ b：b 为不小于 2 的整数；底数为 0、±1 的平凡情形不展开
+bool num_pow(const SolverConfig &c, const Num &A, const Num &B, Num &out);
+
+// a || b：十进制拼接，a >= 1、b >= 0（拼出的数不超过 max_abs_val）
+bool num_cat(const SolverConfig &c, const Num &A, const Num &B, Num &out);
+
+// 不剪枝的求值（校验答案用）：搜索为去掉冗余写法而拒绝的平凡情形，如
+// x / 1、0! 1! 2! 4!、sqrt(0)、sqrt(1)、lb(4)、log(a, 1)、x ^ 1，在这里照常
+// 计算；其余同 OPS 表
+bool num_exact1(const SolverConfig &c, int op, const Num &a, Num &out);
+bool num_exact2(const SolverConfig &c, int op, const Num &A, const Num &B,
+                Num &out);
+
+// ======================= RPN -> 中缀（高性能：栈式一次扫描）
+// =======================
+struct InfixItem {
+  string s;
+  int prec; // 1:+- 2:*/ 3:func/!/^/|| 4:atom
+  char bop; // 若顶层是中缀运算符：+ - * / ^ |（拼接），否则为 0
+};
+
+inline int prec_of_binop(char op) {
+  if (op == '+' || op == '-')
+    return 1;
+  if (op == '*' || op == '/')
+    return 2;
+  if (op == '^' || op == '|')
+    return 3;
+  return 0;
+}
+inline bool need_paren_left(char op, const InfixItem &a) {
+  if (op == '^') // 乘方右结合，底数不是单个数字或函数就加括号
+    return a.prec < 3 || a.bop != 0 || a.s[0] == '-';
+  if (op == '|') // 左边只会是数字或拼接
+    return false;
+  if (a.bop == '|')
+    return true;
+  int p = prec_of_binop(op);
+  if (a.prec < p)
+    return true;
+  // 同优先级下左结合：左侧一般不需要括号
+  return false;
+}
+inline bool need_paren_right(char op, const InfixItem &b) {
+  if (op == '^')
+    return b.prec < 3 || b.bop != 0;
+  if (op == '|') // 右边只会是数字
+    return false;
+  if (b.bop == '|')
+    return true;
+  int p = prec_of_binop(op);
+  if (op == '+') {
+    if (b.prec < p)
+      return true;
+    // a + (b - c) 必须加括号
+    if (b.prec == p && b.bop == '-')
+      return true;
+    return false;
+  }
+  if (op == '-') {
+    // a - (b +/- c) 必须加括号
+    if (b.prec <= p)
+      return true;
+    return false;
+  }
+  if (op == '*') {
+    if (b.prec < p)
+      return true;
+    // a * (b / c) 必须加括号
+    if (b.prec == p && b.bop == '/')
+      return true;
+    return false;
+  }
+  if (op == '/') {
+    // a / (b * c) 和 a / (b / c) 都必须加括号
+    if (b.prec <= p)
+      return true;
+    return false;
+  }
+  return false;
+}
+
+// 无法还原时原样输出 RPN
+string rpn_raw(const vector<string> &expr);
+
+string rpn_to_infix(const vector<string> &expr);
+
+// --------------- 一组解 ---------------
+// 按 answer_key（规范形哈希加数字个数）去重。Solver 限定了 top_k 时
+// best_order 按 (排名, key) 排序，新解优于最差者才替换它，内存只与 K 有关；
+// seen 为全部见过的 key，只在统计不同解总数时使用。
+struct AnswerBook {
+  unordered_map<uint64_t, vector<string>> best_exprs;
+  unordered_map<uint64_t, AnswerRank> best_rank;
+  set<pair<AnswerRank, uint64_t>> best_order;
+  unordered_set<uint64_t> seen;
+
+  // 见过的不同解个数（未开启统计时为保留下来的个数）
+  size_t distinct_count() const { return max(seen.size(), best_exprs.size()); }
+
+  // 保留下来的解，按排名从好到差，同排名按 RPN 记号排序
+  vector<const vector<string> *> ranked() const;
+
+  void release_answers();
+};
+
+// --------------- 最接近目标的式子 ---------------
+// 无解时求全部解的遍历已经到过每个叶子（只剩一个数的状态），顺便记下值离目标
+// 最近的前 k 个不同的值，每个值保留排名最好的写法。best 按（距离, 值）升序，
+// 表满后更远的叶子只比较一次距离就丢掉，不拼键也不算排名。
+// 除法只取整除，叶子的值都是整数：放得进 long long 的按 |值 - 目标| 精确比较；
+// 只以质因数指数表示的大数一定更远，按 log2|值| 近似比较。
+struct NearMiss {
+  struct Entry {
+    bool big = false;  // 值只有质因数指数表示
+    long long dist = 0; // |值 - 目标|（!big）
+    double log2 = 0;    // log2|值|（big）
+    Num value;
+    vector<string> expr;
+    AnswerRank rank;
+  };
+  size_t k = 0; // 0 表示不记
+  vector<Entry> best;
+
+  void clear() { vector<Entry>().swap(best); }
+
+  // (big, dist, log2, v) 与 e 比较远近，同一个值返回 0
+  static int compare(bool big, long long dist, double lg, const Num &v,
+                     const Entry &e);
+
+  // 叶子 nd（须用满 leaves 个数字）
+  void offer(const SolverConfig &c, const Node &nd, int leaves);
+
+  // 值的文字：整数原样，大数为 ≈±2^x
+  static string value_text(const Entry &e);
+};
+
+// --------------- 代价估计 ---------------
+// 求解前对搜索量的预估，供调用方决定排队、降级为 find-first 或直接拒绝。
+// states 与 tree 由 Knuth 随机探测得到（见 Solver::estimate_cost），
+// 其余是零成本的输入特征。
+struct CostEstimate {
+  // 按 find-first 估计时为找不到解（搜索不提前结束）时的上界
+  bool find_first = false;
+  double states = 0;   // 求解将访问的状态数估计（对应 Solver::states）
+  double tree = 0;     // 不计记忆化时的搜索树结点数估计（上界）
+  double rel_err = 0;  // states 的相对标准误差
+  int samples = 0;     // 探测次数
+  int numbers = 0;     // 数字个数
+  double max_abs = 0;  // 输入数字绝对值的最大值
+  int func_budget = 0; // 各函数可用次数之和（只做四则运算时为 0）
+  long long probe_us = 0;
+};
+
+// --------------- 走法排序 ---------------
+// 找一个解时 DFS 先生成一个状态的全部子走法，按分数从高到低尝试：
+//   * 目标导向：运算结果的值类（等于目标、整除目标、0、1 等）给静态加分；
+//   * history：同类走法出现在已找到的解的路径上的加权次数（剩的数越多
+//     权越大）；
+//   * killer：每层（按剩余个数）最近一次通向解的走法类，排在最前。
+// 走法类 = 走法编号（一元 0~3、二元 4~15，顺序同 DFS）× 两个操作数的值类，
+// 与具体数值无关，一道题学到的“两数相减得 1”“积整除目标”能用到别的题上。
+// 表在进程内跨求解共享（同置换表），多个线程以 relaxed 原子量读写，偶尔
+// 丢一次更新只影响顺序，不影响正确性。
+enum ValueClass {
+  VC_ZERO,
+  VC_ONE,
+  VC_DIVISOR,  // 整除目标的正整数（不含 1 与目标本身）
+  VC_TARGET,
+  VC_MULTIPLE, // 目标的倍数
+  VC_SMALL,    // 其余小于目标的正整数
+  VC_LARGE,    // 其余大于目标的正整数
+  VC_OTHER,    // 负数、分数与只以质因数表示的大数
+  VC_CNT
+};
+int value_class(const SolverConfig &c, const Num &v);
+
+// 清空走法表（history 与 killer）。表本身在 hegel_core.cpp 中
+void reset_move_history();
+
+// --------------- Solver ---------------
+struct Solver : AnswerBook {
+  // 求解参数（只读，可与其他 Solver 共享）；由调用方在 begin 之前设置
+  ConfigPtr config = default_config();
+
+  bool find_first = false;
+  bool found = false;
+  int expected_leaf_count = 0;
+  vector<string> first_expr;
+  bool immediate_print = false;
+  string immediate_prefix;
+  // 即时输出一个解（RPN、目标、immediate_prefix），由前端在求解之前设置；
+  // 为空时不输出
+  function<void(const vector<string> &, int, const string &)> print_answer;
+
+  // 为 false 时 try_* 只算值、次数与规范形，不拼 RPN（解计数的可达表用）
+  bool keep_expr = true;
+  // 为 true 时 try_* 改用 num_exact1 / num_exact2，不做冗余剪枝（校验答案用）
+  bool exact = false;
+
+  // 求全部解时保留的解数上限（0 不限）与是否统计不同解总数；
+  // 由调用方在 begin 之前设置，默认取全局参数
+  size_t top_k = ANSWER_TOP_K > 0 ? (size_t)ANSWER_TOP_K : 0;
+  bool count_distinct = ANSWER_COUNT_DISTINCT;
+  // near.k > 0 时，求全部解的遍历顺便记下离目标最近的值（无解时给玩家看）；
+  // 由调用方在 begin 之前设置 near.k
+  NearMiss near;
+
+  ClockMap<bool> memo; // 记忆化用（超出内存预算时按 clock 淘汰）
+  // 找一个解时代替 memo：按数值多重集记录已进入状态的（函数次数, 深度）
+  // 帕累托前沿，见 dominated。dominance 由调用方在 begin 之前设置
+  ClockMap<string> frontier;
+  bool dominance = DOMINANCE_IN_FIND_FIRST;
+  // 找一个解时给子走法排序（见 ValueClass），由调用方在 begin 之前设置
+  bool move_ordering = MOVE_ORDERING_IN_FIND_FIRST;
+  // 已进入状态的规范形哈希（SKIP_EQUIV_DURING_SEARCH）：按不同顺序做同一批
+  // 运算得到的状态只需比较一个整数，不必先拼出 state_key 再查 memo
+  unordered_set<uint64_t> equiv_seen;
+
+  // ========== 内存预算 ==========
+  // 统计 memo、frontier、equiv_seen、答案表（含多目标）与栈上各层 pair_seen
+  // 的估算字节数。超出 mem_budget 时先整个丢掉 equiv_seen，再淘汰 memo 与
+  // frontier 项（都只会造成重复搜索，不影响正确性），
+  // 一次淘汰到预算的 7/8 以免每次插入都触发；答案表与 pair_seen 本身
+  // 已超出预算时无法再腾挪，停止搜索，保留已有结果并置 mem_truncated。
+  // 每次求解开始时归还上一次的内存。
+  size_t mem_budget = 0; // 每次求解开始时取 config->memory_budget
+  size_t mem_answers = 0;
+  size_t mem_pairs = 0;
+  size_t mem_peak = 0;
+  bool mem_truncated = false;
+
+  size_t equiv_bytes() const;
+  size_t mem_used() const;
+
+  void mem_check();
+
+  // 归还本次求解占用的内存（结果也一并清空）
+  void release();
+
+  // node key（用于记忆化）
+  static string num_key(const Num &n);
+  // cat：是否启用了拼接（max_use[F_CAT] > 0）
+  static string node_key(const Node &nd, bool cat);
+  static string state_key(const vector<Node> &cur, bool cat);
+
+  // 支配剪枝（找一个解）：数值相同时，每个结点的函数次数与嵌套深度都不超过
+  // 对方的状态能做的运算是对方的超集，能凑出的解也是。以去掉次数与深度的
+  // state_key 为键，记下已进入状态的次数与深度（每个状态一条定长记录，结点
+  // 按数值、次数、深度排序后逐个拼接，每项一字节），只保留互不支配的记录。
+  // cur 被某条记录支配（含完全相同）时返回 true，否则记入并删去被它支配的
+  // 记录。同值结点只按排序后的位置配对，漏判只是少剪，不影响正确性
+  bool dominated(const vector<Node> &cur);
+
+  // 状态的规范形哈希：各结点规范形的多重集哈希。等价的结点数值、函数次数、
+  // 嵌套深度都相同，所以规范形相同的状态 state_key 也相同；启用拼接时再
+  // 区分数字与拼接结果（同 node_key）
+  uint64_t equiv_key(const vector<Node> &cur) const;
+  // 一个结点在 equiv_key 中的项（状态的哈希是各项之和，可以增量更新）
+  uint64_t node_equiv(const Node &nd) const;
+
+  // 一个解在答案表中的估算字节数（两张哈希表，限定 top_k 时还有排序集合）
+  size_t answer_bytes(const vector<string> &expr) const;
+
+  // 解的去重 key：规范形哈希（见 Canon）再区分所用数字个数，
+  // 使 x 与 x * 1 不算同一个解
+  static uint64_t answer_key(uint64_t canon, const vector<string> &expr);
+
+  // 按规范形去重记录一个解（canon 为其规范形哈希），同类中保留排名更好的
+  // 写法；限定 top_k 时表满后新解须优于当前最差的解，并将其挤出。
+  // 返回是否写入，is_better 表示替换了已有的同类解
+  bool record_answer(AnswerBook &book, const vector<string> &expr,
+                     uint64_t canon, bool &is_better);
+
+  void add_answer(const vector<string> &expr, uint64_t canon);
+
+  // ========== 多目标 ==========
+  // 搜索本身与目标无关（剪枝和记忆化都不看 target），因此一次遍历即可在叶子上
+  // 同时比对多个目标，结果按目标分组。targets 非空时忽略 config->target。
+  struct TargetHits : AnswerBook {
+    long long target = 0;
+    bool found = false;
+    vector<string> first_expr;
+  };
+  vector<TargetHits> targets;
+  unordered_map<long long, int> target_index;
+  int targets_pending = 0; // find_first 下尚未找到解的目标数
+
+  // 可以停止搜索：超出内存预算，或 find_first 下所有目标都已找到
+  bool search_done() const;
+
+  // immediate_print 时把解交给 print_answer
+  void emit(const vector<string> &expr) const;
+
+  void hit_targets(const Node &nd);
+
+  bool cat_enabled() const { return config->max_use[F_CAT] > 0; }
+
+  // ========== 按运算符表尝试一步运算 ==========
+  bool try_op1(int op, const Node &A, Node &out);
+
+  bool try_op2(int op, const Node &A, const Node &B, Node &out);
+
+  // op: 0 sqrt, 1 !, 2 lg, 3 lb（即 FuncIdx，与 DFS 一元阶段的顺序一致）
+  bool try_unary(int op, const Node &A, Node &out);
+
+  // 二元走法：运算符及是否交换左右操作数。编号即 try_binary 的 op，
+  // 与 DFS 二元阶段的顺序一致
+  struct BinMove {
+    unsigned char op;
+    bool swap;
+  };
+  static constexpr BinMove BIN_MOVES[] = {
+      {OP_ADD, false}, {OP_SUB, false}, {OP_SUB, true}, {OP_MUL, false},
+      {OP_DIV, false}, {OP_DIV, true},  {OP_LOG, false}, {OP_LOG, true},
+      {OP_POW, false}, {OP_POW, true},  {OP_CAT, false}, {OP_CAT, true},
+  };
+
+  // op: 0 +, 1 -, 2 -', 3 *, 4 /, 5 /', 6 log, 7 log', 8 ^, 9 ^', 10 ||,
+  // 11 ||'（带 ' 的交换左右操作数）
+  bool try_binary(int op, const Node &A, const Node &B, Node &out);
+
+  // ========== 目标导向的末步求解（find_first 单目标） ==========
+  // 叶子上不再套一元函数，所以最后一步必为 op(X, Y)。只剩两三个数时不再逐个
+  // 展开子状态，而是枚举 X、由目标反解出所需的 Y，再到另一侧的值索引里查找：
+  //   {A, B}：X 取自 A 的一元闭包，Y 取自 B 的一元闭包（按值建索引）；
+  //   {P, Q, R}：X 取自 P 的闭包，Y = chain(Q' op R')。先由 Y 反推一元原像 Z，
+  //   再对 Q 闭包中的每个 Q' 反解 R'，到 R 的闭包索引里查找；P 轮流取三个数。
+  // 反解只看数值，命中后仍用 try_* 逐步复核，函数次数、嵌套深度等约束与
+  // 正常展开完全一致。
+
+  // 闭包去重用的结点签名：能还原为 long long 的按（值, 函数次数, 深度），
+  // 大数退回 node_key 字符串
+  struct NodeSeen {
+    struct Hash {
+      size_t operator()(const pair<long long, unsigned long long> &k) const {
+        return canon_mix(canon_mix((uint64_t)k.first) ^ k.second);
+      }
+    };
+    unordered_set<pair<long long, unsigned long long>, Hash> small;
+    unordered_set<string> big;
+    bool cat = false; // 同 node_key
+
+    void clear();
+    // 能还原为 long long 的结点除值以外的部分（函数次数、深度、拼接类别）
+    static unsigned long long small_tag(const Node &nd, bool cat);
+    bool insert(const Node &nd);
+  };
+
+  // 把 A 的一元闭包（含 A 本身）追加到 out，seen 负责去重
+  void add_closure(const Node &A, vector<Node> &out, NodeSeen &seen);
+
+  // 反解出的“所需值”：any 表示任意值都满足（如 0 * Y = 0）。
+  // 由 long long 构造时质因数按需分解（加减法查找只用 ll）。
+  struct Want {
+    bool any = false;
+    bool has_pe = false;
+    Num num;
+
+    static Want of_ll(long long v);
+    static Want of_num(const SolverConfig &cfg, Num n);
+    const Num &full();
+  };
+
+  // 值索引：能还原为 long long 的按值，其余（大数）按 num_key
+  struct ValueIndex {
+    unordered_map<long long, vector<int>> small;
+    unordered_map<string, vector<int>> big;
+    vector<int> all;
+
+    void clear();
+    void add(const Num &n, int i);
+    void build(const vector<Node> &nodes);
+    const vector<int> *find(const Want &w) const;
+  };
+
+  // 对 op(X, Y) == t 反解 Y：按 try_binary 的 op 编号依次调用 fn(op, want)，
+  // fn 返回 true 即停止并返回 true。查找一侧没有大数时 big_ok 为 false，
+  // 跳过结果必为大数的反解（省去质因数分解）。
+  template <class Fn>
+  static bool for_each_inverse(const SolverConfig &cfg, const Num &xn, Want &t,
+                               bool big_ok, Fn fn);
+
+  // 乘方与拼接（op 8~11）
+  template <class Fn>
+  static bool for_each_extra_inverse(const SolverConfig &cfg, const Num &xn,
+                                     Want &t, bool big_ok, Fn fn);
+
+  // 四则与 log（op 0~7）
+  template <class Fn>
+  static bool for_each_arith_inverse(const SolverConfig &cfg, const Num &xn,
+                                     Want &t, bool big_ok, Fn fn);
+
+  // y 的一元原像：所有满足 chain(z) == y 的 (z, chain)，chain 为从 z 起依次
+  // 施加的一元运算，含 y 自身（空链）。只看数值和次数上限，其余留给复核。
+  struct Preimage {
+    Want z;
+    vector<int> chain;
+  };
+  static void unary_preimages(const SolverConfig &cfg, const Want &y,
+                              vector<Preimage> &out);
+
+  vector<Node> last_closure[3];
+  ValueIndex last_index;
+  NodeSeen last_seen;
+  vector<Preimage> last_pre;
+
+  // 复核 op(X, Y) 并按叶子处理
+  bool try_last(int op, const Node &X, const Node &Y);
+
+  void solve_last(const vector<Node> &cur);
+
+  // ========== DFS（显式栈，可挂起/恢复） ==========
+  // 每个 Frame 对应递归版 dfs 的一次调用：cur 为当前状态，
+  // (stage, i, j, op) 为下一个待尝试的子状态游标。
+  enum { ST_UNARY, ST_BINARY, ST_DONE };
+  static const int UNARY_OPS = 4; // sqrt ! lg lb
+  static const int BINARY_OPS =
+      (int)(sizeof(BIN_MOVES) / sizeof(BIN_MOVES[0])); // 见 try_binary
+  // 一个子走法：move 为一元 op 或 UNARY_OPS + 二元 op，j < 0 表示一元
+  struct Move {
+    int score = 0;
+    int key = 0; // 走法类（见 ValueClass）
+    int move = 0, i = 0, j = -1;
+    Node node;
+  };
+  struct Frame {
+    vector<Node> cur;
+    int stage = ST_UNARY;
+    int i = 0, j = 1, op = 0;
+    vector<Node> rest; // 当前 (i,j) 之外的元素
+    unordered_set<string> pair_seen;
+    size_t pair_bytes = 0; // pair_seen 的估算占用，出栈时从 mem_pairs 扣除
+    // 排序模式：第一次取子状态时生成全部走法并排好序，之后按 next 依次取
+    bool ordered = false;
+    vector<Move> moves;
+    size_t next = 0;
+  };
+  vector<Frame> stack;
+  long long states = 0; // 本次求解访问过的状态数
+
+  // 进入一个状态：叶子直接判定，否则压栈等待展开
+  void enter(vector<Node> &&cur);
+
+  // 目标导向的静态分（按结果的值类），单位同 history 中一次剩 4 个数的奖励
+  static int class_bonus(int vc);
+
+  // 排序模式：用 next_move 生成 f 的全部走法并打分，killer 最前，其余按
+  // history + 静态分从高到低（同分保持 DFS 的固定顺序）
+  void order_moves(Frame &f);
+
+  // 找到解时奖励栈上各层正在走的走法（即解的路径）
+  void reward_path();
+
+  // 取出 f 的下一个子状态；f 已展开完毕时返回 false
+  bool next_child(Frame &f, vector<Node> &child);
+
+  // 按固定顺序取出 f 的下一个走法（先各元素的一元函数，再按下标的数对与
+  // 二元走法）；二元走法的其余元素留在 f.rest。f 已展开完毕时返回 false
+  bool next_move(Frame &f, Move &m);
+
+  // 推进搜索：最多访问 max_states 个状态或运行 max_us 微秒（<=0 表示不限）。
+  // 搜索结束返回 true，被挂起返回 false，之后可再次调用继续。
+  bool step(long long max_states = 0, long long max_us = 0);
+
+  // 进度估计：按各层游标位置加权（根层权重最大），范围 [0,1]
+  double progress() const;
+
+  void clear_stack();
+
+  void dfs(vector<Node> cur);
+
+  // ========== 代价估计（Knuth 随机探测） ==========
+  // 每次探测从根出发，在每一层用 next_child 数出全部子状态个数 d，等概率
+  // 选一个走下去，直到叶子（find-first 时到 solve_last 接管的 <=3 个数）；
+  // 1 + d1 + d1*d2 + ... 是搜索树结点数的无偏估计，多次探测取平均。
+  // 记忆化使同一状态只展开一次：按不同顺序做同一批运算得到的是同一状态，
+  // 把每层的贡献除以到达它的运算顺序数（merge_orders），估计的就是
+  // 不同状态展开的子状态总数，即 states 计数器的值。
+  // 单次探测只展开一条路径，代价远小于真正搜索。会清空本 Solver 上次的结果。
+  // 得到状态 cur 的运算顺序数：把所有运算看成一片森林（子结点先于父结点），
+  // 拓扑序个数为 k! / ∏(各运算子树中的运算个数)，k 为运算总数
+  static double merge_orders(const vector<Node> &cur);
+
+  CostEstimate estimate_cost(const vector<Node> &input, bool findFirstOnly,
+                             int samples, uint64_t seed = 1);
+
+  // 输入数字 -> Node
+  static vector<Node> parse_nodes_from_line(const SolverConfig &cfg,
+                                            const string &line);
+
+  // 目标列表："10 24 36"、"1-100" 或混用（空格/逗号分隔），只接受正整数；
+  // 去重并保持首次出现的顺序，格式错误或超过 max_count 个时返回 false
+  static bool parse_targets(const SolverConfig &cfg, const string &text,
+                            vector<long long> &out, size_t max_count = 10000);
+
+  // 整数 -> 初始 Node 列表；有数字被剪枝（如负数）时返回 false
+  static bool nodes_from_values(const SolverConfig &cfg,
+                                const vector<long long> &nums,
+                                vector<Node> &out);
+
+  // 求解接口
+  bool solve_first(const vector<long long> &nums, vector<string> &out_expr);
+
+  // 分步求解：begin 之后反复调用 step 直到返回 true，最后 finish
+  // print=false 时不即时输出，结果全部留在 best_exprs 中
+  void begin(const vector<Node> &input, bool findFirstOnly,
+             bool print = true);
+
+  // 多目标分步求解：结果按目标分组留在 targets 中，不即时输出
+  void begin_targets(const vector<Node> &input, const vector<long long> &ts,
+                     bool findFirstOnly);
+
+  void reset(const vector<Node> &input, bool findFirstOnly, bool print);
+
+  void finish();
+
+  void solve_all_or_first_normal(const vector<Node> &input,
+                                 bool findFirstOnly);
+};
+
+// ======================= 出题：保证有解 + 难度分档 =======================
+// 难度由三部分组成（0~100）：解的个数越少越难、最简解代价越高越难、
+// 所有解都必须用到除法/函数时更难。候选题目用拒绝采样产生：先做有状态预算的
+// find-first 存在性检查（超预算直接丢弃），只有需要分档时才做有预算的全解评级；
+// 评级结果按（参数 + 排序后的数字）缓存，重复抽到的组合直接查表。
+enum OpClass { OC_ADDSUB = 1, OC_MUL = 2, OC_DIV = 4, OC_FUNC = 8 };
+enum { BAND_ANY = -1, BAND_EASY, BAND_MEDIUM, BAND_HARD, BAND_EXPERT, BAND_CNT };
+static const char *const BAND_NAMES[BAND_CNT] = {"简单", "中等", "困难", "极难"};
+
+// 单个表达式的运算类别与代价（见 OpInfo::cost）
+unsigned expr_op_classes(const vector<string> &expr);
+int expr_cost(const vector<string> &expr);
+
+struct PuzzleRating {
+  bool solvable = false;
+  bool rated = false;     // 是否做过全解评级（仅存在性检查时为 false）
+  bool complete = false;  // 评级搜索是否在预算内跑完（否则 solutions 为下界）
+  int solutions = 0;      // 不同（归一化后）解的个数
+  int min_cost = 0;       // 最简解代价
+  unsigned required = 0;  // 所有解都用到的运算类别
+  int difficulty = 0;     // 0~100
+  int band = BAND_EASY;
+  vector<string> simplest; // 最简解（RPN）
+};
+
+struct PuzzleGenerator {
+  static const size_t MAX_CACHE = 50000;
+  static const int SOLUTION_CAP = 64;
+  static const long long RATE_SLICE = 2000;
+  long long exist_budget = 20000; // 存在性检查的状态预算
+  long long rate_budget = 30000;  // 评级（全解）的状态预算
+
+  Solver solver;
+  // 抽题用的随机数引擎（定义在 hegel_core.cpp，头文件不引入 <random>）
+  struct Rng;
+  unique_ptr<Rng> rng;
+  unordered_map<string, PuzzleRating> cache;
+
+  PuzzleGenerator();
+  ~PuzzleGenerator();
+
+  static void score(PuzzleRating &r, int n);
+
+  // 评级；full=false 时只做存在性检查。超出存在性预算视为无解
+  PuzzleRating rate(vector<long long> nums, bool full);
+
+  // 生成 count 道 n 个数（取值 [lo,hi]）的题；band 为 BAND_ANY 时不限难度。
+  // 最多抽 max_attempts 组候选，结果可能少于 count。
+  vector<pair<vector<long long>, PuzzleRating>>
+  generate(int count, int n, int lo, int hi, int band, int max_attempts = 0);
+};
+
+// ======================= 可达表：子多重集的全部可达值 =======================
+// reach(S)：多重集 S 中的数字（各用一次）能组成的全部 (值, 函数用量, 嵌套深度)，
+// 每项记录表达式棵数（+、* 交换视为同一棵）与一个示例表达式。
+//   reach(S) = 一元闭包( ∪_{S = A ⊎ B} reach(A) 与 reach(B) 两两二元运算 )
+// 子多重集的可达表按多重集缓存，字典序相邻的多重集共享前缀，大部分子表直接复用。
+struct ReachEntry {
+  Node node;
+  unsigned long long count = 0;
+};
+typedef vector<ReachEntry> ReachSet;
+
+// 置换表中的一张子表：可达集及其按值索引（供顶层反解查找）
+struct ReachTable {
+  ReachSet set;
+  Solver::ValueIndex index;
+  size_t bytes = 0; // 估算内存，用于置换表限额
+};
+inline size_t value_bytes(const shared_ptr<const ReachTable> &t) {
+  return t->bytes;
+}
+struct ReachBuilder;
+shared_ptr<const ReachTable> reach_tt_get(ReachBuilder &rb,
+                                          const vector<long long> &ms);
+
+inline unsigned long long sat_add_u64(unsigned long long a,
+                                             unsigned long long b) {
+  return (a > ULLONG_MAX - b) ? ULLONG_MAX : a + b;
+}
+inline unsigned long long sat_mul_u64(unsigned long long a,
+                                             unsigned long long b) {
+  if (a != 0 && b > ULLONG_MAX / a)
+    return ULLONG_MAX;
+  return a * b;
+}
+inline int used_sum(const Node &nd) {
+  int s = 0;
+  for (int i = 0; i < F_CNT; i++)
+    s += nd.used[i];
+  return s;
+}
+
+struct ReachBuilder {
+  Solver ops; // 借用 Solver 的 try_* 运算（只读 ops.config，不触碰其状态）
+  unordered_map<string, shared_ptr<const ReachSet>> cache;
+  size_t cached_entries = 0;
+  size_t max_cached_entries = 4000000;
+  size_t pending_entries = 0; // 正在建的各表已有的项数（估算内存用）
+  bool use_tt = false; // 子表改用进程级置换表
+  // 非空且返回 true 时放弃建表（SolutionCounter 的时限、取消与内存预算）：
+  // 置 stopped，此后建出的表不完整，不进缓存与置换表
+  function<bool()> stop;
+  bool stopped = false;
+
+  explicit ReachBuilder(ConfigPtr config) { ops.config = std::move(config); }
+
+  static string multiset_key(const vector<long long> &ms);
+
+  bool halted();
+
+  // 构造期间的累加器：按 node_key 合并同一状态的棵数（键的取法同
+  // Solver::NodeSeen，小数不拼字符串）
+  struct Acc {
+    ReachSet out;
+    unordered_map<pair<long long, unsigned long long>, size_t,
+                  Solver::NodeSeen::Hash>
+        small;
+    unordered_map<string, size_t> big;
+    bool cat = false; // 同 Solver::node_key
+    void add(Node &&nd, unsigned long long cnt);
+  };
+
+  // a、b 的全部二元运算结果交给 emit(Node&&, 棵数)；comm/ord 为交换/非交换
+  // 运算的棵数
+  template <class Emit>
+  void combine(const ReachEntry &a, const ReachEntry &b,
+               unsigned long long comm, unsigned long long ord, Emit &emit);
+
+  // 一元闭包：一元运算使函数用量 +1，按用量分层处理，保证每项的棵数
+  // 在被展开前已累加完毕
+  void unary_closure(Acc &acc);
+
+  // 有序多重集 ms 的每个无序拆分 A ⊎ B（A、B 非空，A <= B）交给
+  // fn(A, B, A 与 B 是否为同一多重集)
+  template <class Fn>
+  static void for_each_split(const vector<long long> &ms, Fn fn);
+
+  // 对 |ms|>=2 的每个无序拆分 A ⊎ B，把 reach(A)、reach(B) 的二元运算结果
+  // 交给 emit（未做一元闭包）
+  template <class Emit>
+  void for_each_combo(const vector<long long> &ms, Emit &emit);
+
+  ReachSet build(const vector<long long> &ms);
+
+  // 顶层：不建表，逐个结果（及其一元链）判断是否等于目标。
+  // 返回到达目标的表达式棵数，witness 为其中一个（RPN）
+  unsigned long long count_target(const vector<long long> &ms,
+                                  vector<string> &witness);
+
+  // ms 须已排序
+  shared_ptr<const ReachSet> get(const vector<long long> &ms);
+};
+
+// ======================= 跨查询置换表 =======================
+// 键为（搜索参数, 排序后的子多重集），值为该子多重集的全部可达状态，每个
+// (值, 函数用量, 嵌套深度) 留一个见证表达式。可达集与目标无关，因此在同一
+// 进程内跨求解、跨目标共享（随机模式、出题、原生扩展的连续请求）。
+// 按估算字节数限额，超出时以 clock 策略整张淘汰子表。
+// 多个线程（不同配置的求解）共用一张表。表本身是 hegel_core.cpp 里的文件内
+// 静态变量，只能经下面的函数访问，它们在锁内查找与插入；建表本身不持锁，两个
+// 线程偶尔重复建同一张子表时保留先插入的。
+static const int REACH_TT_MAX_SUBSET = 3; // 只为不超过这么多个数的子多重集建表
+extern size_t REACH_TT_MAX_BYTES;
+
+shared_ptr<const ReachTable> reach_tt_get(ReachBuilder &rb,
+                                          const vector<long long> &ms);
+
+// 置换表中是否已有 ms 的子表（不建表）
+bool reach_tt_has(const SolverConfig &cfg, const vector<long long> &ms);
+
+// find_first 的快速路径：对输入的每个无序拆分 A ⊎ B，若两侧都不超过
+// REACH_TT_MAX_SUBSET 个数，就在两张子表上按 DFS 末步同样的方式反解目标。
+// 返回 1 有解（witness 为 RPN）、0 无解（全部拆分都已查表）、-1 需回退 DFS。
+int reach_tt_find_first(const ConfigPtr &config, const vector<long long> &nums,
+                        vector<string> &witness);
+
+// ======================= 解计数：不同解的个数（不生成表达式） =======================
+// 出题评级与统计只要“有多少个不同的解”，不必走 find-all 为每个解拼出 RPN：
+//   1. 为输入的每个真子多重集建可达表（不带 RPN）。表项是 (值, 函数用量,
+//      深度) 这样的子状态，同一子状态的各种写法只占一项；
+//   2. 顶层同 reach_tt_find_first：对每个拆分遍历较小一侧的表项，反解目标
+//      后到另一侧的值索引里查找，得到到达目标的全部推导（与 DFS 一样，最后
+//      一步总是二元运算）；
+//   3. 只展开这些推导用到的表项。一项的“形”是它能写成的各个不同规范形
+//      （Canon，与 find-all 去重用的相同），由它的推导（同样靠反解在子表中
+//      找出）中子项的形组合而来，按规范形去重后记在该项上复用。
+// 结果是顶层不同规范形的个数（“写法数”），同时按运算类别分别计数。它不是
+// find-all 的解数：find-all 的记忆化对值、函数用量、深度都相同的状态只展开
+// 一次，同值的另一种写法不会再组成新解，所以它报告的解数通常比写法数少
+// （3 3 8 8：116 对 178）。各前端因此把这个数叫 forms / 写法，不叫解数。
+enum CountClass {
+  CC_ADD, // + -（规范形把连续的加减看成一组，两者不分）
+  CC_MUL, // * /
+  CC_SQRT,
+  CC_FACT,
+  CC_LG,
+  CC_LB,
+  CC_LOG,
+  CC_POW,
+  CC_CAT,
+  CC_CNT
+};
+static const char *const COUNT_CLASS_NAMES[CC_CNT] = {
+    "+-", "*/", "sqrt", "!", "lg", "lb", "log", "^", "||"};
+inline unsigned short count_class_bit(int op) {
+  int c = (op == OP_ADD || op == OP_SUB)   ? CC_ADD
+          : (op == OP_MUL || op == OP_DIV) ? CC_MUL
+                                           : CC_SQRT + OPS[op].func;
+  return (unsigned short)(1u << c);
+}
+
+struct SolutionCount {
+  size_t forms = 0;                 // 到达目标的不同规范形（写法）个数
+  array<size_t, CC_CNT> by_class{}; // 用到各类运算的写法数
+  size_t states = 0;                // 可达表的项数（动态规划的子状态数）
+  size_t expanded = 0;              // 展开过规范形的表项数
+  long long us = 0;
+  // 被 stop 或时限打断 / 估算内存超出 memory_budget 而提前结束：以上计数
+  // 不完整，不应使用
+  bool stopped = false;
+  bool mem_truncated = false;
+};
+
+// 一个表项的一种写法：规范形、最后一步运算，以及用到的运算类别（同一
+// 规范形的各种写法取并）
+struct CountForm {
+  Canon canon;
+  unsigned char root = OP_LEAF;
+  unsigned short classes = 0;
+};
+
+struct SolutionCounter {
+  ReachBuilder rb; // rb.ops 只算值与规范形（keep_expr = false）
+
+  struct Table {
+    vector<long long> ms;
+    shared_ptr<const ReachSet> set;
+    Solver::ValueIndex index;
+    vector<vector<CountForm>> forms; // 按需展开
+    vector<char> expanded;
+  };
+  unordered_map<string, Table> tables;
+  size_t expanded = 0;
+  size_t form_count = 0; // 已记下的形总数（估算内存用）
+
+  // 非空且返回 true 时像到了时限一样提前结束（Node 扩展的 cancel 用）
+  function<bool()> stop;
+
+  explicit SolutionCounter(ConfigPtr config);
+
+  Table &table(const vector<long long> &ms);
+
+  static bool same_num(const Num &a, const Num &b);
+  // 同一子状态（同 node_key）
+  static bool same_state(const Node &a, const Node &b, bool cat);
+  static Solver::Want want_of(const Num &n);
+
+  // 多重集 ms 上由一步二元运算得到、值为 want 的结点：对每个拆分遍历较小
+  // 一侧的表项 X，反解出另一侧所需的 Y，复核后交给
+  // fn(C, X 所在表, X 的下标, Y 所在表, Y 的下标, try_binary 的 op)
+  template <class Fn>
+  void for_each_binary(const vector<long long> &ms, Solver::Want want, Fn fn);
+
+  // 按规范形去重的一组形
+  struct FormSet {
+    vector<CountForm> out;
+    unordered_map<uint64_t, size_t> pos;
+    void add(const CountForm &f);
+  };
+
+  // op(X, Y) 的各个形（op 为 try_binary 编号）
+  static void combine_forms(int op, const vector<CountForm> &fx,
+                            const vector<CountForm> &fy, FormSet &acc);
+
+  // 表项 T[idx] 的全部形：叶子本身，或由同表中的一项经一元运算、或由两张
+  // 子表中的项经二元运算得到（一元运算使函数用量增加，不会成环）
+  const vector<CountForm> &forms(Table &T, int idx);
+
+  // 估算内存：可达表（含正在建的）的项与已记下的形。每项按两倍大小计
+  // （vector 扩容的余量），另加建表时的去重表与计数时的值索引各一个哈希结点
+  size_t mem_used() const;
+
+  // 在 max_us 微秒内计数（<= 0 不限时），估算内存超出 config->memory_budget
+  // （0 不限）时也提前结束；提前结束时置 stopped 或 mem_truncated
+  SolutionCount count(vector<long long> nums, long long max_us = 0);
+
+private:
+  chrono::steady_clock::time_point t0;
+  long long max_us = 0;
+  size_t mem_budget = 0;
+  bool stopped = false, mem_truncated = false;
+
+  // 该不该提前结束（见 count），在建表与展开的循环里轮询
+  bool halted();
+};
+
+// ======================= 参数扫描：一次求解回答整张配置网格 =======================
+// 收紧嵌套深度或函数次数只会缩小可达集，所以一组配置（max_nest 与各函数
+// max_use 取值的网格，另加“只四则运算”一格，即基础配置加 only_arithmetic：
+// 一元函数关掉，log、^、|| 仍按基础配置的次数）的有解情况可以在最宽的一格下
+// 一次算出：顶层合并（同 reach_tt_find_first 在每个拆分的两张子表上反解
+// 目标）命中的每个结点的 (函数用量, 嵌套深度) 就是能写出这个解的最紧配置，
+// 某格有解当且仅当有一项的用量与深度都不超过这一格。可达项按 (值, 用量,
+// 深度) 合并，合并掉的写法用量与深度相同，不会漏掉更紧的解；每手牌只保留
+// 互不支配的 (用量, 深度)。子表放在进程级置换表里，各手之间复用。其余参数
+// （目标、MAX_ABS_VAL 等）各格相同，取基础配置。
+static const char *const SWEEP_DEFAULT_GRID = "nest=1-4 sqrt=0-2";
+
+struct SweepGrid {
+  vector<int> nest;              // max_nest 的取值，空表示沿用基础配置
+  array<vector<int>, F_CNT> use; // 各函数 max_use 的取值，空表示沿用基础配置
+
+  // "nest=1-4 sqrt=0-2 fact=0,1"：维名为 nest 或 FUNC_NAMES，取值为区间或
+  // 逗号分隔的列表（0~255）；格式错误或超过 max_cells 格时返回 false
+  static bool parse(const string &text, SweepGrid &out,
+                    size_t max_cells = 4096);
+  // 格数（不含只四则运算一格）
+  size_t cells() const;
+  // 第 idx 格的 max_nest 与 max_use：nest 变化最快，其次按 FUNC_NAMES 的顺序
+  void cell(const SolverConfig &base, size_t idx, int &nest,
+            array<int, F_CNT> &max_use) const;
+  // 最宽的一格：各维取最大值，允许函数；嵌套深度与二元函数次数不低于基础
+  // 配置（盖住只四则运算一格）
+  SolverConfig loosest(const SolverConfig &base) const;
+};
+
+struct SweepProfile {
+  array<unsigned char, F_CNT> used;
+  int depth = 0;
+  // 所需配置不比 o 宽（o 能写出的这里都能写）
+  bool within(const SweepProfile &o) const;
+};
+
+struct ConfigSweep {
+  ConfigPtr base;
+  SweepGrid grid;
+  ReachBuilder rb; // 最宽的一格，子表走置换表
+  // 各格的 (max_nest, max_use)，最后一格为只四则运算
+  vector<pair<int, array<int, F_CNT>>> params;
+  size_t hands = 0;
+  size_t loose_solvable = 0; // 最宽的一格下有解的手数
+  vector<size_t> solvable;   // 各格有解的手数，下标同 params
+
+  ConfigSweep(ConfigPtr base, const SweepGrid &grid);
+
+  bool arithmetic_cell(size_t k) const { return k + 1 == params.size(); }
+  // 一手牌互不支配的最紧配置，无解时为空。各格都已有解时提前结束，
+  // 这时不一定列全
+  vector<SweepProfile> profiles(vector<long long> nums);
+  bool admits(const vector<SweepProfile> &ps, size_t k) const;
+  bool admits_all(const vector<SweepProfile> &ps) const;
+  // 求一手并计入各格，返回它的最紧配置
+  vector<SweepProfile> add(const vector<long long> &nums);
+};
+
+// ======================= 答案校验：中缀解析与精确求值 =======================
+// 校验玩家输入的中缀式：先解析为 RPN（接受 rpn_to_infix 的全部写法，数字前
+// 可带负号），叶子须恰好用完题目的数字；再用 Solver 的 try_* 逐步精确求值，
+// 函数次数、嵌套深度、不许负数等限制与求解时一致，只是不做搜索用的冗余剪枝
+// （见 num_exact1 / num_exact2）。不用浮点，也不必重新求解。
+enum VerifyStatus {
+  VS_OK,      // 等于目标
+  VS_WRONG,   // 合法，但不等于目标
+  VS_SYNTAX,  // 无法解析
+  VS_NUMBERS, // 用到的数字与题目不符
+  VS_ILLEGAL, // 某一步不是整数（除不尽、开不尽等）或超出数值范围
+  VS_LIMIT,   // 超出函数次数、嵌套深度等限制
+  VS_CNT
+};
+static const char *const VERIFY_STATUS_NAMES[VS_CNT] = {
+    "ok", "wrong", "syntax", "numbers", "illegal", "limit"};
+static const char *const VERIFY_STATUS_TEXT[VS_CNT] = {
+    "正确", "结果不等于目标", "无法解析", "用到的数字与题目不符",
+    "有一步不是整数或超出数值范围", "超出函数次数或嵌套深度的限制"};
+
+struct VerifyResult {
+  VerifyStatus status = VS_SYNTAX;
+  int pos = -1;       // 出错处在原串中的字节偏移（语法错误或出错的那一步）
+  vector<string> rpn; // 解析出的 RPN（语法错误时为空）
+  Num value;          // 求值结果（VS_OK / VS_WRONG 时有效）
+};
+
+// 递归下降：expr = term {(+|-) term}，term = pow {(*|/) pow}，
+// pow = cat [^ pow]，cat = post {|| post}，post = atom {!}，
+// atom = [-]数字 | sqrt/lg/lb(expr) | log(expr, expr) | (expr)
+struct InfixParser {
+  const string &s;
+  size_t i = 0;
+  vector<string> rpn;
+  vector<int> at; // 每个记号在 s 中的偏移
+  int err = -1;
+
+  explicit InfixParser(const string &text) : s(text) {}
+
+  void skip();
+  bool peek(const char *t);
+  bool eat(const char *t);
+  void emit(string t, size_t p);
+  bool fail();
+
+  bool parse();
+  bool expr();
+  bool term();
+  bool power();
+  bool cat();
+  bool post();
+  bool atom();
+};
+
+// 同一配置下可连续校验多道题的多个答案，省去重复建立 Solver
+struct AnswerChecker {
+  Solver ops; // 借用 Solver 的 try_* 运算（只读 ops.config）
+
+  explicit AnswerChecker(ConfigPtr config);
+
+  // 解析 infix：成功时 r.rpn 为 RPN，at 为各记号在 infix 中的偏移，leaves
+  // 为排好序的叶子；失败时 r 为语法错误及其位置
+  static bool parse(const string &infix, VerifyResult &r, vector<int> &at,
+                    vector<long long> &leaves);
+
+  // 按 r.rpn 逐步求值，结果结点（ops.keep_expr 时带 RPN）放入 out；
+  // 某一步不合法时返回 false，r 为原因与该步的位置
+  bool evaluate(VerifyResult &r, const vector<int> &at, Node &out);
+
+  VerifyResult check(const vector<long long> &nums, const string &infix);
+};
+
+// 校验与提示模式的一行：“数字 | 式子 ; 式子 ...”（式子里的 || 不会与第一个
+// | 混淆：数字部分不含 |）。没有 | 时只有数字；数字部分格式错误时返回 false
+bool parse_verify_line(const string &line, vector<long long> &nums,
+                       vector<string> &exprs);
+
+// ======================= 提示：从玩家已做的部分续出最简解 =======================
+// 玩家已把一部分数字组成了式子（各式子用到的数字互不重叠），其余数字还没用。
+// 已做的式子按校验的规则求值为带 RPN 的 Node，与剩余数字一起作为初始状态交给
+// Solver。为了快，函数预算逐级放宽：第 k 级每种函数比已做部分多用至多 k 次、
+// 嵌套至多比已做部分深 k 层（第 0 级即只用四则运算），每级先用 find-first
+// 判断有没有解，第一个有解的级别再在 HINT_BUDGET_US 内求全部解，保留排名最前
+// 的 limit 个，所以提示优先给出函数用得最少的续法。同一状态的提示按（配置、
+// 已做部分、剩余数字、limit）缓存，玩家反复求提示时直接返回。
+// 放宽函数后全部解常要排几十毫秒，超出预算时求全部解的 Solver 挂起在原处：
+// 同样的请求再来时接着排，前端也可在空闲时调用 idle 排完（例如发牌后先求一次
+// 没有已做部分的提示，玩家真来要提示时就是排完的缓存）。排完才放进缓存。
+struct HintResult {
+  VerifyStatus status = VS_OK; // 已做部分的校验结论（VS_OK 表示都合法）
+  int part = -1;               // 出错的是第几个式子（从 0 起）
+  int pos = -1;                // 出错处在该式子中的字节偏移
+  int stage = -1;              // 在第几级找到续法（-1 为无解）
+  vector<vector<string>> completions; // 完整的解（RPN），排名从前到后
+  bool complete = false; // 排名是否比较了这一级的全部解（未超出时间预算）
+  bool cached = false;
+  long long us = 0;
+};
+
+struct HintEngine {
+  AnswerChecker checker; // 求值已做的部分（保留 RPN）
+  Solver solver;
+  unordered_map<string, ConfigPtr> stage_configs;
+  unordered_map<string, HintResult> cache;
+  size_t max_cache = 4096;
+  // 最近一次没排完的请求：ranker 挂起在它的全部解搜索中，rank_res 是已排出
+  // 的结果；rank_key 为空时没有
+  Solver ranker;
+  string rank_key;
+  HintResult rank_res;
+
+  explicit HintEngine(ConfigPtr config);
+
+  const ConfigPtr &config() const { return checker.ops.config; }
+  // 换配置时清空按配置缓存的内容
+  void set_config(ConfigPtr config);
+
+  // 第 k 级的配置：在已做部分的用量 used、深度 depth 之上放宽 k；
+  // 已放宽到原配置时 last 置为 true
+  ConfigPtr stage_config(int k, const array<unsigned char, F_CNT> &used,
+                         int depth, bool &last);
+
+  HintResult hint(const vector<long long> &nums, const vector<string> &parts,
+                  int limit);
+
+  // 接着排没排完的请求，至多 max_us 微秒（<= 0 时排完为止）；排完时放进
+  // 缓存。返回是否还有没排完的
+  bool idle(long long max_us);
+
+  // 推进 ranker 至多 max_us 微秒并更新 rank_res，返回它的副本
+  HintResult rank(long long max_us);
+};
+
+// ======================= 增量预求解：边输入数字边建子表 =======================
+// 网页上玩家逐个输入数字时，在空闲时间里把以后一定用得到的子表提前建进跨查询
+// 置换表（g_reach_tt），最后一个数字到来时只剩顶层的合并：
+//   1. 已输入数字的每个子多重集（不超过 hand_size - 1 个数）；
+//   2. 只差一个数字时，对猜测范围 [spec_lo, spec_hi] 内的每个取值 x，含 x 的
+//      子多重集（不超过 REACH_TT_MAX_SUBSET 个数），4 个数一手时即全部子表。
+// 子表以排好序的值多重集为键，删除或修改一个数字后，不含它的子表仍然有效，
+// 重排待建队列时已在表中的直接跳过，只有含新数字的子表需要新建。建表的粒度
+// 是一张子表，idle 在两张之间检查时间预算。
+struct ReachSession {
+  ConfigPtr config = default_config();
+  vector<long long> nums; // 已输入的数字（输入顺序）
+  int hand_size = 4;
+  long long spec_lo = 1, spec_hi = 13; // spec_lo > spec_hi 时不猜
+  vector<vector<long long>> pending;   // 待建子表，确定要用的在前
+  size_t next = 0;
+  bool dirty = true; // 数字、配置或猜测范围变了，需重排 pending
+  size_t built = 0;  // 累计新建的子表数
+
+  void set_config(ConfigPtr c);
+
+  // ms（已排序）的非空子多重集中不超过 max_size 个数、且 must 非空时含
+  // *must 的那些，追加到 out
+  static void submultisets(const vector<long long> &ms, size_t max_size,
+                           const long long *must,
+                           vector<vector<long long>> &out);
+
+  void plan();
+
+  // 在 max_us 微秒内按队列建子表（max_us <= 0 时建完为止），返回剩余待建数
+  size_t idle(long long max_us);
+
+  // 顶层合并：同 reach_tt_find_first 在每个拆分的两张子表上反解目标，但收集
+  // 全部命中，按解题模式的排名保留前 book.top_k 个。缺的子表（没猜中的数字、
+  // 5 个数一手里含新数字的 4 数子表等）此时补建，计入 built。返回是否有解
+  bool solve(Solver &book);
+};
+
+// ======================= 大题：束搜索（随时可停） =======================
+// 10~12 个数时穷举的 DFS 不可行。BeamSearch 只求尽快找到解，并在时限内不断
+// 改进：
+//   - 按层合并：每层挑两个数做一次二元运算，启发分最好的 width 个子状态进入
+//     下一层（按 equiv_key 去重）；剩 3 个数时交给 Solver::solve_last 精确
+//     收尾。运算、Num 与各项限制都同 Solver（借用它的 try_*）；
+//   - 启发分越小越好：各数中离目标最近者的 |log2|v| - log2 目标|（是目标的
+//     因数或倍数时减半），加上各数 log2(1 + |v|) 的均值乘 SPREAD（数小的
+//     状态更灵活）；
+//   - 第一轮操作数不套一元函数，通常几毫秒内给出第一个解；之后每轮束宽加倍
+//     （至多 max_width）、操作数取一元闭包，第三轮起打分加随机扰动（随机
+//     重启）。解按 rank_expr 从简到繁保留 limit 个；
+//   - 操作数取一元闭包的一轮若没有丢弃过任何子状态，就穷尽了与 DFS 相同的
+//     搜索空间：这时无解即真的无解，搜索提前结束。
+struct BeamResult {
+  vector<vector<string>> solutions; // RPN，按 rank_expr 从简到繁
+  size_t found = 0;                 // 找到的不同写法总数（可能多于 limit）
+  bool exhausted = false; // 穷尽了搜索空间（无解即真的无解）
+  int rounds = 0;         // 跑完的轮数
+  size_t width = 0;       // 最后一轮的束宽
+  long long states = 0;   // 展开与收尾的状态数
+  long long first_us = -1; // 找到第一个解的用时（没找到为 -1）
+  long long us = 0;
+};
+
+struct BeamSearch {
+  static constexpr double SPREAD = 0.25;
+  static constexpr double NOISE = 0.5; // 随机扰动的幅度（log2 单位）
+
+  Solver solver; // 借用 try_* 与 solve_last
+  size_t width = BEAM_WIDTH;
+  size_t max_width = BEAM_MAX_WIDTH;
+  uint64_t seed = 0; // 随机扰动的种子，同一种子结果可复现
+  // 非空且返回 true 时像到了时限一样提前结束（Node 扩展的 cancel 用）
+  function<bool()> stop;
+
+  explicit BeamSearch(ConfigPtr config) { solver.config = std::move(config); }
+
+  // 在 max_us 微秒内搜索（<= 0 时束宽加倍到 max_width 的那一轮跑完即止），
+  // 保留排名最前的 limit 个解（0 不限）
+  BeamResult run(const vector<Node> &input, long long max_us, size_t limit);
+
+private:
+  // 收集解：按 RPN 去重，超出 limit 时丢掉排名最差的
+  struct Run {
+    BeamResult &res;
+    size_t limit;
+    unordered_set<string> seen;
+    chrono::steady_clock::time_point t0;
+    vector<pair<AnswerRank, vector<string>>> best; // 按排名从简到繁
+  };
+
+  void finish_state(const vector<Node> &cur, Run &run);
+
+  // 一个数的启发分与大小项（见上）
+  double value_score(const Num &v) const;
+  static double value_size(const Num &v);
+
+  struct Cand {
+    double score;
+    uint64_t key;
+    int parent, i, j;
+    Node node;
+  };
+
+  // 一层：展开 level 的每个状态，保留启发分最好的 w 个不同的子状态。
+  // 有不同的子状态没能留下时置 truncated
+  template <class OutOfTime>
+  vector<vector<Node>> expand(const vector<vector<Node>> &level, size_t w,
+                              bool closure, double noise, uint64_t salt,
+                              bool &truncated, BeamResult &res,
+                              OutOfTime &out_of_time);
+};
+
+#endif // HEGEL_CORE_H
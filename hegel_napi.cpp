@@ -0,0 +1,464 @@
+// Node.js 原生扩展（N-API）：在 libuv 线程池中调用求解核心，
+// 供 server.js 进程内求解，替代 spawn "Hegel Infix.exe" 再解析 stdout。
+//
+// JS 接口：
+//   const p = addon.solve([3, 3, 8, 8], { target: 24, limit: 200 });
+//   p.cancel();            // 可选：取消，promise 以 ECANCELLED 拒绝
+//   const { found, solutions, count, states, tookMs, peakBytes, truncated } =
+//       await p;
+//
+// options: target, maxNest, maxUse { sqrt, fact, lg, lb, log, pow, cat },
+//          noNegative, onlyArithmetic, maxAbsVal, maxExpSum, maxFactArg,
+//          findFirst, limit, timeoutMs,
+//          memoryBudget（字节，超出时淘汰记忆化表，仍不够则提前结束并置 truncated）,
+//          countDistinct（默认 true：count 为见过的不同解总数，而不只是返回的
+//          limit 个；solutions 为排名最前的 limit 个）
+//
+//   const est = await addon.estimate([1, 2, 3, 4, 5, 6, 7, 8], { samples: 32 });
+//   // { findFirst, states, tree, relErr, numbers, maxAbs, funcBudget,
+//   //   samples, probeUs }
+// estimate 只做 Knuth 随机探测估计搜索量（见 Solver::estimate_cost），不求解，
+// options 与 solve 相同（findFirst 决定按哪种模式估计），另可给 samples。
+// 调用方据此决定排队、降级为 findFirst 或拒绝，而不是等超时。
+//
+//   const c = await addon.count([3, 3, 8, 8], { target: 24 });
+//   // { forms, byClass: { "+-", "*/", sqrt, "!", lg, lb, log, "^", "||" },
+//   //   states, expanded, us }
+// count 用子集动态规划统计到达目标的不同规范形（写法）个数，不列出解（见
+// SolutionCounter；通常多于 solve 的解数，所以叫 forms 不叫 solutions），options 同 solve（limit、findFirst 等无效）。计数的量随
+// 数字个数急剧增长（6 个数十几秒，7 个数以上往往跑不完），中途数不出部分
+// 结果：cancel 以 ECANCELLED 拒绝；超过 timeoutMs（默认 COUNT_BUDGET_US）以
+// ETIMEDOUT 拒绝；估算内存超过 memoryBudget 以 EINVAL 拒绝。
+//
+//   const b = await addon.beam([1, 2, 3, 4, 5, 6, 7, 8, 9, 10], { timeoutMs: 1000 });
+//   // { found, solutions, count, states, tookMs, exhausted, rounds, firstMs }
+// beam 用束搜索求穷举跑不动的大题（见 BeamSearch）：timeoutMs 是搜索的时限
+// （默认 BEAM_BUDGET_US），到时返回已找到的解而不是报超时；solutions 为排名
+// 最前的 limit 个，exhausted 为真时无解即真的无解，firstMs 为找到第一个解的
+// 用时（没找到为 -1）。
+//
+// 每个请求各自建一份 SolverConfig，不同参数的请求可以在线程池中同时求解。
+#include "hegel_core.h"
+
+#include <atomic>
+#include <memory>
+#include <node_api.h>
+
+namespace {
+
+// 每次 step 的时间片（微秒），两次之间检查取消 / 超时
+const long long STEP_US = 10000;
+
+struct SolveOptions {
+  SolverConfig config; // 默认为源码中的默认参数，派生数据在 execute 中计算
+  bool find_first = false;
+  int limit = 0;
+  long long timeout_ms = 0;
+  bool count_distinct = true;
+  int samples = ESTIMATE_SAMPLES; // 只用于 estimate
+};
+
+enum TaskStatus { TS_OK, TS_ERROR, TS_CANCELLED, TS_TIMEOUT };
+
+enum TaskKind {
+  TK_SOLVE,    // solve()
+  TK_ESTIMATE, // estimate()：只估计代价，结果在 cost 中
+  TK_COUNT,    // count()：只计数，结果在 tally 中
+  TK_BEAM      // beam()：束搜索，结果同 solve 另加 beam
+};
+
+struct SolveTask {
+  vector<long long> numbers;
+  SolveOptions opt;
+  TaskKind kind = TK_SOLVE;
+  atomic<bool> cancelled{false};
+  napi_async_work work = nullptr;
+  napi_deferred deferred = nullptr;
+
+  TaskStatus status = TS_OK;
+  string error;
+  bool found = false;
+  bool truncated = false;
+  long long states = 0;
+  size_t peak_bytes = 0;
+  double took_ms = 0;
+  size_t count = 0;
+  vector<pair<string, vector<string>>> solutions; // infix, rpn
+  CostEstimate cost;
+  SolutionCount tally;
+  BeamResult beam;
+};
+
+// ---------------- N-API 小工具 ----------------
+bool get_prop(napi_env env, napi_value obj, const char *name,
+              napi_value &out) {
+  bool has = false;
+  if (napi_has_named_property(env, obj, name, &has) != napi_ok || !has)
+    return false;
+  if (napi_get_named_property(env, obj, name, &out) != napi_ok)
+    return false;
+  napi_valuetype t;
+  napi_typeof(env, out, &t);
+  return t != napi_undefined && t != napi_null;
+}
+void read_int(napi_env env, napi_value obj, const char *name, int &out) {
+  napi_value v;
+  if (!get_prop(env, obj, name, v))
+    return;
+  int32_t x;
+  if (napi_get_value_int32(env, v, &x) == napi_ok)
+    out = x;
+}
+void read_int64(napi_env env, napi_value obj, const char *name,
+                long long &out) {
+  napi_value v;
+  if (!get_prop(env, obj, name, v))
+    return;
+  int64_t x;
+  if (napi_get_value_int64(env, v, &x) == napi_ok)
+    out = x;
+}
+void read_bool(napi_env env, napi_value obj, const char *name, bool &out) {
+  napi_value v;
+  if (!get_prop(env, obj, name, v))
+    return;
+  bool x;
+  if (napi_get_value_bool(env, v, &x) == napi_ok)
+    out = x;
+}
+napi_value make_string(napi_env env, const string &s) {
+  napi_value v;
+  napi_create_string_utf8(env, s.data(), s.size(), &v);
+  return v;
+}
+napi_value make_error(napi_env env, const char *code, const string &msg) {
+  napi_value err;
+  napi_create_error(env, make_string(env, code), make_string(env, msg), &err);
+  return err;
+}
+napi_value throw_type_error(napi_env env, const char *msg) {
+  napi_throw_type_error(env, nullptr, msg);
+  return nullptr;
+}
+
+void read_options(napi_env env, napi_value obj, SolveOptions &o) {
+  SolverConfig &c = o.config;
+  read_int(env, obj, "target", c.target);
+  read_int(env, obj, "maxNest", c.max_nest);
+  napi_value mu;
+  if (get_prop(env, obj, "maxUse", mu)) {
+    read_int(env, mu, "sqrt", c.max_use[F_SQRT]);
+    read_int(env, mu, "fact", c.max_use[F_FACT]);
+    read_int(env, mu, "lg", c.max_use[F_LG]);
+    read_int(env, mu, "lb", c.max_use[F_LB]);
+    read_int(env, mu, "log", c.max_use[F_LOG]);
+    read_int(env, mu, "pow", c.max_use[F_POW]);
+    read_int(env, mu, "cat", c.max_use[F_CAT]);
+  }
+  read_bool(env, obj, "noNegative", c.no_negative);
+  read_bool(env, obj, "onlyArithmetic", c.only_arithmetic);
+  read_int64(env, obj, "maxAbsVal", c.max_abs_val);
+  read_int(env, obj, "maxExpSum", c.max_exp_sum);
+  read_int(env, obj, "maxFactArg", c.max_fact_arg);
+  long long budget = 0;
+  read_int64(env, obj, "memoryBudget", budget);
+  c.memory_budget = budget > 0 ? (size_t)budget : 0;
+  read_bool(env, obj, "findFirst", o.find_first);
+  read_int(env, obj, "limit", o.limit);
+  read_int64(env, obj, "timeoutMs", o.timeout_ms);
+  read_bool(env, obj, "countDistinct", o.count_distinct);
+  read_int(env, obj, "samples", o.samples);
+  o.samples = max(1, min(o.samples, 4096));
+}
+
+// ---------------- 线程池中执行 ----------------
+void execute(napi_env, void *data) {
+  SolveTask &t = **static_cast<shared_ptr<SolveTask> *>(data);
+  if (t.cancelled) {
+    t.status = TS_CANCELLED;
+    return;
+  }
+
+  const SolveOptions &o = t.opt;
+  ConfigPtr config = make_config(o.config);
+
+  vector<Node> input;
+  if (!Solver::nodes_from_values(*config, t.numbers, input)) {
+    t.status = TS_ERROR;
+    t.error = "invalid numbers";
+    return;
+  }
+
+  using clk = chrono::steady_clock;
+  const clk::time_point t0 = clk::now();
+  Solver solver;
+  solver.config = config;
+  if (t.kind == TK_ESTIMATE) {
+    t.cost = solver.estimate_cost(input, o.find_first, o.samples);
+    return;
+  }
+  if (t.kind == TK_COUNT) {
+    SolutionCounter counter(config);
+    counter.stop = [&t] { return t.cancelled.load(); };
+    t.tally = counter.count(t.numbers, o.timeout_ms > 0 ? o.timeout_ms * 1000
+                                                        : COUNT_BUDGET_US);
+    if (t.cancelled) {
+      t.status = TS_CANCELLED;
+    } else if (t.tally.mem_truncated) {
+      t.status = TS_ERROR;
+      t.error = "memory budget exceeded";
+    } else if (t.tally.stopped) {
+      t.status = TS_TIMEOUT;
+    }
+    return;
+  }
+  if (t.kind == TK_BEAM) {
+    BeamSearch search(config);
+    search.stop = [&t] { return t.cancelled.load(); };
+    t.beam = search.run(input,
+                        o.timeout_ms > 0 ? o.timeout_ms * 1000 : BEAM_BUDGET_US,
+                        o.limit > 0 ? (size_t)o.limit : 0);
+    if (t.cancelled) {
+      t.status = TS_CANCELLED;
+      return;
+    }
+    t.found = t.beam.found > 0;
+    t.states = t.beam.states;
+    t.count = t.beam.found;
+    for (const vector<string> &e : t.beam.solutions)
+      t.solutions.emplace_back(rpn_to_infix(e), e);
+    t.took_ms = chrono::duration<double, milli>(clk::now() - t0).count();
+    return;
+  }
+  solver.top_k = o.limit > 0 ? (size_t)o.limit : 0;
+  solver.count_distinct = o.count_distinct;
+  solver.begin(input, o.find_first, false);
+  while (!solver.step(0, STEP_US)) {
+    if (t.cancelled) {
+      t.status = TS_CANCELLED;
+      return;
+    }
+    if (o.timeout_ms > 0 &&
+        chrono::duration_cast<chrono::milliseconds>(clk::now() - t0)
+                .count() >= o.timeout_ms) {
+      t.status = TS_TIMEOUT;
+      return;
+    }
+  }
+  solver.finish();
+
+  t.found = solver.found;
+  t.truncated = solver.mem_truncated;
+  t.states = solver.states;
+  t.peak_bytes = solver.mem_peak;
+  t.count = solver.distinct_count();
+  for (const vector<string> *e : solver.ranked())
+    t.solutions.emplace_back(rpn_to_infix(*e), *e);
+  t.took_ms =
+      chrono::duration<double, milli>(clk::now() - t0).count();
+}
+
+// ---------------- 回到 JS 线程 ----------------
+void complete(napi_env env, napi_status, void *data) {
+  auto *holder = static_cast<shared_ptr<SolveTask> *>(data);
+  SolveTask &t = **holder;
+
+  if (t.status == TS_OK && t.kind == TK_ESTIMATE) {
+    const CostEstimate &e = t.cost;
+    napi_value res, v;
+    napi_create_object(env, &res);
+    napi_get_boolean(env, e.find_first, &v);
+    napi_set_named_property(env, res, "findFirst", v);
+    const pair<const char *, double> nums[] = {
+        {"states", e.states},
+        {"tree", e.tree},
+        {"relErr", e.rel_err},
+        {"numbers", (double)e.numbers},
+        {"maxAbs", e.max_abs},
+        {"funcBudget", (double)e.func_budget},
+        {"samples", (double)e.samples},
+        {"probeUs", (double)e.probe_us}};
+    for (const auto &kv : nums) {
+      napi_create_double(env, kv.second, &v);
+      napi_set_named_property(env, res, kv.first, v);
+    }
+    napi_resolve_deferred(env, t.deferred, res);
+  } else if (t.status == TS_OK && t.kind == TK_COUNT) {
+    const SolutionCount &c = t.tally;
+    napi_value res, by, v;
+    napi_create_object(env, &res);
+    napi_create_object(env, &by);
+    for (int k = 0; k < CC_CNT; k++) {
+      napi_create_double(env, (double)c.by_class[k], &v);
+      napi_set_named_property(env, by, COUNT_CLASS_NAMES[k], v);
+    }
+    napi_set_named_property(env, res, "byClass", by);
+    const pair<const char *, double> nums[] = {
+        {"forms", (double)c.forms},
+        {"states", (double)c.states},
+        {"expanded", (double)c.expanded},
+        {"us", (double)c.us}};
+    for (const auto &kv : nums) {
+      napi_create_double(env, kv.second, &v);
+      napi_set_named_property(env, res, kv.first, v);
+    }
+    napi_resolve_deferred(env, t.deferred, res);
+  } else if (t.status == TS_OK) {
+    napi_value res, sols;
+    napi_create_object(env, &res);
+    napi_create_array_with_length(env, t.solutions.size(), &sols);
+    for (size_t i = 0; i < t.solutions.size(); i++) {
+      napi_value item, rpn;
+      napi_create_object(env, &item);
+      napi_set_named_property(env, item, "infix",
+                              make_string(env, t.solutions[i].first));
+      const vector<string> &toks = t.solutions[i].second;
+      napi_create_array_with_length(env, toks.size(), &rpn);
+      for (size_t k = 0; k < toks.size(); k++)
+        napi_set_element(env, rpn, (uint32_t)k, make_string(env, toks[k]));
+      napi_set_named_property(env, item, "rpn", rpn);
+      napi_set_element(env, sols, (uint32_t)i, item);
+    }
+    napi_value found, count, states, took, peak, truncated;
+    napi_get_boolean(env, t.found, &found);
+    napi_get_boolean(env, t.truncated, &truncated);
+    napi_create_double(env, (double)t.peak_bytes, &peak);
+    napi_create_double(env, (double)t.count, &count);
+    napi_create_int64(env, t.states, &states);
+    napi_create_double(env, t.took_ms, &took);
+    napi_set_named_property(env, res, "found", found);
+    napi_set_named_property(env, res, "solutions", sols);
+    napi_set_named_property(env, res, "count", count);
+    napi_set_named_property(env, res, "states", states);
+    napi_set_named_property(env, res, "tookMs", took);
+    napi_set_named_property(env, res, "peakBytes", peak);
+    napi_set_named_property(env, res, "truncated", truncated);
+    if (t.kind == TK_BEAM) {
+      napi_value v;
+      napi_get_boolean(env, t.beam.exhausted, &v);
+      napi_set_named_property(env, res, "exhausted", v);
+      napi_create_int32(env, t.beam.rounds, &v);
+      napi_set_named_property(env, res, "rounds", v);
+      napi_create_double(env,
+                         t.beam.first_us < 0 ? -1 : t.beam.first_us / 1000.0,
+                         &v);
+      napi_set_named_property(env, res, "firstMs", v);
+    }
+    napi_resolve_deferred(env, t.deferred, res);
+  } else if (t.status == TS_CANCELLED) {
+    napi_reject_deferred(env, t.deferred,
+                         make_error(env, "ECANCELLED", "cancelled"));
+  } else if (t.status == TS_TIMEOUT) {
+    napi_reject_deferred(env, t.deferred,
+                         make_error(env, "ETIMEDOUT", "timeout"));
+  } else {
+    napi_reject_deferred(env, t.deferred, make_error(env, "EINVAL", t.error));
+  }
+
+  napi_delete_async_work(env, t.work);
+  delete holder;
+}
+
+napi_value cancel(napi_env env, napi_callback_info info) {
+  void *data = nullptr;
+  napi_get_cb_info(env, info, nullptr, nullptr, nullptr, &data);
+  (*static_cast<shared_ptr<SolveTask> *>(data))->cancelled = true;
+  return nullptr;
+}
+
+void release_task(napi_env, void *data, void *) {
+  delete static_cast<shared_ptr<SolveTask> *>(data);
+}
+
+// solve / estimate / count / beam 共用：解析参数并排入线程池，返回附带 cancel 方法
+// 的 Promise
+napi_value queue_task(napi_env env, napi_callback_info info, TaskKind kind) {
+  size_t argc = 2;
+  napi_value argv[2];
+  napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr);
+  if (argc < 1)
+    return throw_type_error(env, "numbers must be an array");
+  bool is_array = false;
+  napi_is_array(env, argv[0], &is_array);
+  if (!is_array)
+    return throw_type_error(env, "numbers must be an array");
+
+  auto task = make_shared<SolveTask>();
+  task->kind = kind;
+  uint32_t len = 0;
+  napi_get_array_length(env, argv[0], &len);
+  for (uint32_t i = 0; i < len; i++) {
+    napi_value v;
+    int64_t x;
+    napi_get_element(env, argv[0], i, &v);
+    if (napi_get_value_int64(env, v, &x) != napi_ok)
+      return throw_type_error(env, "numbers must be integers");
+    task->numbers.push_back(x);
+  }
+  if (task->numbers.empty())
+    return throw_type_error(env, "numbers must not be empty");
+
+  if (argc >= 2) {
+    napi_valuetype t;
+    napi_typeof(env, argv[1], &t);
+    if (t == napi_object)
+      read_options(env, argv[1], task->opt);
+  }
+
+  napi_value promise;
+  napi_create_promise(env, &task->deferred, &promise);
+
+  napi_value cancel_fn;
+  auto *cancel_holder = new shared_ptr<SolveTask>(task);
+  napi_create_function(env, "cancel", NAPI_AUTO_LENGTH, cancel, cancel_holder,
+                       &cancel_fn);
+  napi_add_finalizer(env, cancel_fn, cancel_holder, release_task, nullptr,
+                     nullptr);
+  napi_set_named_property(env, promise, "cancel", cancel_fn);
+
+  auto *work_holder = new shared_ptr<SolveTask>(task);
+  static const char *const names[] = {"hegel.solve", "hegel.estimate",
+                                      "hegel.count", "hegel.beam"};
+  napi_create_async_work(env, nullptr, make_string(env, names[kind]), execute,
+                         complete, work_holder, &task->work);
+  napi_queue_async_work(env, task->work);
+  return promise;
+}
+
+// solve(numbers, options) -> Promise（附带 cancel 方法）
+napi_value solve(napi_env env, napi_callback_info info) {
+  return queue_task(env, info, TK_SOLVE);
+}
+
+// estimate(numbers, options) -> Promise（附带 cancel 方法）
+napi_value estimate(napi_env env, napi_callback_info info) {
+  return queue_task(env, info, TK_ESTIMATE);
+}
+
+// count(numbers, options) -> Promise（附带 cancel 方法）
+napi_value count(napi_env env, napi_callback_info info) {
+  return queue_task(env, info, TK_COUNT);
+}
+
+// beam(numbers, options) -> Promise（附带 cancel 方法）
+napi_value beam(napi_env env, napi_callback_info info) {
+  return queue_task(env, info, TK_BEAM);
+}
+
+napi_value init(napi_env env, napi_value exports) {
+  napi_value fn;
+  napi_create_function(env, "solve", NAPI_AUTO_LENGTH, solve, nullptr, &fn);
+  napi_set_named_property(env, exports, "solve", fn);
+  napi_create_function(env, "estimate", NAPI_AUTO_LENGTH, estimate, nullptr,
+                       &fn);
+  napi_set_named_property(env, exports, "estimate", fn);
+  napi_create_function(env, "count", NAPI_AUTO_LENGTH, count, nullptr, &fn);
+  napi_set_named_property(env, exports, "count", fn);
+  napi_create_function(env, "beam", NAPI_AUTO_LENGTH, beam, nullptr, &fn);
+  napi_set_named_property(env, exports, "beam", fn);
+  return exports;
+}
+
+} // namespace
+
+NAPI_MODULE(NODE_GYP_MODULE_NAME, init)
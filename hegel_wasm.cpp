@@ -0,0 +1,471 @@
+// WebAssembly 前端：供网页经 cwrap 调用的导出函数，与 hegel_core.cpp 一起
+// 用 em++ 编译（见 WASM_BUILD.md）。只依赖核心库，不引入 iostream / sstream。
+#include "hegel_core.h"
+
+#include <cstdio>
+
+#include <emscripten/emscripten.h>
+
+static string g_wasm_output;
+static int g_wasm_limit = 0;
+static int g_wasm_count = 0;
+// 前端当前的配置：hegel_configure / hegel_set_memory_budget 换成新建的配置，
+// 之后开始的求解才使用它
+static ConfigPtr g_wasm_config = default_config();
+
+static void wasm_reset_output(int limit) {
+  g_wasm_output.clear();
+  g_wasm_limit = limit;
+  g_wasm_count = 0;
+}
+
+static void wasm_append_line(const string &line) {
+  if (g_wasm_limit > 0 && g_wasm_count >= g_wasm_limit)
+    return;
+  g_wasm_output += line;
+  g_wasm_output.push_back('\n');
+  g_wasm_count++;
+}
+
+// 浮点数按 6 位有效数字（同 printf 的 %g）
+static string wasm_g6(double v) {
+  char tmp[32];
+  snprintf(tmp, sizeof(tmp), "%.6g", v);
+  return tmp;
+}
+
+static void wasm_append_ranked(const Solver &solver) {
+  for (const vector<string> *e : solver.ranked())
+    wasm_append_line(rpn_to_infix(*e) + " = " +
+                     to_string(solver.config->target));
+}
+
+extern "C" {
+// 最近一次求解所用的 Solver，供 hegel_memory_peak / hegel_truncated /
+// hegel_near_misses 查询
+static const Solver *g_wasm_last = nullptr;
+// hegel_solve / hegel_begin 无解时记下的最接近的值的个数（0 不记）
+static int g_wasm_near_k = 0;
+
+EMSCRIPTEN_KEEPALIVE const char *hegel_solve(const char *line, int limit) {
+  static Solver solver;
+  g_wasm_last = &solver;
+  solver.config = g_wasm_config;
+  wasm_reset_output(limit);
+  if (!line || !*line)
+    return g_wasm_output.c_str();
+
+  vector<Node> input =
+      Solver::parse_nodes_from_line(*solver.config, string(line));
+  if (input.empty())
+    return g_wasm_output.c_str();
+
+  if (solver.config->no_negative) {
+    for (auto &nd : input) {
+      if (nd.num.has_ll && nd.num.ll < 0)
+        return g_wasm_output.c_str();
+    }
+  }
+
+  // 只保留排名最前的 limit 个解，结束后按排名输出
+  solver.top_k = limit > 0 ? (size_t)limit : 0;
+  solver.near.k = (size_t)g_wasm_near_k;
+  solver.begin(input, false, false);
+  solver.step();
+  solver.finish();
+  wasm_append_ranked(solver);
+  return g_wasm_output.c_str();
+}
+
+// 多目标求解：targets 形如 "10 24 36" 或 "1-100"。按目标分组输出，每组先是
+// "#目标|解数" 一行，随后最多 limit 行 "中缀 = 目标"；无解的目标解数为 0。
+// find_first 非 0 时每个目标只找一个解（解数为 0 或 1）。
+EMSCRIPTEN_KEEPALIVE const char *hegel_solve_targets(const char *line,
+                                                     const char *targets,
+                                                     int limit,
+                                                     int find_first) {
+  static Solver solver;
+  g_wasm_last = &solver;
+  solver.config = g_wasm_config;
+  g_wasm_output.clear();
+  if (!line || !targets)
+    return g_wasm_output.c_str();
+
+  const SolverConfig &cfg = *solver.config;
+  vector<long long> ts;
+  vector<Node> input = Solver::parse_nodes_from_line(cfg, string(line));
+  if (input.empty() || !Solver::parse_targets(cfg, string(targets), ts))
+    return g_wasm_output.c_str();
+
+  solver.top_k = limit > 0 ? (size_t)limit : 0;
+  solver.count_distinct = true; // 每组的解数仍为总数
+  solver.begin_targets(input, ts, find_first != 0);
+  solver.step();
+  solver.finish();
+  for (auto &h : solver.targets) {
+    string t = to_string(h.target);
+    g_wasm_output += "#" + t + "|" + to_string(h.distinct_count()) + "\n";
+    int n = 0;
+    for (const vector<string> *e : h.ranked()) {
+      if (limit > 0 && n++ >= limit)
+        break;
+      g_wasm_output += rpn_to_infix(*e) + " = " + t + "\n";
+    }
+  }
+  return g_wasm_output.c_str();
+}
+
+// 分步求解（协作式调度）：hegel_begin 初始化后，前端反复调用 hegel_step
+// 每次只推进一小段并让出主线程，返回 1 表示搜索结束；hegel_end 收尾并返回
+// 与 hegel_solve 相同格式的结果。分步求解期间调用 hegel_configure 不影响
+// 正在进行的求解（它持有 hegel_begin 时的配置）。
+static Solver g_step_solver;
+
+EMSCRIPTEN_KEEPALIVE int hegel_begin(const char *line, int limit) {
+  g_wasm_last = &g_step_solver;
+  wasm_reset_output(limit);
+  g_step_solver.clear_stack();
+  g_step_solver.config = g_wasm_config;
+  if (!line || !*line)
+    return 0;
+
+  vector<Node> input =
+      Solver::parse_nodes_from_line(*g_step_solver.config, string(line));
+  if (input.empty())
+    return 0;
+
+  if (g_step_solver.config->no_negative) {
+    for (auto &nd : input) {
+      if (nd.num.has_ll && nd.num.ll < 0)
+        return 0;
+    }
+  }
+
+  g_step_solver.top_k = limit > 0 ? (size_t)limit : 0;
+  g_step_solver.near.k = (size_t)g_wasm_near_k;
+  g_step_solver.begin(input, false, false);
+  return 1;
+}
+
+EMSCRIPTEN_KEEPALIVE int hegel_step(int max_states, int max_us) {
+  return g_step_solver.step(max_states, max_us) ? 1 : 0;
+}
+
+EMSCRIPTEN_KEEPALIVE double hegel_progress() {
+  return g_step_solver.progress();
+}
+
+EMSCRIPTEN_KEEPALIVE const char *hegel_end() {
+  g_step_solver.finish();
+  wasm_append_ranked(g_step_solver);
+  return g_wasm_output.c_str();
+}
+
+// 批量出题：每行一道题，格式为
+//   数字（空格分隔）|难度档|难度分|解数|最简解中缀
+// band 为 -1 时不限难度（不做评级，难度档/分/解数为 -1）。
+EMSCRIPTEN_KEEPALIVE const char *hegel_generate(int count, int n, int lo,
+                                                int hi, int band) {
+  static PuzzleGenerator generator;
+  generator.solver.config = g_wasm_config;
+  g_wasm_output.clear();
+  if (band < BAND_ANY || band >= BAND_CNT)
+    return g_wasm_output.c_str();
+  auto puzzles = generator.generate(count, n, lo, hi, band);
+  for (auto &pz : puzzles) {
+    const PuzzleRating &r = pz.second;
+    for (size_t i = 0; i < pz.first.size(); i++) {
+      if (i)
+        g_wasm_output.push_back(' ');
+      g_wasm_output += to_string(pz.first[i]);
+    }
+    g_wasm_output += "|" + to_string(r.rated ? r.band : -1);
+    g_wasm_output += "|" + to_string(r.rated ? r.difficulty : -1);
+    g_wasm_output += "|" + to_string(r.rated ? r.solutions : -1);
+    g_wasm_output += "|" + rpn_to_infix(r.simplest);
+    g_wasm_output.push_back('\n');
+  }
+  return g_wasm_output.c_str();
+}
+
+// 求解代价估计（不求解）：返回一行
+//   状态数|不计记忆化的树结点数|相对误差|数字个数|函数次数|探测微秒数
+// find_first 非 0 时按找一个解估计（为找不到解时的上界），samples <= 0 时
+// 用默认探测次数；输入不合法时返回空串。
+EMSCRIPTEN_KEEPALIVE const char *hegel_estimate(const char *line,
+                                                int find_first, int samples) {
+  static Solver solver;
+  solver.config = g_wasm_config;
+  g_wasm_output.clear();
+  if (!line)
+    return g_wasm_output.c_str();
+  vector<Node> input =
+      Solver::parse_nodes_from_line(*solver.config, string(line));
+  if (input.empty())
+    return g_wasm_output.c_str();
+  CostEstimate e = solver.estimate_cost(
+      input, find_first != 0, samples > 0 ? samples : ESTIMATE_SAMPLES);
+  g_wasm_output = wasm_g6(e.states) + "|" + wasm_g6(e.tree) + "|" +
+                  wasm_g6(e.rel_err) + "|" + to_string(e.numbers) + "|" +
+                  to_string(e.func_budget) + "|" + to_string(e.probe_us) + "\n";
+  return g_wasm_output.c_str();
+}
+
+// 解计数（不列出解）：返回一行
+//   写法数|各类运算的写法数（逗号分隔，顺序同 COUNT_CLASS_NAMES）|状态数|微秒数
+// 输入不合法时返回空串。
+EMSCRIPTEN_KEEPALIVE const char *hegel_count(const char *line) {
+  g_wasm_output.clear();
+  if (!line)
+    return g_wasm_output.c_str();
+  vector<Node> input =
+      Solver::parse_nodes_from_line(*g_wasm_config, string(line));
+  if (input.empty())
+    return g_wasm_output.c_str();
+  vector<long long> nums;
+  for (const Node &nd : input) {
+    long long x = 0;
+    try_parse_ll(nd.expr[0], x);
+    nums.push_back(x);
+  }
+  SolutionCounter counter(g_wasm_config);
+  SolutionCount c = counter.count(nums);
+  g_wasm_output = to_string(c.forms) + "|";
+  for (int k = 0; k < CC_CNT; k++)
+    g_wasm_output += (k ? "," : "") + to_string(c.by_class[k]);
+  g_wasm_output +=
+      "|" + to_string(c.states) + "|" + to_string(c.us) + "\n";
+  return g_wasm_output.c_str();
+}
+
+// 批量校验答案：每行“数字 | 式子”（多个式子用 ; 分隔，各行的题目可以不同），
+// 每个式子返回一行 状态|出错偏移|值，状态为 VERIFY_STATUS_NAMES 之一，偏移与
+// 值没有时为 -1 与空；格式错误的行返回一行 syntax|-1|
+EMSCRIPTEN_KEEPALIVE const char *hegel_verify(const char *text) {
+  static AnswerChecker checker(g_wasm_config);
+  checker.ops.config = g_wasm_config;
+  g_wasm_output.clear();
+  if (!text)
+    return g_wasm_output.c_str();
+  const string all(text);
+  vector<long long> nums;
+  vector<string> exprs;
+  for (size_t b = 0, e; b < all.size(); b = e + 1) {
+    e = all.find('\n', b);
+    if (e == string::npos)
+      e = all.size();
+    string line = all.substr(b, e - b);
+    if (line.find_first_not_of(" \t\r") == string::npos)
+      continue;
+    if (!parse_verify_line(line, nums, exprs) || exprs.empty()) {
+      g_wasm_output += "syntax|-1|\n";
+      continue;
+    }
+    for (const string &e : exprs) {
+      VerifyResult r = checker.check(nums, e);
+      g_wasm_output += VERIFY_STATUS_NAMES[r.status];
+      g_wasm_output += "|" + to_string(r.pos) + "|";
+      if ((r.status == VS_OK || r.status == VS_WRONG) && r.value.has_ll)
+        g_wasm_output += to_string(r.value.ll);
+      g_wasm_output.push_back('\n');
+    }
+  }
+  return g_wasm_output.c_str();
+}
+
+// 提示：line 为“数字 | 已做的部分 ; ...”（可以只有数字），返回首行
+//   状态|出错的式子序号|出错偏移|级别|是否排完|是否命中缓存|微秒数
+// 状态为 VERIFY_STATUS_NAMES 之一（ok 表示已做部分都合法），级别为 -1 时无解，
+// 未排完表示时间预算内没比较完这一级的全部解（可在空闲回调里调用
+// hegel_hint_idle 排完）；随后至多 limit 行 中缀 = 目标（limit <= 0 时用
+// HINT_LIMIT）。同一配置下反复求提示会命中缓存。
+static HintEngine g_hint_engine(g_wasm_config);
+
+EMSCRIPTEN_KEEPALIVE const char *hegel_hint(const char *line, int limit) {
+  HintEngine &engine = g_hint_engine;
+  engine.set_config(g_wasm_config);
+  g_wasm_output.clear();
+  vector<long long> nums;
+  vector<string> parts;
+  if (!line || !parse_verify_line(line, nums, parts) || nums.empty()) {
+    g_wasm_output = "syntax|-1|-1|-1|0|0|0\n";
+    return g_wasm_output.c_str();
+  }
+  HintResult h = engine.hint(nums, parts, limit > 0 ? limit : HINT_LIMIT);
+  g_wasm_output = string(VERIFY_STATUS_NAMES[h.status]) + "|" +
+                  to_string(h.part) + "|" + to_string(h.pos) + "|" +
+                  to_string(h.stage) + "|" + (h.complete ? "1|" : "0|") +
+                  (h.cached ? "1|" : "0|") + to_string(h.us) + "\n";
+  for (const vector<string> &e : h.completions)
+    g_wasm_output += rpn_to_infix(e) + " = " +
+                     to_string(engine.config()->target) + "\n";
+  return g_wasm_output.c_str();
+}
+
+// 在 max_us 微秒内接着排上次没排完的提示（<= 0 时排完为止），返回是否还有
+// 没排完的；排完后同样的 hegel_hint 请求直接返回完整排名
+EMSCRIPTEN_KEEPALIVE int hegel_hint_idle(int max_us) {
+  g_hint_engine.set_config(g_wasm_config);
+  return g_hint_engine.idle(max_us) ? 1 : 0;
+}
+
+// 束搜索（见 BeamSearch，用于穷举跑不动的 10~12 个数）：返回首行
+//   是否穷尽|轮数|最后一轮束宽|状态数|首解微秒数（没找到为 -1）|微秒数
+// 随后至多 limit 行 中缀 = 目标（按排名从简到繁，limit <= 0 时不限）。
+// ms <= 0 时用 BEAM_BUDGET_US；输入不合法时返回空串。
+EMSCRIPTEN_KEEPALIVE const char *hegel_beam(const char *line, int ms,
+                                            int limit) {
+  g_wasm_output.clear();
+  if (!line)
+    return g_wasm_output.c_str();
+  vector<Node> input =
+      Solver::parse_nodes_from_line(*g_wasm_config, string(line));
+  if (input.empty())
+    return g_wasm_output.c_str();
+  BeamSearch beam(g_wasm_config);
+  BeamResult r = beam.run(input, ms > 0 ? ms * 1000LL : BEAM_BUDGET_US,
+                          limit > 0 ? (size_t)limit : 0);
+  g_wasm_output = string(r.exhausted ? "1|" : "0|") + to_string(r.rounds) +
+                  "|" + to_string(r.width) + "|" + to_string(r.states) + "|" +
+                  to_string(r.first_us) + "|" + to_string(r.us) + "\n";
+  for (const vector<string> &e : r.solutions)
+    g_wasm_output += rpn_to_infix(e) + " = " +
+                     to_string(g_wasm_config->target) + "\n";
+  return g_wasm_output.c_str();
+}
+
+// ---- 增量预求解会话（见 ReachSession）----
+// 前端每输入、删除或修改一个数字就调用 push / remove / set，在空闲回调
+// （requestIdleCallback）里反复调用 hegel_session_idle(预算微秒) 直到返回 0，
+// 数字输齐后调用 hegel_session_solve。
+static ReachSession g_session;
+
+// 开始新的一手：清空数字，hand_size 为一手的数字个数（<= 0 时用 4）
+EMSCRIPTEN_KEEPALIVE void hegel_session_reset(int hand_size) {
+  g_session.nums.clear();
+  g_session.hand_size = hand_size > 0 ? hand_size : 4;
+  g_session.dirty = true;
+}
+
+// 只差一个数字时猜测它的取值范围（默认 1~13；lo > hi 时不猜）
+EMSCRIPTEN_KEEPALIVE void hegel_session_speculate(int lo, int hi) {
+  g_session.spec_lo = lo;
+  g_session.spec_hi = hi;
+  g_session.dirty = true;
+}
+
+// 追加一个数字，返回已有的个数
+EMSCRIPTEN_KEEPALIVE int hegel_session_push(int x) {
+  g_session.nums.push_back(x);
+  g_session.dirty = true;
+  return (int)g_session.nums.size();
+}
+
+// 删除第 index 个数字（从 0 起），返回剩下的个数，下标无效时返回 -1
+EMSCRIPTEN_KEEPALIVE int hegel_session_remove(int index) {
+  vector<long long> &v = g_session.nums;
+  if (index < 0 || index >= (int)v.size())
+    return -1;
+  v.erase(v.begin() + index);
+  g_session.dirty = true;
+  return (int)v.size();
+}
+
+// 把第 index 个数字改为 x，下标无效时返回 -1
+EMSCRIPTEN_KEEPALIVE int hegel_session_set(int index, int x) {
+  vector<long long> &v = g_session.nums;
+  if (index < 0 || index >= (int)v.size())
+    return -1;
+  if (v[index] != x) {
+    v[index] = x;
+    g_session.dirty = true;
+  }
+  return (int)v.size();
+}
+
+// 在 max_us 微秒内建子表（<= 0 时建完为止），返回剩余待建的子表数
+EMSCRIPTEN_KEEPALIVE int hegel_session_idle(int max_us) {
+  g_session.set_config(g_wasm_config);
+  return (int)g_session.idle(max_us);
+}
+
+// 用当前的数字求解（只做顶层合并），首行 是否有解|解数|累计新建子表数|微秒数，
+// 随后至多 limit 行 中缀 = 目标（按排名）
+EMSCRIPTEN_KEEPALIVE const char *hegel_session_solve(int limit) {
+  static Solver book;
+  g_session.set_config(g_wasm_config);
+  auto t0 = chrono::steady_clock::now();
+  book.top_k = limit > 0 ? (size_t)limit : 0;
+  book.count_distinct = true; // 解数为全部不同解，不止显示的 limit 条
+  bool found = g_session.solve(book);
+  long long us = chrono::duration_cast<chrono::microseconds>(
+                     chrono::steady_clock::now() - t0)
+                     .count();
+  g_wasm_output = string(found ? "1|" : "0|") +
+                  to_string(book.distinct_count()) + "|" +
+                  to_string(g_session.built) + "|" + to_string(us) + "\n";
+  for (const vector<string> *e : book.ranked())
+    g_wasm_output +=
+        rpn_to_infix(*e) + " = " + to_string(g_wasm_config->target) + "\n";
+  return g_wasm_output.c_str();
+}
+
+// 单次求解的内存上限（KB，0 表示不限）。超出时先淘汰记忆化表，仍不够则提前
+// 结束，已输出的解保留，hegel_truncated() 返回 1。
+EMSCRIPTEN_KEEPALIVE void hegel_set_memory_budget(int kb) {
+  SolverConfig c = *g_wasm_config;
+  c.memory_budget = kb > 0 ? (size_t)kb * 1024 : 0;
+  g_wasm_config = make_config(std::move(c));
+}
+
+// 最近一次求解的估算内存峰值（字节）
+EMSCRIPTEN_KEEPALIVE double hegel_memory_peak() {
+  return g_wasm_last ? (double)g_wasm_last->mem_peak : 0.0;
+}
+
+EMSCRIPTEN_KEEPALIVE int hegel_truncated() {
+  return g_wasm_last && g_wasm_last->mem_truncated ? 1 : 0;
+}
+
+// 之后的 hegel_solve / hegel_begin 在无解时顺便记下离目标最近的 k 个值
+// （0 表示不记，见 NearMiss）
+EMSCRIPTEN_KEEPALIVE void hegel_set_near_miss(int k) {
+  g_wasm_near_k = max(0, k);
+}
+
+// 最近一次求解无解时最接近目标的值，由近到远每行 值|距离|中缀；大数的值为
+// ≈2^x、距离为空。有解或未开启时为空
+EMSCRIPTEN_KEEPALIVE const char *hegel_near_misses() {
+  g_wasm_output.clear();
+  if (!g_wasm_last || g_wasm_last->found)
+    return g_wasm_output.c_str();
+  for (const NearMiss::Entry &e : g_wasm_last->near.best)
+    g_wasm_output += NearMiss::value_text(e) + "|" +
+                     (e.big ? string() : to_string(e.dist)) + "|" +
+                     rpn_to_infix(e.expr) + "\n";
+  return g_wasm_output.c_str();
+}
+
+// max_pow / max_cat 放在最后，旧前端少传这两个参数时按 0（不启用）处理
+EMSCRIPTEN_KEEPALIVE void hegel_configure(int target, int max_nest,
+                                          int max_sqrt, int max_fact,
+                                          int max_lg, int max_lb, int max_log,
+                                          int no_neg, int only_math,
+                                          int max_pow, int max_cat) {
+  SolverConfig c = *g_wasm_config;
+  c.target = target;
+  c.max_nest = max_nest;
+  c.max_use[F_SQRT] = max_sqrt;
+  c.max_use[F_FACT] = max_fact;
+  c.max_use[F_LG] = max_lg;
+  c.max_use[F_LB] = max_lb;
+  c.max_use[F_LOG] = max_log;
+  c.max_use[F_POW] = max_pow;
+  c.max_use[F_CAT] = max_cat;
+  c.no_negative = no_neg != 0;
+  c.only_arithmetic = only_math != 0;
+  g_wasm_config = make_config(std::move(c));
+}
+}
+
+int main() { return 0; }
@@ -7,9 +7,33 @@ const PORT = process.env.PORT || 5173;
 const ROOT = __dirname;
 const EXE_PATH = path.join(ROOT, "Hegel Infix.exe");
 const MAX_NUMBERS = 8;
+// Hands of MAX_NUMBERS+1..MAX_BEAM_NUMBERS are too large to exhaust; they get
+// the anytime beam search, which returns what it found within BEAM_MS
+const MAX_BEAM_NUMBERS = 12;
+const BEAM_MS = Number(process.env.HEGEL_BEAM_MS || 2000);
 const DEFAULT_LIMIT = 200;
 const MAX_LIMIT = 1000;
 const TIMEOUT_MS = 10000;
+// Per-request memory ceiling for the native solver (MB, 0 = unlimited)
+const MEMORY_BUDGET_MB = Number(process.env.HEGEL_MEMORY_BUDGET_MB || 64);
+// Admission control (native addon only): the search size is estimated before
+// solving. Solves predicted to exceed TIMEOUT_MS are downgraded to find-first;
+// find-first predicted beyond REJECT_FACTOR * TIMEOUT_MS (an upper bound, it
+// usually stops early) is rejected. Solves predicted above HEAVY_MS wait for
+// one of MAX_HEAVY slots, with at most MAX_QUEUE waiting.
+const ESTIMATE_SAMPLES = 32;
+const HEAVY_MS = Number(process.env.HEGEL_HEAVY_MS || 1000);
+const MAX_HEAVY = Number(process.env.HEGEL_MAX_HEAVY || 1);
+const MAX_QUEUE = Number(process.env.HEGEL_MAX_QUEUE || 8);
+const REJECT_FACTOR = Number(process.env.HEGEL_REJECT_FACTOR || 4);
+
+// In-process solver (N-API addon, `npm run build:addon`); falls back to the exe
+let native = null;
+try {
+  native = require("./build/Release/hegel.node");
+} catch (err) {
+  native = null;
+}
 
 const MIME = {
   ".html": "text/html; charset=utf-8",
@@ -265,13 +289,36 @@ function extractSolutions(output, limit) {
   return solutions;
 }
 
-function runSolver(numbers, limit) {
+// NDJSON output of `Hegel Infix.exe --format ndjson`; older builds ignore the
+// flag and print text, so fall back to scraping when no records are found.
+function parseNdjson(output, limit) {
+  const solutions = [];
+  let records = 0;
+  for (const line of output.split(/\r?\n/)) {
+    if (!line.startsWith("{")) continue;
+    let rec;
+    try {
+      rec = JSON.parse(line);
+    } catch (err) {
+      continue;
+    }
+    records += 1;
+    if (typeof rec.infix !== "string") continue;
+    if (!limit || solutions.length < limit) {
+      solutions.push({ infix: rec.infix, rpn: rec.rpn, latex: rec.latex });
+    }
+  }
+  return records > 0 ? solutions : extractSolutions(output, limit);
+}
+
+// beamMs > 0 runs the CLI's beam mode with that deadline instead of find-all
+function runSolver(numbers, limit, beamMs) {
   return new Promise((resolve, reject) => {
     if (!fs.existsSync(EXE_PATH)) {
       reject(new Error("Hegel Infix.exe not found"));
       return;
     }
-    const child = spawn(EXE_PATH, [], { cwd: ROOT, windowsHide: true });
+    const child = spawn(EXE_PATH, ["--format", "ndjson"], { cwd: ROOT, windowsHide: true });
     let stdout = "";
     let stderr = "";
     const timer = setTimeout(() => {
@@ -291,15 +338,151 @@ function runSolver(numbers, limit) {
     });
     child.on("close", () => {
       clearTimeout(timer);
-      const solutions = extractSolutions(stdout, limit);
-      resolve({ solutions, raw: stdout, stderr });
+      const solutions = parseNdjson(stdout, limit);
+      resolve({ solutions, raw: stdout, stderr, beam: parseBeam(stdout) });
     });
 
-    child.stdin.write(`${numbers.join(" ")}\n`);
+    if (beamMs > 0) child.stdin.write(`beam\n${numbers.join(" ")} | ${beamMs}\n`);
+    else child.stdin.write(`${numbers.join(" ")}\n`);
     child.stdin.end();
   });
 }
 
+function runNative(numbers, limit, signal, findFirst) {
+  const task = native.solve(numbers, {
+    findFirst,
+    limit,
+    timeoutMs: TIMEOUT_MS,
+    memoryBudget: MEMORY_BUDGET_MB * 1024 * 1024
+  });
+  if (signal) {
+    if (signal.aborted) task.cancel();
+    else signal.addEventListener("abort", () => task.cancel(), { once: true });
+  }
+  return task.then((result) => {
+    learnRate(findFirst ? "first" : "all", result);
+    return {
+      solutions: result.solutions.map((s) => ({ infix: s.infix, rpn: s.rpn, latex: infixToLatex(s.infix) })),
+      total: result.count,
+      states: result.states,
+      truncated: result.truncated
+    };
+  });
+}
+
+// The beam summary record of the CLI's ndjson output, if any
+function parseBeam(output) {
+  for (const line of output.split(/\r?\n/)) {
+    if (!line.startsWith('{"beam"')) continue;
+    try {
+      const rec = JSON.parse(line);
+      return { exhausted: rec.exhausted, rounds: rec.rounds, firstMs: rec.firstUs == null ? -1 : rec.firstUs / 1000 };
+    } catch (err) {
+      return undefined;
+    }
+  }
+  return undefined;
+}
+
+// Beam search for hands beyond MAX_NUMBERS. It always stops by BEAM_MS, but
+// still takes a heavy slot so large hands cannot pile up on the thread pool.
+async function runBeam(numbers, limit, signal) {
+  const slot = acquireHeavy();
+  if (!slot) {
+    const err = new Error("server busy");
+    err.code = "EBUSY";
+    throw err;
+  }
+  await slot;
+  try {
+    const task = native.beam(numbers, { limit, timeoutMs: BEAM_MS });
+    if (signal) {
+      if (signal.aborted) task.cancel();
+      else signal.addEventListener("abort", () => task.cancel(), { once: true });
+    }
+    const result = await task;
+    return {
+      solutions: result.solutions.map((s) => ({ infix: s.infix, rpn: s.rpn, latex: infixToLatex(s.infix) })),
+      total: result.count,
+      states: result.states,
+      beam: { exhausted: result.exhausted, rounds: result.rounds, firstMs: result.firstMs }
+    };
+  } finally {
+    releaseHeavy();
+  }
+}
+
+// Estimate first, then solve in full, solve find-first only, queue or reject
+async function solveAdmitted(numbers, limit, signal) {
+  const { plan, estimate } = await admit(numbers);
+  if (plan === "reject") {
+    const err = new Error("query too expensive");
+    err.code = "ETOOEXPENSIVE";
+    err.estimate = estimate;
+    throw err;
+  }
+  const heavy = estimate.predictedMs > HEAVY_MS;
+  if (heavy) {
+    const slot = acquireHeavy();
+    if (!slot) {
+      const err = new Error("server busy");
+      err.code = "EBUSY";
+      err.estimate = estimate;
+      throw err;
+    }
+    await slot;
+  }
+  try {
+    const result = await runNative(numbers, limit, signal, plan === "first");
+    return { ...result, downgraded: plan === "first", estimate };
+  } finally {
+    if (heavy) releaseHeavy();
+  }
+}
+
+// Microseconds per visited state, refined from finished solves
+const usPerState = { all: 3, first: 10 };
+
+function learnRate(mode, result) {
+  if (result.states < 10000 || !(result.tookMs > 0)) return;
+  const us = (result.tookMs * 1000) / result.states;
+  usPerState[mode] = 0.8 * usPerState[mode] + 0.2 * us;
+}
+
+async function predict(numbers, findFirst) {
+  const est = await native.estimate(numbers, { findFirst, samples: ESTIMATE_SAMPLES });
+  const mode = findFirst ? "first" : "all";
+  return { mode, states: Math.round(est.states), predictedMs: Math.round((est.states * usPerState[mode]) / 1000) };
+}
+
+// Decide how to run a query: { plan: "all" | "first" | "reject", estimate }
+async function admit(numbers) {
+  const all = await predict(numbers, false);
+  if (all.predictedMs <= TIMEOUT_MS) return { plan: "all", estimate: all };
+  const first = await predict(numbers, true);
+  if (first.predictedMs <= TIMEOUT_MS * REJECT_FACTOR) return { plan: "first", estimate: first };
+  return { plan: "reject", estimate: first };
+}
+
+let heavyRunning = 0;
+const heavyWaiting = [];
+
+// Resolves once a heavy slot is free; null when the queue is full
+function acquireHeavy() {
+  if (heavyRunning < MAX_HEAVY) {
+    heavyRunning += 1;
+    return Promise.resolve();
+  }
+  if (heavyWaiting.length >= MAX_QUEUE) return null;
+  return new Promise((resolve) => heavyWaiting.push(resolve));
+}
+
+function releaseHeavy() {
+  const next = heavyWaiting.shift();
+  if (next) next();
+  else heavyRunning -= 1;
+}
+
 function isSafeNumber(value) {
   return Number.isInteger(value) && Number.isFinite(value) && Math.abs(value) <= 1000;
 }
@@ -315,22 +498,37 @@ const server = http.createServer(async (req, res) => {
       const body = await parseBody(req);
       const numbers = Array.isArray(body.numbers) ? body.numbers : [];
       const limit = Number.isInteger(body.limit) ? Math.min(body.limit, MAX_LIMIT) : DEFAULT_LIMIT;
-      if (!numbers.length || numbers.length > MAX_NUMBERS || !numbers.every(isSafeNumber)) {
+      if (!numbers.length || numbers.length > MAX_BEAM_NUMBERS || !numbers.every(isSafeNumber)) {
         sendJson(res, 400, { error: "Invalid numbers" });
         return;
       }
       const start = Date.now();
-      const result = await runSolver(numbers, limit);
+      // Stop the native solve if the client goes away before we answer
+      const abort = new AbortController();
+      res.on("close", () => {
+        if (!res.writableEnded) abort.abort();
+      });
+      const large = numbers.length > MAX_NUMBERS;
+      let result;
+      if (native) result = large ? await runBeam(numbers, limit, abort.signal) : await solveAdmitted(numbers, limit, abort.signal);
+      else result = await runSolver(numbers, limit, large ? BEAM_MS : 0);
       const duration = Date.now() - start;
       sendJson(res, 200, {
         solutions: result.solutions,
         count: result.solutions.length,
+        total: result.total,
+        truncated: result.truncated || undefined,
+        downgraded: result.downgraded || undefined,
+        estimate: result.estimate,
+        beam: result.beam,
         limit,
         tookMs: duration,
         stderr: result.stderr || undefined
       });
     } catch (err) {
-      sendJson(res, 500, { error: err.message || "solver error" });
+      if (err.code === "ECANCELLED") return;
+      const status = { ETIMEDOUT: 504, ETOOEXPENSIVE: 422, EBUSY: 503 }[err.code] || 500;
+      sendJson(res, status, { error: err.message || "solver error", estimate: err.estimate });
     }
     return;
   }
@@ -356,4 +554,5 @@ const server = http.createServer(async (req, res) => {
 
 server.listen(PORT, () => {
   console.log(`24 Points Machine server running at http://localhost:${PORT}`);
+  console.log(native ? "Solver: native addon" : `Solver: ${EXE_PATH}`);
 });
@@ -0,0 +1,43 @@
+// Smoke test for the Node addon (build it first with npm run build:addon).
+// Checks that count stays bounded: hands too large to count in time must
+// reject with ETIMEDOUT / ECANCELLED / EINVAL instead of running until the
+// process is killed. Usage: node test_addon.js
+const assert = require("assert");
+const path = require("path");
+
+const addon = require(path.join(__dirname, "build", "Release", "hegel.node"));
+
+const BIG = [1, 2, 3, 4, 5, 6, 7, 8];
+
+async function rejectsWith(promise, code, maxMs) {
+  const t0 = Date.now();
+  await assert.rejects(promise, (err) => err.code === code);
+  const ms = Date.now() - t0;
+  assert.ok(ms < maxMs, `${code} after ${ms} ms (limit ${maxMs} ms)`);
+  return ms;
+}
+
+async function main() {
+  const small = await addon.count([3, 3, 8, 8], { target: 24 });
+  assert.ok(small.forms > 0);
+
+  let ms = await rejectsWith(addon.count(BIG, { timeoutMs: 200 }),
+                             "ETIMEDOUT", 2000);
+  console.log(`count timeoutMs 200: ETIMEDOUT after ${ms} ms`);
+
+  const p = addon.count(BIG);
+  setTimeout(() => p.cancel(), 100);
+  ms = await rejectsWith(p, "ECANCELLED", 2000);
+  console.log(`count cancel at 100 ms: ECANCELLED after ${ms} ms`);
+
+  ms = await rejectsWith(addon.count(BIG, { memoryBudget: 16 << 20 }),
+                         "EINVAL", 10000);
+  console.log(`count memoryBudget 16 MB: EINVAL after ${ms} ms`);
+
+  console.log("ok");
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});